@@ -5,6 +5,7 @@ import time
 import logging
 import os
 import json
+import sys
 from dotenv import load_dotenv
 
 load_dotenv()
@@ -28,8 +29,13 @@ class PJMFetcher:
     DATA_FILE_RT = 'rt_data_partial.csv'
     DATA_FILE_DA = 'da_data_partial.csv'
 
-    def __init__(self, api_key: str):
+    def __init__(self, api_key: str, rt_fivemin: bool = False):
         self.api_key = api_key
+        # 5-minute RT intervals (~12x the rows) use their own partial files
+        self.rt_endpoint = 'rt_fivemin_hrl_lmps' if rt_fivemin else 'rt_hrl_lmps'
+        if rt_fivemin:
+            self.CHECKPOINT_FILE = 'fetch_checkpoint_fivemin.json'
+            self.DATA_FILE_RT = 'rt_fivemin_data_partial.csv'
         self.last_request_time = 0
         self.requests_made = 0
         self.checkpoint = self._load_checkpoint()
@@ -78,7 +84,7 @@ class PJMFetcher:
     
     def fetch_data_paginated(self, start: datetime, end: datetime, market: str) -> pd.DataFrame:
             # Fetch all nodes for date range with pagination
-            endpoint = 'da_hrl_lmps' if market == 'da' else 'rt_hrl_lmps'
+            endpoint = 'da_hrl_lmps' if market == 'da' else self.rt_endpoint
             start_row = 1
             rows = 50000
             start_time = time.time()
@@ -191,7 +197,9 @@ def main():
     logger.info("PJM DATA FETCH")
     logger.info("="*70)
     
-    fetcher = PJMFetcher(API_KEY)
+    # python fetch.py --fivemin  ->  5-minute RT intervals for lmp_scanner --rt-fivemin
+    rt_fivemin = '--fivemin' in sys.argv
+    fetcher = PJMFetcher(API_KEY, rt_fivemin=rt_fivemin)
     start_time = time.time()
     
     # end_date = datetime.now()
@@ -235,19 +243,34 @@ def main():
         logger.info("\n" + "="*70)
         logger.info("\nMerging DA and RT data...")
 
-        df = pd.merge(
-        da.add_suffix('_da'),
-        rt.add_suffix('_rt'),
-        left_on=['datetime_beginning_ept_da', 'pnode_id_da'],
-        right_on=['datetime_beginning_ept_rt', 'pnode_id_rt'],
-        how='inner'
-        )
+        if rt_fivemin:
+            # Each 5-minute RT interval joins the DA price of its hour; the
+            # scanner rolls the intervals back up to hourly while parsing
+            rt['hour_beginning_ept'] = pd.to_datetime(rt['datetime_beginning_ept']).dt.floor('h')
+            da['hour_beginning_ept'] = pd.to_datetime(da['datetime_beginning_ept'])
+            df = pd.merge(
+            da.add_suffix('_da'),
+            rt.add_suffix('_rt'),
+            left_on=['hour_beginning_ept_da', 'pnode_id_da'],
+            right_on=['hour_beginning_ept_rt', 'pnode_id_rt'],
+            how='inner'
+            )
+            df = df.drop(columns=['hour_beginning_ept_da', 'hour_beginning_ept_rt'])
+        else:
+            df = pd.merge(
+            da.add_suffix('_da'),
+            rt.add_suffix('_rt'),
+            left_on=['datetime_beginning_ept_da', 'pnode_id_da'],
+            right_on=['datetime_beginning_ept_rt', 'pnode_id_rt'],
+            how='inner'
+            )
         
         # Calculate spread
         df['spread'] = df['total_lmp_da'] - df['total_lmp_rt']
 
         # Save final merged file
-        output_file = 'lmp_scanner/lmp_data_merged.csv'
+        output_file = ('lmp_scanner/lmp_data_merged_5min.csv' if rt_fivemin
+                       else 'lmp_scanner/lmp_data_merged.csv')
         df.to_csv(output_file, index=False)
 
         # Clean up partial files and checkpoint
@@ -0,0 +1,261 @@
+#pragma once
+#include "fixed_point.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Per-row inputs handed to every metric policy
+struct Sample {
+    double spread;
+    double cong_spread;
+    double energy_spread;
+    double loss_spread;
+    int hour;
+    int64_t spread_fixed = 0;   // spread in fixed-point units, for Exact<Spread>
+};
+
+// Series tags: which column of a Sample a policy tracks
+struct Spread {
+    static double get(const Sample& s) { return s.spread; }
+    static int64_t get_fixed(const Sample& s) { return s.spread_fixed; }
+};
+struct Congestion { static double get(const Sample& s) { return s.cong_spread; } };
+struct Energy     { static double get(const Sample& s) { return s.energy_spread; } };
+struct Loss       { static double get(const Sample& s) { return s.loss_spread; } };
+
+// Running mean and M2 (Welford), merged with Chan et al.'s parallel formula
+template <typename Series>
+struct Welford {
+    double mean = 0.0;
+    double M2 = 0.0;
+
+    void update(const Sample& s, int n) {
+        double x = Series::get(s);
+        double delta = x - mean;
+        mean += delta / n;
+        M2 += delta * (x - mean);
+    }
+
+    void merge(const Welford& other, int n, int other_n) {
+        int n_total = n + other_n;
+        double delta = other.mean - mean;
+        mean = (n * mean + other_n * other.mean) / n_total;
+        M2 += other.M2 + delta * delta * n * other_n / n_total;
+    }
+};
+
+// Exact mean and variance of a fixed-point series from integer sums. Integer
+// addition is associative, so the result is the same for any row order,
+// thread count or merge tree. Widens to the Welford it stands in for.
+template <typename Series>
+struct Exact {
+    int64_t sum = 0;
+    __int128 sum_sq = 0;
+
+    using Widened = Welford<Series>;
+
+    void update(const Sample& s, int) {
+        int64_t x = Series::get_fixed(s);
+        sum += x;
+        sum_sq += static_cast<__int128>(x) * x;
+    }
+
+    void update_run(const FixedMoments& m) {
+        sum += m.sum;
+        sum_sq += m.sum_sq;
+    }
+
+    void merge(const Exact& other, int, int) {
+        sum += other.sum;
+        sum_sq += other.sum_sq;
+    }
+
+    Widened widen(int n) const {
+        Widened w;
+        if (n == 0) return w;
+        // n * sum_sq - sum^2 is exact in 128 bits; divide only at the end
+        __int128 numerator = static_cast<__int128>(n) * sum_sq - static_cast<__int128>(sum) * sum;
+        long double scale = static_cast<long double>(FIXED_SCALE);
+        w.mean = static_cast<double>(static_cast<long double>(sum) / n / scale);
+        w.M2 = static_cast<double>(static_cast<long double>(numerator) / n / (scale * scale));
+        return w;
+    }
+};
+
+// Magnitude, sign and range of a series
+template <typename Series>
+struct Shape {
+    double sum_abs = 0.0;
+    int positive = 0;
+    double max = -1e9;
+    double min = 1e9;
+
+    void update(const Sample& s, int) {
+        double x = Series::get(s);
+        sum_abs += std::abs(x);
+        if (x > 0) positive++;
+        max = std::max(max, x);
+        min = std::min(min, x);
+    }
+
+    void update_run(const FixedMoments& m) {
+        sum_abs += from_fixed(m.sum_abs);
+        positive += static_cast<int>(m.positive);
+        max = std::max(max, from_fixed(m.max));
+        min = std::min(min, from_fixed(m.min));
+    }
+
+    void merge(const Shape& other, int, int) {
+        sum_abs += other.sum_abs;
+        positive += other.positive;
+        max = std::max(max, other.max);
+        min = std::min(min, other.min);
+    }
+};
+
+// Hour-of-day grid of a series: a Welford mean/M2 and a positive count per
+// hour, each field one 24-wide array so a node's grid is four cache-line
+// runs rather than 24 interleaved structs
+template <typename Series>
+struct Hourly {
+    std::array<double, 24> mean{};
+    std::array<double, 24> M2{};
+    std::array<int, 24> count{};
+    std::array<int, 24> positive{};
+
+    void update(const Sample& s, int) {
+        if (s.hour >= 0 && s.hour < 24) {
+            const int h = s.hour;
+            double x = Series::get(s);
+            double delta = x - mean[h];
+            count[h]++;
+            mean[h] += delta / count[h];
+            M2[h] += delta * (x - mean[h]);
+            positive[h] += x > 0;
+        }
+    }
+
+    void merge(const Hourly& other, int, int) {
+        for (int h = 0; h < 24; h++) {
+            const int n = count[h];
+            const int other_n = other.count[h];
+            if (other_n == 0) continue;
+            const int n_total = n + other_n;
+            double delta = other.mean[h] - mean[h];
+            mean[h] = n == 0 ? other.mean[h] : mean[h] + delta * other_n / n_total;
+            M2[h] += other.M2[h] + delta * delta * n * other_n / n_total;
+            count[h] = n_total;
+            positive[h] += other.positive[h];
+        }
+    }
+
+    double sum(int h) const { return mean[h] * count[h]; }
+};
+
+// Policies that can absorb a whole run of fixed-point spreads at once
+template <typename P>
+concept RunUpdatable = requires(P policy, const FixedMoments& m) { policy.update_run(m); };
+
+// Per-node accumulator assembled from metric policies. Only the listed
+// policies are stored and updated, so a run that needs fewer metrics
+// instantiates a smaller type and a shorter update.
+template <typename... Policies>
+struct Accumulator {
+    int n = 0;
+    std::string zone;
+    int pnode_id = 0;
+
+    std::tuple<Policies...> metrics;
+
+    template <typename P>
+    static constexpr bool has = (std::is_same_v<P, Policies> || ...);
+    
+    // Every policy can take FixedMoments, so runs can skip per-row updates
+    static constexpr bool run_updatable = (RunUpdatable<Policies> && ...);
+
+    template <typename P> P& get() { return std::get<P>(metrics); }
+    template <typename P> const P& get() const { return std::get<P>(metrics); }
+
+    void update(const Sample& s, const std::string& zone_name, int node_id) {
+        n++;
+
+        if (n == 1) {
+            zone = zone_name;
+            pnode_id = node_id;
+        }
+
+        std::apply([&](auto&... policy) { (policy.update(s, n), ...); }, metrics);
+    }
+    
+    // A run of consecutive rows reduced by reduce_fixed()
+    void update_run(const FixedMoments& m, const std::string& zone_name, int node_id)
+        requires run_updatable {
+        if (n == 0) {
+            zone = zone_name;
+            pnode_id = node_id;
+        }
+        n += static_cast<int>(m.count);
+        std::apply([&](auto&... policy) { (policy.update_run(m), ...); }, metrics);
+    }
+
+    // Combine two partial accumulators (Chan et al. parallel variance)
+    void merge(const Accumulator& other) {
+        if (zone.empty()) {
+            zone = other.zone;
+            pnode_id = other.pnode_id;
+        }
+        if (other.n == 0) return;
+        if (n == 0) {
+            std::string known_zone = std::move(zone);
+            *this = other;
+            if (zone.empty()) zone = std::move(known_zone);
+            return;
+        }
+
+        merge_metrics(other, std::index_sequence_for<Policies...>{});
+        n += other.n;
+    }
+
+    // Copy the policies both accumulators share into a wider one, converting
+    // any that stand in for another (Exact -> Welford); the rest keep their
+    // defaults
+    template <typename Wide>
+    void widen_into(Wide& wide) const {
+        wide.n = n;
+        wide.zone = zone;
+        wide.pnode_id = pnode_id;
+        (widen_policy<Policies>(wide), ...);
+    }
+
+private:
+    template <typename P, typename Wide>
+    void widen_policy(Wide& wide) const {
+        if constexpr (Wide::template has<P>) {
+            wide.template get<P>() = get<P>();
+        } else {
+            wide.template get<typename P::Widened>() = get<P>().widen(n);
+        }
+    }
+
+    template <size_t... I>
+    void merge_metrics(const Accumulator& other, std::index_sequence<I...>) {
+        (std::get<I>(metrics).merge(std::get<I>(other.metrics), n, other.n), ...);
+    }
+};
+
+// The same accumulator with Welford<Spread> swapped for Exact<Spread>
+template <typename P> struct exact_policy { using type = P; };
+template <> struct exact_policy<Welford<Spread>> { using type = Exact<Spread>; };
+
+template <typename Acc> struct exact_accumulator;
+template <typename... Policies>
+struct exact_accumulator<Accumulator<Policies...>> {
+    using type = Accumulator<typename exact_policy<Policies>::type...>;
+};
+
+template <typename Acc>
+using ExactAccumulator = typename exact_accumulator<Acc>::type;
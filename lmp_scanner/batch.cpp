@@ -0,0 +1,1433 @@
+#include "batch.h"
+#include "block_reader.h"
+#include "column_store.h"
+#include "data_quality.h"
+#include "gzip_index.h"
+#include "run_metrics.h"
+#include "synthetic.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <glob.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+RowBatch::RowBatch()
+    : pnode_id(BATCH_ROWS), hour_stamp(BATCH_ROWS), zone_id(BATCH_ROWS),
+      spread(BATCH_ROWS), cong_da(BATCH_ROWS), cong_rt(BATCH_ROWS),
+      energy_da(BATCH_ROWS), energy_rt(BATCH_ROWS), loss_da(BATCH_ROWS), loss_rt(BATCH_ROWS),
+      spread_fixed(BATCH_ROWS), hour(BATCH_ROWS),
+      cong_spread(BATCH_ROWS), energy_spread(BATCH_ROWS), loss_spread(BATCH_ROWS),
+      sel(BATCH_ROWS) {}
+
+// ---------------------------------------------------------------------------
+// Kernels
+
+namespace {
+
+inline void subtract(const double* __restrict a, const double* __restrict b,
+                     double* __restrict out, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) out[i] = a[i] - b[i];
+}
+
+inline uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Stratified sample of `units` blocks: round(fraction * units) equal strata
+// with one block drawn from each, so every block is equally likely to be
+// read and the picks still cover the whole file. Sorted ascending.
+std::vector<size_t> stratified_sample(size_t units, double fraction, uint64_t seed) {
+    std::vector<size_t> picks;
+    if (units == 0) return picks;
+    const size_t k = std::clamp<size_t>(static_cast<size_t>(std::llround(fraction * units)), 1, units);
+    picks.reserve(k);
+    for (size_t s = 0; s < k; s++) {
+        const size_t lo = s * units / k;
+        const size_t hi = (s + 1) * units / k;
+        picks.push_back(lo + mix64(seed * 0x100000001B3ULL + s) % (hi - lo));
+    }
+    return picks;
+}
+
+} // namespace
+
+void derive_columns(RowBatch& b, const BatchColumns& columns) {
+    const uint32_t n = b.size;
+    const int32_t* __restrict stamps = b.hour_stamp.data();
+    uint8_t* __restrict hour = b.hour.data();
+    for (uint32_t i = 0; i < n; i++) {
+        hour[i] = static_cast<uint8_t>(stamps[i] >= 0 ? stamps[i] % 24 : 0);
+    }
+    if (columns.components) {
+        subtract(b.cong_da.data(), b.cong_rt.data(), b.cong_spread.data(), n);
+        subtract(b.energy_da.data(), b.energy_rt.data(), b.energy_spread.data(), n);
+    }
+    if (columns.loss) {
+        subtract(b.loss_da.data(), b.loss_rt.data(), b.loss_spread.data(), n);
+    }
+}
+
+void select_all(RowBatch& b) {
+    for (uint32_t i = 0; i < b.size; i++) b.sel[i] = static_cast<uint16_t>(i);
+    b.selected = b.size;
+}
+
+void select_rows(RowBatch& b, const RowFilter& filter, int filter_zone) {
+    if (!filter.zone.empty() && filter_zone < 0) {
+        b.selected = 0;
+        return;
+    }
+    // Branch-free: every index is written, the cursor advances on a match
+    uint32_t k = 0;
+    for (uint32_t j = 0; j < b.selected; j++) {
+        const uint32_t i = b.sel[j];
+        int stamp = b.hour_stamp[i];
+        bool keep = filter.accepts_time(stamp) &&
+                    filter.accepts_hour(stamp >= 0 ? stamp % 24 : 0) &&
+                    (filter_zone < 0 || b.zone_id[i] == filter_zone) &&
+                    filter.accepts_node(b.pnode_id[i]);
+        b.sel[k] = static_cast<uint16_t>(i);
+        k += keep;
+    }
+    b.selected = k;
+}
+
+// ---------------------------------------------------------------------------
+// Sources
+
+namespace {
+
+using ParseFn = bool (*)(const char*, size_t, RowBatch&, uint32_t, char*, const RowFilter*, RowIssue&);
+
+// Parse one CSV line straight into row i of the batch
+template <bool Components, bool WithLoss, bool Fixed>
+bool parse_into(const char* line, size_t len, RowBatch& b, uint32_t i, char* zone,
+                const RowFilter* filter, RowIssue& issue) {
+    int hour;
+    int64_t fixed[SC_NUM_PRICES];
+    bool ok = CSVRowParser::parse<Components, WithLoss, Fixed>(
+        line, len,
+        b.pnode_id[i], zone, b.spread[i],
+        b.cong_da[i], b.cong_rt[i],
+        b.energy_da[i], b.energy_rt[i],
+        b.loss_da[i], b.loss_rt[i],
+        hour, b.hour_stamp[i],
+        filter, fixed, &issue
+    );
+    if constexpr (Fixed) {
+        if (ok) b.spread_fixed[i] = fixed[SC_SPREAD];
+    }
+    return ok;
+}
+
+template <bool Components, bool WithLoss>
+ParseFn pick_parser(bool fixed) {
+    return fixed ? &parse_into<Components, WithLoss, true> : &parse_into<Components, WithLoss, false>;
+}
+
+ParseFn pick_parser(const BatchColumns& c) {
+    if (c.components) return c.loss ? pick_parser<true, true>(c.fixed) : pick_parser<true, false>(c.fixed);
+    return c.loss ? pick_parser<false, true>(c.fixed) : pick_parser<false, false>(c.fixed);
+}
+
+using ZoneCache = std::unordered_map<std::string, uint16_t>;
+
+// A worker's state across parse_text calls: lookups cached without locks,
+// and where the text being parsed sits in its file (for data_quality.json)
+struct ParseState {
+    ZoneCache zone_ids;
+    DataQuality::NodeCache node_hours;
+    const std::string* file = nullptr;
+    uint64_t offset = 0;   // of the first byte handed to parse_text
+
+    ParseState& at(const std::string& path, uint64_t text_offset) {
+        file = &path;
+        offset = text_offset;
+        return *this;
+    }
+};
+
+// Header names of the merged-layout columns the parser reads
+const std::pair<int, const char*> BOUND_COLUMNS[] = {
+    {COL_CONG_DA, "congestion_price_da"}, {COL_LOSS_DA, "marginal_loss_price_da"},
+    {COL_ENERGY_DA, "system_energy_price_da"}, {COL_CONG_RT, "congestion_price_rt"},
+    {COL_LOSS_RT, "marginal_loss_price_rt"}, {COL_ENERGY_RT, "system_energy_price_rt"},
+    {COL_DATETIME, "datetime"}, {COL_PNODE_ID, "pnode_id"}, {COL_ZONE, "zone"}, {COL_SPREAD, "spread"}};
+
+// Where a file's header puts the columns the parser reads. A file that
+// names them at their merged-layout positions, or names none of them, is
+// parsed as is; any other order has each line rearranged into the merged
+// layout first (columns the parser doesn't read are left empty).
+struct ColumnBinding {
+    std::vector<int> source;   // merged column -> column in the file, -1 = not read
+    bool identity = true;
+
+    static ColumnBinding bind(const std::string& header, const std::string& path) {
+        std::unordered_map<std::string, int> index;
+        size_t start = 0;
+        for (int column = 0; start <= header.size(); column++) {
+            size_t comma = header.find(',', start);
+            if (comma == std::string::npos) comma = header.size();
+            std::string name = header.substr(start, comma - start);
+            name.erase(0, name.find_first_not_of(" \""));
+            name.erase(name.find_last_not_of(" \"") + 1);
+            index.emplace(name, column);
+            start = comma + 1;
+        }
+
+        ColumnBinding binding;
+        binding.source.assign(NUM_COLUMNS, -1);
+        int found = 0;
+        for (const auto& [column, name] : BOUND_COLUMNS) found += index.count(name);
+        if (found == 0) return binding;   // no names to go by: the merged layout
+        for (const auto& [column, name] : BOUND_COLUMNS) {
+            auto it = index.find(name);
+            if (it == index.end()) {
+                throw std::runtime_error(path + ": header has no " + name + " column");
+            }
+            binding.source[column] = it->second;
+            if (it->second != column) binding.identity = false;
+        }
+        return binding;
+    }
+
+    // Writes `line` in the merged layout to `out`; false if it is missing
+    // a bound column
+    bool rearrange(const char* line, size_t len, std::string& out) const {
+        if (len > 0 && line[len - 1] == '\r') len--;
+        uint32_t starts[64];
+        int fields = 0;
+        starts[fields++] = 0;
+        for (const char* p = line; fields < 64;) {
+            p = static_cast<const char*>(std::memchr(p, ',', line + len - p));
+            if (!p) break;
+            starts[fields++] = ++p - line;
+        }
+        out.clear();
+        for (int column = 0; column < NUM_COLUMNS; column++) {
+            if (column > 0) out += ',';
+            const int from = source[column];
+            if (from < 0) continue;
+            if (from >= fields) return false;
+            const uint32_t end = from + 1 < fields ? starts[from + 1] - 1 : len;
+            out.append(line + starts[from], end - starts[from]);
+        }
+        return true;
+    }
+};
+
+// Text input; filters are pushed into the parser, so rejected rows never
+// enter a batch
+class TextBatchSource : public BatchSource {
+public:
+    bool applies_filter() const override { return true; }
+
+protected:
+    TextBatchSource(const RowFilter& filter, const BatchColumns& columns)
+        : filter_(filter.active() ? &filter : nullptr), parse_(pick_parser(columns)) {}
+
+    // Parse the lines in [begin, end), yielding each full batch and the
+    // final partial one. Lines failing validation, and repeats of a (node,
+    // hour) already seen, are recorded in the run's DataQuality and skipped.
+    Generator<RowBatch> parse_text(const char* begin, const char* end, RowBatch& batch,
+                                   ParseState& state, const ColumnBinding* binding = nullptr) {
+        batch.size = 0;
+        batch.fixed_runs = false;
+        DataQuality& quality = *quality_;
+        if (quality.stopped()) co_return;
+        long long lines = 0, invalid = 0, parsed = 0;
+        char zone[32];
+        std::string rearranged;
+        LineCursor cursor(begin, end);
+        const char* line;
+        size_t len;
+        RowIssue issue;
+        while (cursor.next(line, len)) {
+            lines++;
+            const char* text = line;
+            const size_t text_len = len;
+            auto reject = [&](RowIssue why) {
+                invalid++;
+                quality.record(why, *state.file, state.offset + (text - begin), text, text_len);
+            };
+            if (binding && !binding->identity) {
+                if (!binding->rearrange(line, len, rearranged)) {
+                    reject(ROW_FEW_FIELDS);
+                    continue;
+                }
+                line = rearranged.data();
+                len = rearranged.size();
+            }
+            if (!parse_(line, len, batch, batch.size, zone, filter_, issue)) {
+                if (issue != ROW_FILTERED) reject(issue);
+                continue;
+            }
+            if (quality.duplicate(state.node_hours, batch.pnode_id[batch.size], batch.hour_stamp[batch.size])) {
+                reject(ROW_DUPLICATE);
+                continue;
+            }
+
+            auto it = state.zone_ids.find(zone);
+            if (it == state.zone_ids.end()) it = state.zone_ids.emplace(zone, zones_.intern(zone)).first;
+            batch.zone_id[batch.size] = it->second;
+
+            parsed++;
+            if (++batch.size == BATCH_ROWS) {
+                select_all(batch);
+                co_yield batch;
+                batch.size = 0;
+            }
+        }
+        quality.add_checked(lines);
+        rows_scanned_ += lines;
+        auto& metrics = thread_metrics();
+        metrics.lines += lines;
+        metrics.invalid += invalid;
+        metrics.filtered += lines - invalid - parsed;
+        metrics.bytes += end - begin;
+        if (batch.size > 0) {
+            select_all(batch);
+            co_yield batch;
+        }
+    }
+
+private:
+    const RowFilter* filter_;
+    ParseFn parse_;
+};
+
+// Text blocks from a reader thread (a file or stdin)
+class CsvBatchSource : public TextBatchSource {
+public:
+    CsvBatchSource(const std::string& path, const RowFilter& filter, const BatchColumns& columns,
+                   int workers)
+        : TextBatchSource(filter, columns), path_(path), reader_(path), blocks_(workers * 2) {
+        reader_.read_header();
+    }
+
+    ~CsvBatchSource() override {
+        if (reader_thread_.joinable()) {
+            blocks_.close();
+            reader_thread_.join();
+        }
+    }
+
+    void start() override {
+        std::cout << "Reading file..." << std::endl;
+        reader_thread_ = std::thread([this]() {
+            ThreadScope scope("reader");
+            std::string block;
+            size_t next_report = 1ULL << 30;
+            while (reader_.next(block)) {
+                if (!blocks_.push({std::move(block), reader_.offset()})) break;
+                block = std::string();
+                if (reader_.bytes_read() >= next_report) {
+                    std::cout << "  Read " << (reader_.bytes_read() >> 20) << " MB..." << std::endl;
+                    next_report += 1ULL << 30;
+                }
+            }
+            blocks_.close();
+        });
+    }
+
+    Generator<RowBatch> stream(RowBatch& batch) override {
+        TextBlock block;
+        ParseState state;
+        while (blocks_.pop(block)) {
+            const std::string& text = block.text;
+            for (RowBatch& b : parse_text(text.data(), text.data() + text.size(), batch,
+                                          state.at(path_, block.offset))) {
+                co_yield b;
+            }
+        }
+    }
+
+    void finish() override {
+        if (reader_thread_.joinable()) reader_thread_.join();
+        blocks_.report_depths("blocks");
+    }
+
+private:
+    std::string path_;
+    BlockReader reader_;
+    BoundedQueue<TextBlock> blocks_;
+    std::thread reader_thread_;
+};
+
+// A CSV file read by one thread that keeps several large reads in flight
+// (io_uring, or pread where that isn't available) into a fixed set of
+// aligned buffers. Workers parse a buffer in place and hand it back, so the
+// only copy is the partial line carried into the front of the next buffer.
+class AsyncCsvBatchSource : public TextBatchSource {
+public:
+    static constexpr size_t READ_BYTES = 8 << 20;
+    static constexpr size_t CARRY_BYTES = 1 << 20;   // room before the read for the carried line
+    static constexpr size_t ALIGN = 4096;            // O_DIRECT buffer, offset and length alignment
+    static constexpr unsigned DEPTH = 4;             // reads in flight
+
+    AsyncCsvBatchSource(const std::string& path, const RowFilter& filter, const BatchColumns& columns,
+                        int workers, IoMode mode)
+        : TextBatchSource(filter, columns), path_(path), mode_(mode),
+          buffers_(DEPTH + workers + 2), blocks_(buffers_.size()) {
+        if (mode_ == IoMode::Direct) {
+            fd_ = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+            if (fd_ < 0 && errno == EINVAL) {
+                std::cout << "Note: " << path << " doesn't support O_DIRECT; using buffered reads"
+                          << std::endl;
+                mode_ = IoMode::Uring;
+            }
+        }
+        if (fd_ < 0) fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error("Cannot open CSV file: " + path);
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) throw std::runtime_error("Cannot stat CSV file: " + path);
+        size_ = st.st_size;
+
+        for (auto& buffer : buffers_) {
+            buffer = static_cast<char*>(std::aligned_alloc(ALIGN, CARRY_BYTES + READ_BYTES));
+            if (!buffer) throw std::runtime_error("Cannot allocate read buffers");
+        }
+        for (size_t i = 0; i < buffers_.size(); i++) free_.push_back(i);
+
+        if (mode_ != IoMode::Pread) {
+            std::string why;
+            ring_ = IoUring::create(DEPTH, why);
+            if (ring_) {
+                std::vector<std::pair<void*, size_t>> regions;
+                for (char* buffer : buffers_) regions.emplace_back(buffer, CARRY_BYTES + READ_BYTES);
+                ring_->register_buffers(regions);
+            } else {
+                std::cout << "Note: io_uring unavailable (" << why << "); reading with pread" << std::endl;
+            }
+        }
+    }
+
+    ~AsyncCsvBatchSource() override {
+        if (reader_thread_.joinable()) {
+            blocks_.close();
+            stop_buffers();
+            reader_thread_.join();
+        }
+        for (char* buffer : buffers_) std::free(buffer);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    void start() override {
+        std::cout << "Reading file (" << (size_ >> 20) << " MB)..." << std::endl;
+        reader_thread_ = std::thread([this]() {
+            ThreadScope scope("reader");
+            try {
+                read_all();
+            } catch (const std::exception& e) {
+                error_ = e.what();
+            }
+            blocks_.close();
+        });
+    }
+
+    Generator<RowBatch> stream(RowBatch& batch) override {
+        Block block;
+        ParseState state;
+        while (blocks_.pop(block)) {
+            for (RowBatch& b : parse_text(block.begin, block.end, batch, state.at(path_, block.offset))) {
+                co_yield b;
+            }
+            release(block.buffer);
+        }
+    }
+
+    void finish() override {
+        if (reader_thread_.joinable()) reader_thread_.join();
+        blocks_.report_depths("blocks");
+        if (!error_.empty()) throw std::runtime_error(error_);
+    }
+
+    void report() const override {
+        std::cout << "  Read " << (size_ >> 20) << " MB with ";
+        if (!ring_) {
+            std::cout << "pread" << std::endl;
+            return;
+        }
+        std::cout << "io_uring (" << DEPTH << " reads of " << (READ_BYTES >> 20) << " MB in flight"
+                  << (mode_ == IoMode::Direct ? ", O_DIRECT" : "")
+                  << (ring_->buffers_registered() ? ", registered buffers" : "") << ")" << std::endl;
+    }
+
+private:
+    struct Block {
+        size_t buffer = 0;
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        uint64_t offset = 0;   // of begin in the file
+    };
+
+    struct Flight {
+        size_t buffer = 0;
+        int result = 0;
+        bool done = false;
+    };
+
+    std::string path_;
+    IoMode mode_;
+    int fd_ = -1;
+    size_t size_ = 0;
+    std::unique_ptr<IoUring> ring_;
+    std::vector<char*> buffers_;
+    BoundedQueue<Block> blocks_;
+    std::thread reader_thread_;
+    std::string error_;
+
+    std::mutex free_mutex_;
+    std::condition_variable free_ready_;
+    std::vector<size_t> free_;
+    bool stopping_ = false;
+
+    // Blocks until a buffer is free; false once the source is shutting down
+    bool acquire(size_t& buffer) {
+        std::unique_lock<std::mutex> lock(free_mutex_);
+        if (free_.empty() && !stopping_) {
+            double start = run_seconds();
+            free_ready_.wait(lock, [&] { return !free_.empty() || stopping_; });
+            thread_metrics().wait += run_seconds() - start;
+        }
+        if (stopping_) return false;
+        buffer = free_.back();
+        free_.pop_back();
+        return true;
+    }
+
+    void release(size_t buffer) {
+        std::lock_guard<std::mutex> lock(free_mutex_);
+        free_.push_back(buffer);
+        free_ready_.notify_one();
+    }
+
+    void stop_buffers() {
+        std::lock_guard<std::mutex> lock(free_mutex_);
+        stopping_ = true;
+        free_ready_.notify_all();
+    }
+
+    // Fills the rest of a short read synchronously; returns the bytes read
+    size_t complete_read(char* dst, size_t got, size_t want, uint64_t offset) {
+        while (got < want) {
+            ssize_t n = ::pread(fd_, dst + got, want - got, offset + got);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw std::runtime_error("Error reading CSV file: " + path_);
+            if (n == 0) break;
+            got += n;
+        }
+        return got;
+    }
+
+    void read_all() {
+        const uint64_t reads = (size_ + READ_BYTES - 1) / READ_BYTES;
+        Flight flights[DEPTH];
+        uint64_t submitted = 0, completed = 0;
+        unsigned in_flight = 0;   // submitted to the ring, completion not yet seen
+        std::string carry;
+        size_t next_report = 1ULL << 30;
+
+        auto read_length = [&](uint64_t read) {
+            return static_cast<unsigned>(std::min<uint64_t>(READ_BYTES, size_ - read * READ_BYTES));
+        };
+
+        auto reap = [&]() {
+            uint64_t tag;
+            int result;
+            ring_->wait(tag, result);
+            flights[tag % DEPTH].result = result;
+            flights[tag % DEPTH].done = true;
+            in_flight--;
+        };
+        // Reads still in flight must land before their buffers can go
+        auto drain = [&]() {
+            while (in_flight > 0) reap();
+        };
+
+        try {
+            while (completed < reads) {
+                while (submitted < reads && submitted - completed < DEPTH) {
+                    Flight& f = flights[submitted % DEPTH];
+                    if (!acquire(f.buffer)) {
+                        drain();
+                        return;
+                    }
+                    f.done = false;
+                    char* dst = buffers_[f.buffer] + CARRY_BYTES;
+                    const uint64_t offset = submitted * READ_BYTES;
+                    // O_DIRECT lengths are whole blocks; the read stops at end of file
+                    unsigned length = read_length(submitted);
+                    if (mode_ == IoMode::Direct) length = (length + ALIGN - 1) / ALIGN * ALIGN;
+                    if (ring_) {
+                        ring_->read(fd_, f.buffer, dst, length, offset, submitted);
+                        in_flight++;
+                    } else {
+                        StageClock clock;
+                        ssize_t n = ::pread(fd_, dst, length, offset);
+                        f.result = n < 0 ? -errno : static_cast<int>(n);
+                        f.done = true;
+                        clock.lap(thread_metrics().stages[STAGE_READ]);
+                    }
+                    submitted++;
+                }
+
+                Flight& f = flights[completed % DEPTH];
+                StageClock clock;
+                while (!f.done) reap();
+                if (f.result < 0) {
+                    throw std::runtime_error("Error reading CSV file: " + path_ + ": " + std::strerror(-f.result));
+                }
+                char* data = buffers_[f.buffer] + CARRY_BYTES;
+                const uint64_t data_offset = completed * READ_BYTES;
+                const size_t got = complete_read(data, f.result, read_length(completed), completed * READ_BYTES);
+                auto& metrics = thread_metrics();
+                clock.lap(metrics.stages[STAGE_READ]);
+                metrics.bytes += got;
+                const bool last = ++completed == reads;
+
+                // The carried partial line goes just before the new bytes
+                if (carry.size() > CARRY_BYTES) {
+                    throw std::runtime_error("Line longer than " + std::to_string(CARRY_BYTES >> 20) +
+                                             " MB in " + path_);
+                }
+                const char* begin = data - carry.size();
+                std::memcpy(data - carry.size(), carry.data(), carry.size());
+                const char* end = data + got;
+                carry.clear();
+                if (completed == 1) {
+                    // Skip the header
+                    const char* nl = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+                    begin = nl ? nl + 1 : end;
+                }
+                if (!last) {
+                    // Hold back the trailing partial line for the next buffer
+                    const char* p = end;
+                    while (p > begin && p[-1] != '\n') p--;
+                    carry.assign(p, end);
+                    end = p;
+                }
+                if (begin == end) {
+                    release(f.buffer);
+                } else if (!blocks_.push({f.buffer, begin, end, data_offset - (data - begin)})) {
+                    release(f.buffer);
+                    drain();
+                    return;
+                }
+                if (completed * READ_BYTES >= next_report) {
+                    std::cout << "  Read " << (next_report >> 20) << " MB..." << std::endl;
+                    next_report += 1ULL << 30;
+                }
+            }
+        } catch (...) {
+            drain();
+            throw;
+        }
+    }
+};
+
+// A memory-mapped CSV. Workers claim fixed-size byte ranges; a line belongs
+// to the range holding its first byte, so no reader thread or copy is needed.
+class MmapBatchSource : public TextBatchSource {
+public:
+    static constexpr size_t RANGE_BYTES = 8 << 20;
+
+    MmapBatchSource(const std::string& path, const RowFilter& filter, const BatchColumns& columns)
+        : TextBatchSource(filter, columns), path_(path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open CSV file: " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat CSV file: " + path);
+        }
+        size_ = st.st_size;
+        if (size_ > 0) {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map CSV file: " + path);
+            }
+            data_ = static_cast<const char*>(p);
+            ::madvise(p, size_, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+
+        // Skip the header
+        const char* nl = size_ ? static_cast<const char*>(std::memchr(data_, '\n', size_)) : nullptr;
+        body_ = nl ? nl + 1 - data_ : size_;
+    }
+
+    ~MmapBatchSource() override {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    void start() override {
+        std::cout << "Mapping file (" << (size_ >> 20) << " MB)..." << std::endl;
+    }
+
+    Generator<RowBatch> stream(RowBatch& batch) override {
+        ParseState state;
+        for (;;) {
+            const size_t lo = body_ + next_range_++ * RANGE_BYTES;
+            if (lo >= size_) break;
+            const size_t hi = std::min(lo + RANGE_BYTES, size_);
+            const char* begin = line_start(lo);
+            const char* end = line_start(hi);
+            for (RowBatch& b : parse_text(begin, end, batch, state.at(path_, begin - data_))) co_yield b;
+        }
+    }
+
+    void report() const override {
+        std::cout << "  Mapped " << (size_ >> 20) << " MB" << std::endl;
+    }
+
+private:
+    std::string path_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t body_ = 0;
+    std::atomic<size_t> next_range_{0};
+
+    // First line starting at or after offset
+    const char* line_start(size_t offset) const {
+        if (offset <= body_) return data_ + body_;
+        if (offset >= size_) return data_ + size_;
+        const char* nl = static_cast<const char*>(std::memchr(data_ + offset - 1, '\n', size_ - offset + 1));
+        return nl ? nl + 1 : data_ + size_;
+    }
+};
+
+// A text input read in independent ranges of whole lines, for sources that
+// only touch part of a file or many files at once
+class RangeInput {
+public:
+    virtual ~RangeInput() = default;
+
+    virtual const std::string& path() const = 0;
+    virtual const std::string& header() const = 0;   // first line, no newline
+    virtual size_t size() const = 0;                 // bytes on disk
+    virtual size_t text_size() const { return size(); }   // bytes of text (after inflate)
+    virtual size_t ranges() const = 0;
+
+    // Reads range `index` into `buffer`, setting [begin, end) to its lines
+    // and `offset` to begin's offset in the text; returns the bytes read
+    virtual size_t read_range(size_t index, std::vector<char>& buffer, const char*& begin,
+                              const char*& end, uint64_t& offset) const = 0;
+};
+
+// A CSV read by fixed-size byte ranges with pread. As with mmap ranges, a
+// line belongs to the range holding its first byte.
+class RangeFile : public RangeInput {
+public:
+    static constexpr size_t TAIL_BYTES = 64 << 10;   // read past a range for its last line
+
+    RangeFile(const std::string& path, size_t range_bytes) : path_(path), range_bytes_(range_bytes) {
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error("Cannot open CSV file: " + path);
+        struct stat st;
+        if (::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd_);
+            throw std::runtime_error("Not a regular file: " + path);
+        }
+        size_ = st.st_size;
+
+        // The header ends the first line
+        std::vector<char> head;
+        for (size_t want = TAIL_BYTES;; want *= 2) {
+            const char* nl = read_at(0, want, head);
+            if (nl || head.size() < want) {
+                body_ = nl ? nl + 1 - head.data() : size_;
+                header_.assign(head.data(), nl ? nl - head.data() : head.size());
+                if (!header_.empty() && header_.back() == '\r') header_.pop_back();
+                break;
+            }
+        }
+    }
+
+    ~RangeFile() override { ::close(fd_); }
+    RangeFile(const RangeFile&) = delete;
+    RangeFile& operator=(const RangeFile&) = delete;
+
+    const std::string& path() const override { return path_; }
+    const std::string& header() const override { return header_; }
+    size_t size() const override { return size_; }
+    size_t ranges() const override { return (size_ - body_ + range_bytes_ - 1) / range_bytes_; }
+
+    size_t read_range(size_t index, std::vector<char>& buffer, const char*& begin,
+                      const char*& end, uint64_t& offset) const override {
+        const size_t lo = body_ + index * range_bytes_;
+        const size_t hi = std::min(lo + range_bytes_, size_);
+
+        // From the byte before the range (to see whether a line starts at
+        // lo) until the first line starting at or after hi
+        const size_t from = lo - 1;
+        for (size_t want = hi - from + TAIL_BYTES;; want *= 2) {
+            read_at(from, want, buffer);
+            const char* last = buffer.data() + buffer.size();
+            if (hi < size_) {
+                const char* scan = buffer.data() + (hi - 1 - from);
+                const char* nl = static_cast<const char*>(std::memchr(scan, '\n', last - scan));
+                if (nl) {
+                    end = nl + 1;
+                    break;
+                }
+            }
+            if (hi >= size_ || buffer.size() < want) {   // reached the end of the file
+                end = last;
+                break;
+            }
+        }
+        begin = static_cast<const char*>(std::memchr(buffer.data(), '\n', end - buffer.data()));
+        begin = begin ? begin + 1 : end;
+        offset = from + (begin - buffer.data());
+        return buffer.size();
+    }
+
+private:
+    std::string path_;
+    size_t range_bytes_;
+    std::string header_;
+    int fd_ = -1;
+    size_t size_ = 0;
+    size_t body_ = 0;
+
+    // Reads up to `len` bytes at `offset` into `buffer` (resized to what was
+    // read); returns the first newline in it, if any
+    const char* read_at(size_t offset, size_t len, std::vector<char>& buffer) const {
+        len = std::min(len, size_ - std::min(offset, size_));
+        buffer.resize(len);
+        size_t got = 0;
+        while (got < len) {
+            ssize_t n = ::pread(fd_, buffer.data() + got, len - got, offset + got);
+            if (n < 0) throw std::runtime_error("Error reading CSV file: " + path_);
+            if (n == 0) break;
+            got += n;
+        }
+        buffer.resize(got);
+        return static_cast<const char*>(std::memchr(buffer.data(), '\n', got));
+    }
+};
+
+// Saves a freshly built index beside its file; if that fails, the next run
+// just repeats the sequential pass
+void save_gzip_index(const GzipIndex& index, const std::string& path) {
+    try {
+        index.save(path);
+        std::cout << "  Index saved to " << GzipIndex::sidecar_path(path) << " (" << index.spans()
+                  << " seek points)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cout << "Note: gzip index not saved (" << e.what() << ")" << std::endl;
+    }
+}
+
+// A gzip-compressed CSV read span by span through its seek-point index,
+// built with one sequential pass (and saved beside the file) if there is
+// no current sidecar
+class GzipFile : public RangeInput {
+public:
+    explicit GzipFile(const std::string& path) : path_(path) {
+        if (!index_.load(path)) {
+            std::cout << "Indexing " << path << " (one-time sequential pass)..." << std::endl;
+            index_.build(path);
+            save_gzip_index(index_, path);
+        }
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error("Cannot open gzip file: " + path);
+    }
+
+    ~GzipFile() override { ::close(fd_); }
+    GzipFile(const GzipFile&) = delete;
+    GzipFile& operator=(const GzipFile&) = delete;
+
+    const std::string& path() const override { return path_; }
+    const std::string& header() const override { return index_.header(); }
+    size_t size() const override { return index_.file_size(); }
+    size_t text_size() const override { return index_.total_out(); }
+    size_t ranges() const override { return index_.spans(); }
+
+    size_t read_range(size_t index, std::vector<char>& buffer, const char*& begin,
+                      const char*& end, uint64_t& offset) const override {
+        const size_t first_line = index_.read_span(fd_, index, buffer);
+        begin = buffer.data() + first_line;
+        end = buffer.data() + buffer.size();
+        offset = index_.span_offset(index) + first_line;
+        return buffer.size();
+    }
+
+private:
+    std::string path_;
+    GzipIndex index_;
+    int fd_ = -1;
+};
+
+std::unique_ptr<RangeInput> open_range_input(const std::string& path, size_t range_bytes) {
+    if (GzipIndex::is_gzip(path)) return std::make_unique<GzipFile>(path);
+    return std::make_unique<RangeFile>(path, range_bytes);
+}
+
+// Randomly chosen blocks of a CSV (--sample). The body is cut into
+// BLOCK_BYTES blocks and a stratified sample of them is read; the rest of
+// the file is never touched, and each row is read with probability blocks
+// read / blocks in the file. Files are time-major, so a block is a slice of
+// consecutive hours across all nodes and the sample spreads each node's
+// rows over the whole period.
+class SampledCsvBatchSource : public TextBatchSource {
+public:
+    static constexpr size_t BLOCK_BYTES = 1 << 20;
+
+    SampledCsvBatchSource(const std::string& path, const RowFilter& filter, const BatchColumns& columns,
+                          double fraction, uint64_t seed)
+        : TextBatchSource(filter, columns), file_(path, BLOCK_BYTES) {
+        num_blocks_ = file_.ranges();
+        picks_ = stratified_sample(num_blocks_, fraction, seed);
+    }
+
+    void start() override {
+        std::cout << "Sampling " << picks_.size() << " of " << num_blocks_ << " blocks ("
+                  << (file_.size() >> 20) << " MB file)..." << std::endl;
+    }
+
+    Generator<RowBatch> stream(RowBatch& batch) override {
+        ParseState state;
+        std::vector<char> buffer;
+        for (;;) {
+            const size_t index = next_pick_++;
+            if (index >= picks_.size()) break;
+
+            auto& metrics = thread_metrics();
+            StageClock clock;
+            const char* begin;
+            const char* end;
+            uint64_t offset;
+            bytes_read_ += file_.read_range(picks_[index], buffer, begin, end, offset);
+            clock.lap(metrics.stages[STAGE_READ]);
+            batch.unit = static_cast<uint32_t>(index);
+            for (RowBatch& b : parse_text(begin, end, batch, state.at(file_.path(), offset))) co_yield b;
+        }
+    }
+
+    void report() const override {
+        std::cout << "  Sampled " << picks_.size() << " of " << num_blocks_ << " blocks, "
+                  << (bytes_read_ >> 20) << " MB of " << (file_.size() >> 20) << " MB read ("
+                  << 100.0 * sampled_fraction() << "% of rows)" << std::endl;
+    }
+
+    double sampled_fraction() const override {
+        return num_blocks_ ? static_cast<double>(picks_.size()) / num_blocks_ : 1.0;
+    }
+
+private:
+    RangeFile file_;
+    size_t num_blocks_ = 0;
+    std::vector<size_t> picks_;
+    std::atomic<size_t> next_pick_{0};
+    std::atomic<size_t> bytes_read_{0};
+};
+
+// Several CSVs scanned as one dataset (a list, directory or glob). Files are
+// queued largest first (by text size, for compressed ones) and cut into RANGE_BYTES ranges any worker can
+// claim, so a large file is split across workers and the small ones fill
+// in at the end. Each file's columns are bound by its own header.
+class MultiFileBatchSource : public TextBatchSource {
+public:
+    static constexpr size_t RANGE_BYTES = 8 << 20;
+
+    MultiFileBatchSource(const std::vector<std::string>& paths, const RowFilter& filter,
+                         const BatchColumns& columns)
+        : TextBatchSource(filter, columns) {
+        for (const auto& path : paths) {
+            auto input = std::make_unique<InputFile>(open_range_input(path, RANGE_BYTES));
+            input->binding = ColumnBinding::bind(input->file->header(), path);
+            inputs_.push_back(std::move(input));
+        }
+        std::stable_sort(inputs_.begin(), inputs_.end(), [](const auto& a, const auto& b) {
+            return a->file->text_size() > b->file->text_size();
+        });
+        for (uint32_t f = 0; f < inputs_.size(); f++) {
+            const size_t ranges = inputs_[f]->file->ranges();
+            for (size_t r = 0; r < ranges; r++) units_.push_back({f, r});
+        }
+    }
+
+    void start() override {
+        size_t total = 0;
+        for (const auto& input : inputs_) total += input->file->size();
+        std::cout << "Reading " << inputs_.size() << (inputs_.size() == 1 ? " file (" : " files (")
+                  << (total >> 20) << " MB, largest first)..." << std::endl;
+        for (const auto& input : inputs_) {
+            if (!input->binding.identity) {
+                std::cout << "  " << input->file->path() << ": columns reordered by header" << std::endl;
+            }
+        }
+    }
+
+    Generator<RowBatch> stream(RowBatch& batch) override {
+        using Clock = std::chrono::steady_clock;
+        ParseState state;
+        std::vector<char> buffer;
+        for (;;) {
+            const size_t index = next_unit_++;
+            if (index >= units_.size()) break;
+            InputFile& input = *inputs_[units_[index].file];
+
+            // Time spent here, not while the batches are being aggregated
+            auto& metrics = thread_metrics();
+            const long long lines = metrics.lines, invalid = metrics.invalid;
+            Clock::duration busy{};
+            auto resumed = Clock::now();
+
+            StageClock clock;
+            const char* begin;
+            const char* end;
+            uint64_t offset;
+            input.file->read_range(units_[index].range, buffer, begin, end, offset);
+            clock.lap(metrics.stages[STAGE_READ]);
+            for (RowBatch& b : parse_text(begin, end, batch, state.at(input.file->path(), offset),
+                                          &input.binding)) {
+                busy += Clock::now() - resumed;
+                co_yield b;
+                resumed = Clock::now();
+            }
+            busy += Clock::now() - resumed;
+
+            input.lines += metrics.lines - lines;
+            input.invalid += metrics.invalid - invalid;
+            input.busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count();
+        }
+    }
+
+    void report() const override {
+        std::cout << "  Files (rows, read+parse seconds summed over workers):" << std::endl;
+        for (const auto& input : inputs_) {
+            std::cout << "    " << input->file->path() << ": " << input->lines << " rows";
+            if (input->invalid > 0) std::cout << " (" << input->invalid << " malformed)";
+            std::cout << ", " << (input->file->size() >> 20) << " MB, " << input->busy_ns / 1e9 << "s"
+                      << std::endl;
+        }
+    }
+
+private:
+    struct InputFile {
+        explicit InputFile(std::unique_ptr<RangeInput> input) : file(std::move(input)) {}
+        std::unique_ptr<RangeInput> file;
+        ColumnBinding binding;
+        std::atomic<long long> lines{0};
+        std::atomic<long long> invalid{0};
+        std::atomic<long long> busy_ns{0};
+    };
+    struct Unit {
+        uint32_t file;
+        size_t range;
+    };
+
+    std::vector<std::unique_ptr<InputFile>> inputs_;
+    std::vector<Unit> units_;
+    std::atomic<size_t> next_unit_{0};
+};
+
+// A gzip CSV without a current index: one thread inflates it in order,
+// handing blocks of whole lines to the workers, and records the seek points
+// as it goes. Later runs read the file in parallel through the saved index.
+class GzipStreamBatchSource : public TextBatchSource {
+public:
+    static constexpr size_t BLOCK_BYTES = 8 << 20;
+
+    GzipStreamBatchSource(const std::string& path, const RowFilter& filter, const BatchColumns& columns,
+                          int workers)
+        : TextBatchSource(filter, columns), path_(path), blocks_(workers * 2) {}
+
+    ~GzipStreamBatchSource() override {
+        if (reader_thread_.joinable()) {
+            blocks_.close();
+            reader_thread_.join();
+        }
+    }
+
+    void start() override {
+        std::cout << "Decompressing " << path_ << " (indexing for parallel reads next time)..." << std::endl;
+        reader_thread_ = std::thread([this]() {
+            ThreadScope scope("reader");
+            std::string block;
+            uint64_t offset = 0;   // of the block in the decompressed text
+            bool body = false;
+            bool open = true;
+            auto sink = [&](const char* data, size_t n) {
+                if (!body) {
+                    // The index has the whole header once its newline arrives
+                    const char* nl = static_cast<const char*>(std::memchr(data, '\n', n));
+                    if (!nl) {
+                        offset += n;
+                        return;
+                    }
+                    binding_ = ColumnBinding::bind(index_.header(), path_);
+                    offset += nl + 1 - data;
+                    n -= nl + 1 - data;
+                    data = nl + 1;
+                    body = true;
+                }
+                block.append(data, n);
+                if (block.size() >= BLOCK_BYTES && open) {
+                    // Hold back the trailing partial line for the next block
+                    const size_t last_newline = block.rfind('\n');
+                    if (last_newline == std::string::npos) return;
+                    std::string rest = block.substr(last_newline + 1);
+                    block.resize(last_newline + 1);
+                    const uint64_t next = offset + block.size();
+                    open = blocks_.push({std::move(block), offset});
+                    block = std::move(rest);
+                    offset = next;
+                }
+            };
+            try {
+                StageClock clock;
+                index_.build(path_, sink);
+                clock.lap(thread_metrics().stages[STAGE_READ]);
+                if (!block.empty() && open) blocks_.push({std::move(block), offset});
+                indexed_ = open;
+            } catch (const std::exception& e) {
+                error_ = e.what();
+            }
+            blocks_.close();
+        });
+    }
+
+    Generator<RowBatch> stream(RowBatch& batch) override {
+        TextBlock block;
+        ParseState state;
+        while (blocks_.pop(block)) {
+            const std::string& text = block.text;
+            for (RowBatch& b : parse_text(text.data(), text.data() + text.size(), batch,
+                                          state.at(path_, block.offset), &binding_)) {
+                co_yield b;
+            }
+        }
+    }
+
+    void finish() override {
+        if (reader_thread_.joinable()) reader_thread_.join();
+        blocks_.report_depths("blocks");
+        if (!error_.empty()) throw std::runtime_error(error_);
+        if (indexed_) save_gzip_index(index_, path_);
+    }
+
+    void report() const override {
+        std::cout << "  Decompressed " << (index_.total_out() >> 20) << " MB from "
+                  << (index_.file_size() >> 20) << " MB" << std::endl;
+    }
+
+private:
+    std::string path_;
+    GzipIndex index_;
+    ColumnBinding binding_;   // set by the reader before the first block is queued
+    BoundedQueue<TextBlock> blocks_;
+    std::thread reader_thread_;
+    std::string error_;
+    bool indexed_ = false;
+};
+
+// Blocks of a .lmpb store. Zone maps skip whole blocks; the filter operator
+// applies the filters to the rest. With a sample fraction, a stratified
+// sample of the remaining blocks is read instead.
+class StoreBatchSource : public BatchSource {
+public:
+    StoreBatchSource(const std::string& path, const RowFilter& filter, const BatchColumns& columns,
+                     double sample, uint64_t seed)
+        : store_(path), columns_(columns) {
+        candidates_ = store_.candidate_blocks(filter);
+        if (sample > 0) {
+            sample_from_ = candidates_.size();
+            std::vector<uint32_t> picked;
+            for (size_t pick : stratified_sample(candidates_.size(), sample, seed)) {
+                picked.push_back(candidates_[pick]);
+            }
+            candidates_ = std::move(picked);
+        }
+        long long candidate_rows = 0;
+        for (uint32_t index : candidates_) candidate_rows += store_.stats(index).rows;
+        run_metrics().add_skipped(static_cast<long long>(store_.total_rows()) - candidate_rows);
+        for (size_t z = 0; z < store_.num_zones(); z++) {
+            zone_map_.push_back(zones_.intern(store_.zone_name(static_cast<uint16_t>(z))));
+        }
+
+        read_columns_ = READ_SPREAD;
+        if (columns.components) read_columns_ |= READ_COMPONENTS;
+        if (columns.loss) read_columns_ |= READ_LOSS;
+    }
+
+    void start() override {
+        std::cout << "Scanning store (" << store_.num_blocks() << " blocks"
+                  << (store_.fixed_point() ? ", fixed-point" : "") << ")..." << std::endl;
+    }
+
+    Generator<RowBatch> stream(RowBatch& batch) override {
+        StoreBlock block;
+        const bool fixed_store = store_.fixed_point();
+        for (;;) {
+            size_t index = next_block_++;
+            if (index >= candidates_.size()) break;
+
+            auto& metrics = thread_metrics();
+            StageClock clock;
+            store_.read_block(candidates_[index], block, read_columns_);
+            clock.lap(metrics.stages[STAGE_READ]);
+            batch.unit = static_cast<uint32_t>(index);
+            rows_scanned_ += block.rows;
+            metrics.lines += block.rows;
+            const auto& p = block.prices;
+
+            for (uint32_t offset = 0; offset < block.rows; offset += BATCH_ROWS) {
+                const uint32_t n = std::min(BATCH_ROWS, block.rows - offset);
+                batch.size = n;
+                std::memcpy(batch.pnode_id.data(), &block.pnode_id[offset], n * sizeof(int32_t));
+                std::memcpy(batch.hour_stamp.data(), &block.hour_stamp[offset], n * sizeof(int32_t));
+                for (uint32_t i = 0; i < n; i++) batch.zone_id[i] = zone_map_[block.zone_id[offset + i]];
+
+                auto copy = [&](std::vector<double>& dst, int column) {
+                    std::memcpy(dst.data(), &p[column][offset], n * sizeof(double));
+                };
+                copy(batch.spread, SC_SPREAD);
+                if (columns_.components) {
+                    copy(batch.cong_da, SC_CONG_DA);
+                    copy(batch.cong_rt, SC_CONG_RT);
+                    copy(batch.energy_da, SC_ENERGY_DA);
+                    copy(batch.energy_rt, SC_ENERGY_RT);
+                }
+                if (columns_.loss) {
+                    copy(batch.loss_da, SC_LOSS_DA);
+                    copy(batch.loss_rt, SC_LOSS_RT);
+                }
+                batch.fixed_runs = fixed_store;
+                if (fixed_store) {
+                    const int32_t* fixed = &block.fixed[SC_SPREAD][offset];
+                    for (uint32_t i = 0; i < n; i++) batch.spread_fixed[i] = fixed[i];
+                } else if (columns_.fixed) {
+                    for (uint32_t i = 0; i < n; i++) batch.spread_fixed[i] = to_fixed(batch.spread[i]);
+                }
+
+                select_all(batch);
+                co_yield batch;
+            }
+        }
+    }
+
+    void report() const override {
+        std::cout << "  Blocks read: " << store_.blocks_read() << " of " << store_.num_blocks()
+                  << " (" << store_.num_blocks() - candidates_.size() << " skipped by zone maps)"
+                  << std::endl;
+        std::cout << "  Bytes read: " << (store_.bytes_read() >> 20) << " MB of "
+                  << (store_.data_bytes() >> 20) << " MB" << std::endl;
+        if (sample_from_ > 0) {
+            std::cout << "  Sampled " << candidates_.size() << " of " << sample_from_ << " candidate blocks ("
+                      << 100.0 * sampled_fraction() << "% of rows)" << std::endl;
+        }
+    }
+
+    double sampled_fraction() const override {
+        return sample_from_ ? static_cast<double>(candidates_.size()) / sample_from_ : 1.0;
+    }
+
+private:
+    ColumnStore store_;
+    BatchColumns columns_;
+    std::vector<uint32_t> candidates_;
+    size_t sample_from_ = 0;           // candidates before sampling (0 = not sampled)
+    std::vector<uint16_t> zone_map_;   // store zone id -> dictionary id
+    unsigned read_columns_ = READ_SPREAD;
+    std::atomic<size_t> next_block_{0};
+};
+
+// Rows generated on demand, BATCH_ROWS at a time
+class SyntheticBatchSource : public BatchSource {
+public:
+    SyntheticBatchSource(const std::string& spec, const BatchColumns& columns)
+        : spec_(parse_synthetic_spec(spec)), columns_(columns) {
+        for (int z = 0; z < synthetic_zone_count(); z++) {
+            zone_map_.push_back(zones_.intern(synthetic_zone(z)));
+        }
+    }
+
+    void start() override {
+        std::cout << "Generating " << spec_.rows() << " synthetic rows (" << spec_.nodes
+                  << " nodes x " << spec_.hours << " hours, seed " << spec_.seed << ")..." << std::endl;
+    }
+
+    Generator<RowBatch> stream(RowBatch& batch) override {
+        batch.fixed_runs = false;
+        SyntheticCursor cursor(spec_);
+        for (;;) {
+            uint64_t first = next_batch_++ * BATCH_ROWS;
+            if (first >= spec_.rows()) break;
+            const uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(BATCH_ROWS, spec_.rows() - first));
+
+            batch.size = n;
+            cursor.seek(first);
+            for (uint32_t i = 0; i < n; i++) {
+                SyntheticRow row = cursor.next();
+                batch.pnode_id[i] = row.pnode_id;
+                batch.hour_stamp[i] = row.hour_stamp;
+                batch.zone_id[i] = zone_map_[row.zone_index];
+                batch.spread[i] = row.spread;
+                batch.cong_da[i] = row.cong_da;
+                batch.cong_rt[i] = row.cong_rt;
+                batch.energy_da[i] = row.energy_da;
+                batch.energy_rt[i] = row.energy_rt;
+                batch.loss_da[i] = row.loss_da;
+                batch.loss_rt[i] = row.loss_rt;
+                if (columns_.fixed) batch.spread_fixed[i] = to_fixed(row.spread);
+            }
+            rows_scanned_ += n;
+            thread_metrics().lines += n;
+
+            select_all(batch);
+            co_yield batch;
+        }
+    }
+
+private:
+    SyntheticSpec spec_;
+    BatchColumns columns_;
+    std::vector<uint16_t> zone_map_;
+    std::atomic<uint64_t> next_batch_{0};
+};
+
+} // namespace
+
+bool is_multi_input(const std::vector<std::string>& inputs) {
+    if (inputs.size() != 1) return inputs.size() > 1;
+    const std::string& path = inputs[0];
+    if (is_synthetic_spec(path) || path == "-" || path.rfind("mmap:", 0) == 0) return false;
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error)) return true;
+    return path.find_first_of(",*?[") != std::string::npos && !std::filesystem::exists(path, error);
+}
+
+std::vector<std::string> expand_inputs(const std::vector<std::string>& inputs) {
+    // An input no file is named after may be a comma-separated list
+    std::vector<std::string> items;
+    for (const auto& input : inputs) {
+        std::error_code error;
+        if (input.find(',') == std::string::npos || std::filesystem::exists(input, error)) {
+            items.push_back(input);
+            continue;
+        }
+        size_t start = 0;
+        while (start <= input.size()) {
+            size_t comma = input.find(',', start);
+            if (comma == std::string::npos) comma = input.size();
+            if (comma > start) items.push_back(input.substr(start, comma - start));
+            start = comma + 1;
+        }
+    }
+
+    std::vector<std::string> files;
+    for (const auto& item : items) {
+        std::error_code error;
+        std::vector<std::string> matches;
+        if (std::filesystem::is_directory(item, error)) {
+            for (const auto& entry : std::filesystem::directory_iterator(item)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".csv") {
+                    matches.push_back(entry.path().string());
+                }
+            }
+            if (matches.empty()) throw std::runtime_error("No .csv files in directory: " + item);
+        } else if (item.find_first_of("*?[") != std::string::npos && !std::filesystem::exists(item, error)) {
+            glob_t found;
+            if (::glob(item.c_str(), 0, nullptr, &found) == 0) {
+                for (size_t i = 0; i < found.gl_pathc; i++) matches.push_back(found.gl_pathv[i]);
+            }
+            ::globfree(&found);
+            if (matches.empty()) throw std::runtime_error("No files match: " + item);
+        } else {
+            matches.push_back(item);
+        }
+        std::sort(matches.begin(), matches.end());
+        for (auto& match : matches) {
+            if (ColumnStore::is_store(match) || is_synthetic_spec(match)) {
+                throw std::runtime_error("Multi-file input takes CSV files: " + match);
+            }
+            files.push_back(std::move(match));
+        }
+    }
+    if (files.empty()) throw std::runtime_error("No input files given");
+    return files;
+}
+
+std::string text_input_path(const std::string& path) {
+    if (is_synthetic_spec(path)) return "";
+    if (path == "-") return "/dev/stdin";
+    if (path.rfind("mmap:", 0) == 0) return path.substr(5);
+    if (ColumnStore::is_store(path) || is_multi_input({path}) || GzipIndex::is_gzip(path)) return "";
+    return path;
+}
+
+namespace {
+
+std::unique_ptr<BatchSource> open_source(const std::vector<std::string>& inputs, const RowFilter& filter,
+                                         const BatchColumns& columns, int workers,
+                                         double sample, uint64_t sample_seed, IoMode io) {
+    const std::string& path = inputs.front();
+    if (sample > 0) {
+        if (is_synthetic_spec(path) || path == "-" || is_multi_input(inputs) || GzipIndex::is_gzip(path)) {
+            throw std::runtime_error("--sample needs a single uncompressed CSV file or .lmpb store");
+        }
+        if (ColumnStore::is_store(path)) {
+            return std::make_unique<StoreBatchSource>(path, filter, columns, sample, sample_seed);
+        }
+        return std::make_unique<SampledCsvBatchSource>(text_input_path(path), filter, columns, sample,
+                                                       sample_seed);
+    }
+    if (is_synthetic_spec(path)) {
+        return std::make_unique<SyntheticBatchSource>(path, columns);
+    }
+    if (is_multi_input(inputs)) {
+        return std::make_unique<MultiFileBatchSource>(expand_inputs(inputs), filter, columns);
+    }
+    if (path == "-") {
+        return std::make_unique<CsvBatchSource>("/dev/stdin", filter, columns, workers);
+    }
+    if (path.rfind("mmap:", 0) == 0) {
+        return std::make_unique<MmapBatchSource>(path.substr(5), filter, columns);
+    }
+    if (ColumnStore::is_store(path)) {
+        return std::make_unique<StoreBatchSource>(path, filter, columns, 0.0, 0);
+    }
+    if (GzipIndex::is_gzip(path)) {
+        if (GzipIndex::sidecar_current(path)) {
+            return std::make_unique<MultiFileBatchSource>(std::vector<std::string>{path}, filter, columns);
+        }
+        return std::make_unique<GzipStreamBatchSource>(path, filter, columns, workers);
+    }
+    struct stat st;
+    if (io == IoMode::Stream || ::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return std::make_unique<CsvBatchSource>(path, filter, columns, workers);
+    }
+    return std::make_unique<AsyncCsvBatchSource>(path, filter, columns, workers, io);
+}
+
+} // namespace
+
+std::unique_ptr<BatchSource> open_batch_source(const std::vector<std::string>& inputs,
+                                               const RowFilter& filter,
+                                               const BatchColumns& columns, int workers,
+                                               DataQuality& quality,
+                                               double sample, uint64_t sample_seed, IoMode io) {
+    if (inputs.empty()) throw std::runtime_error("No input files given");
+    auto source = open_source(inputs, filter, columns, workers, sample, sample_seed, io);
+    source->record_quality_in(quality);
+    return source;
+}
@@ -0,0 +1,191 @@
+#pragma once
+#include "accumulator.h"
+#include "fast_parser.h"
+#include "generator.h"
+#include "uring.h"
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Columnar batch execution. Sources (CSV text, mmap, stdin, .lmpb store,
+// synthetic generator) fill fixed-size batches of column vectors; derived
+// columns, filters and aggregation then run as tight loops over those
+// columns, so the analytics are written once for every input.
+
+const uint32_t BATCH_ROWS = 4096;
+
+class DataQuality;
+
+// Which price columns a consumer needs; sources leave the rest untouched
+struct BatchColumns {
+    bool components = true;   // congestion and energy, DA and RT
+    bool loss = true;
+    bool fixed = false;       // spread_fixed for Exact<Spread>
+};
+
+struct RowBatch {
+    uint32_t size = 0;
+    std::vector<int32_t> pnode_id;
+    std::vector<int32_t> hour_stamp;
+    std::vector<uint16_t> zone_id;    // ZoneDictionary id
+    std::vector<double> spread;
+    std::vector<double> cong_da, cong_rt;
+    std::vector<double> energy_da, energy_rt;
+    std::vector<double> loss_da, loss_rt;
+    std::vector<int64_t> spread_fixed;
+
+    // Derived by derive_columns()
+    std::vector<uint8_t> hour;
+    std::vector<double> cong_spread, energy_spread, loss_spread;
+
+    // Selection vector: indices of the rows that passed the filters
+    std::vector<uint16_t> sel;
+    uint32_t selected = 0;
+
+    // spread_fixed holds int32-range values grouped by node (fixed-point
+    // stores), so runs can go through reduce_fixed()
+    bool fixed_runs = false;
+
+    // Which of a sampled source's blocks the rows came from
+    uint32_t unit = 0;
+
+    RowBatch();
+};
+
+// Zone names interned to small ids so rows stay fixed-size
+class ZoneDictionary {
+public:
+    uint16_t intern(const std::string& zone) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto [it, inserted] = ids_.emplace(zone, static_cast<uint16_t>(names_.size()));
+        if (inserted) names_.push_back(zone);
+        return it->second;
+    }
+
+    std::string name(uint16_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return names_[id];
+    }
+
+    // -1 if the zone was never seen
+    int find(const std::string& zone) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = ids_.find(zone);
+        return it == ids_.end() ? -1 : it->second;
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, uint16_t> ids_;
+    std::vector<std::string> names_;
+};
+
+// Kernels
+void derive_columns(RowBatch& batch, const BatchColumns& columns);
+void select_all(RowBatch& batch);
+// Narrow the current selection to rows passing the filter; filter_zone is
+// the filter's zone as a ZoneDictionary id (-1 when unknown)
+void select_rows(RowBatch& batch, const RowFilter& filter, int filter_zone);
+
+// A source hands out units of work (a text block, a store block, a range of
+// synthetic rows) as batches with every row selected. Each worker runs its
+// own stream() over a private batch; the streams share the source's work
+// and end once it is exhausted.
+class BatchSource {
+public:
+    virtual ~BatchSource() = default;
+
+    virtual void start() {}
+    virtual Generator<RowBatch> stream(RowBatch& batch) = 0;
+    virtual void finish() {}
+
+    // Whether rows failing the filter are already dropped by the source
+    virtual bool applies_filter() const { return false; }
+
+    // I/O or pruning summary printed after the scan
+    virtual void report() const {}
+
+    // Probability that any given row was read (below 1 for sampled scans)
+    virtual double sampled_fraction() const { return 1.0; }
+
+    ZoneDictionary& zones() { return zones_; }
+    long long rows_scanned() const { return rows_scanned_.load(); }
+
+    // Where text sources record invalid and duplicate lines
+    void record_quality_in(DataQuality& quality) { quality_ = &quality; }
+
+protected:
+    ZoneDictionary zones_;
+    std::atomic<long long> rows_scanned_{0};
+    DataQuality* quality_ = nullptr;
+};
+
+// Inputs: a CSV path, "-" for stdin, "mmap:<csv>", a .lmpb store,
+// "synthetic:NODESxHOURS[:SEED]", or several CSVs (see is_multi_input). The filter lets sources prune or push it
+// down; workers is the number of concurrent streams. With sample > 0 only
+// that share of the input's blocks is read, chosen at random (by
+// sample_seed) within equal strata; CSV files and stores only. `io` picks
+// how a single uncompressed CSV file is read. Line issues go to `quality`.
+std::unique_ptr<BatchSource> open_batch_source(const std::vector<std::string>& inputs,
+                                               const RowFilter& filter,
+                                               const BatchColumns& columns, int workers,
+                                               DataQuality& quality,
+                                               double sample = 0.0, uint64_t sample_seed = 1,
+                                               IoMode io = IoMode::Uring);
+
+// True for inputs naming several CSVs read as one dataset: more than one
+// path, or one that is a directory (its *.csv files), a glob pattern or a
+// comma-separated list (unless a file has that very name)
+bool is_multi_input(const std::vector<std::string>& inputs);
+
+// The CSV files multi-file inputs name, in order, each item's matches sorted
+std::vector<std::string> expand_inputs(const std::vector<std::string>& inputs);
+
+// The CSV file behind a text input ("-" and "mmap:" included); empty for
+// stores, synthetic specs and multi-file inputs
+std::string text_input_path(const std::string& path);
+
+// Update node accumulators from the selected rows of a batch. The
+// accumulator is looked up once per run of rows from the same node.
+template <typename Acc>
+void aggregate_batch(const RowBatch& b, std::unordered_map<int, Acc>& nodes, ZoneDictionary& zones) {
+    Acc* acc = nullptr;
+    int current = INT_MIN;
+    for (uint32_t k = 0; k < b.selected; k++) {
+        const uint32_t i = b.sel[k];
+        const int pnode_id = b.pnode_id[i];
+        if (pnode_id != current) {
+            current = pnode_id;
+            acc = &nodes[pnode_id];
+            if (acc->n == 0 && acc->zone.empty()) {
+                acc->zone = zones.name(b.zone_id[i]);
+                acc->pnode_id = pnode_id;
+            }
+        }
+
+        if constexpr (Acc::run_updatable) {
+            if (b.fixed_runs) {
+                // Contiguous selected rows of this node reduce in one pass
+                uint32_t end = k + 1;
+                while (end < b.selected && b.sel[end] == i + (end - k) &&
+                       b.pnode_id[b.sel[end]] == pnode_id) {
+                    end++;
+                }
+                int32_t run[BATCH_ROWS];
+                const uint32_t len = end - k;
+                for (uint32_t j = 0; j < len; j++) run[j] = static_cast<int32_t>(b.spread_fixed[i + j]);
+                acc->update_run(reduce_fixed(run, len), acc->zone, pnode_id);
+                k = end - 1;
+                continue;
+            }
+        }
+
+        Sample sample{b.spread[i], b.cong_spread[i], b.energy_spread[i], b.loss_spread[i],
+                      b.hour[i], b.spread_fixed[i]};
+        acc->update(sample, acc->zone, pnode_id);
+    }
+}
@@ -0,0 +1,423 @@
+// Micro-benchmarks for the scan hot paths: field parsers, the row parser,
+// accumulator updates and merges, result calculation and the output writers.
+//
+//   lmp_bench [--filter SUBSTR] [--min-time SECONDS] [--nodes N] [--hours H]
+//             [--seed S] [--out PATH]
+//
+// Inputs come from the synthetic generator with a fixed seed, so two builds
+// see identical data. Each benchmark warms up, sizes its batch to the time
+// budget, then takes several timed samples; ns/op is the median sample and
+// bytes/s the input (or output) bytes per op at that rate. Results go to a
+// CSV (../output/lmp_bench.csv by default) for comparing builds.
+#include "scanner.h"
+#include "csv_writer.h"
+#include "synthetic.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const int SAMPLES = 5;
+
+// Keeps a value alive without the compiler seeing what happens to it
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Discards std::cout while in scope; the scanner stages log as they go
+class Quiet {
+public:
+    Quiet() : saved_(std::cout.rdbuf(&null_)) {}
+    ~Quiet() { std::cout.rdbuf(saved_); }
+
+private:
+    struct NullBuffer : std::streambuf {
+        int overflow(int c) override { return c; }
+    } null_;
+    std::streambuf* saved_;
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<void(uint64_t ops)> run;
+    double bytes_per_op = 0.0;           // 0 when bytes don't apply
+    std::function<void()> reset = {};    // before each sample, untimed
+};
+
+struct BenchResult {
+    std::string name;
+    uint64_t ops_per_sample;
+    double ns_per_op;       // median sample
+    double min_ns_per_op;
+    double bytes_per_op;
+
+    double bytes_per_s() const { return ns_per_op > 0 ? bytes_per_op * 1e9 / ns_per_op : 0.0; }
+};
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+BenchResult measure(const Benchmark& bench, double min_time) {
+    Quiet quiet;
+    auto timed = [&](uint64_t ops) {
+        if (bench.reset) bench.reset();
+        auto start = std::chrono::steady_clock::now();
+        bench.run(ops);
+        return seconds_since(start);
+    };
+
+    // Warm caches and branch predictors, growing the batch until it takes
+    // a tenth of a sample
+    const double sample_time = min_time / SAMPLES;
+    uint64_t ops = 1;
+    double elapsed = timed(ops);
+    while (elapsed < sample_time / 10) {
+        ops *= elapsed > 0 ? std::clamp<uint64_t>(static_cast<uint64_t>(sample_time / 10 / elapsed), 2, 100) : 100;
+        elapsed = timed(ops);
+    }
+    ops = std::max<uint64_t>(1, static_cast<uint64_t>(ops * sample_time / elapsed));
+
+    std::vector<double> ns;
+    for (int s = 0; s < SAMPLES; s++) ns.push_back(timed(ops) * 1e9 / ops);
+    std::sort(ns.begin(), ns.end());
+    return {bench.name, ops, ns[SAMPLES / 2], ns.front(), bench.bytes_per_op};
+}
+
+// Synthetic rows rendered as merged CSV lines
+struct TextRows {
+    std::string text;
+    std::vector<size_t> starts;   // line i is text[starts[i], starts[i + 1] - 1)
+    std::vector<SyntheticRow> rows;
+
+    size_t count() const { return rows.size(); }
+    const char* line(size_t i) const { return text.data() + starts[i]; }
+    size_t length(size_t i) const { return starts[i + 1] - 1 - starts[i]; }
+};
+
+TextRows make_rows(const SyntheticSpec& spec, size_t count) {
+    TextRows rows;
+    char line[SYNTHETIC_MAX_LINE];
+    for (size_t i = 0; i < count; i++) {
+        rows.rows.push_back(synthesize_row(spec, i % spec.rows()));
+        rows.starts.push_back(rows.text.size());
+        rows.text.append(line, format_synthetic_row(rows.rows.back(), line));
+    }
+    rows.starts.push_back(rows.text.size());
+    return rows;
+}
+
+// One column's fields joined with commas, for the single-field parsers
+struct FieldRun {
+    std::string text;
+    size_t count = 0;
+};
+
+template <typename Format>
+FieldRun join_fields(const TextRows& rows, Format format) {
+    FieldRun run;
+    char field[64];
+    for (const auto& row : rows.rows) {
+        run.text.append(field, format(row, field));
+        run.text += ',';
+        run.count++;
+    }
+    return run;
+}
+
+template <bool Components, bool WithLoss, bool Fixed>
+Benchmark row_parser(const char* name, const TextRows& text, double line_bytes) {
+    return {name, [&text](uint64_t ops) {
+        int pnode_id = 0, hour = 0, hour_stamp = 0;
+        char zone[32] = "";
+        double spread = 0.0, cong_da = 0.0, cong_rt = 0.0, energy_da = 0.0, energy_rt = 0.0;
+        double loss_da = 0.0, loss_rt = 0.0;
+        int64_t fixed[7] = {};
+        for (uint64_t i = 0; i < ops; i++) {
+            size_t r = i & (text.count() - 1);
+            bool ok = CSVRowParser::parse<Components, WithLoss, Fixed>(
+                text.line(r), text.length(r), pnode_id, zone, spread, cong_da, cong_rt,
+                energy_da, energy_rt, loss_da, loss_rt, hour, hour_stamp, nullptr, fixed);
+            keep(ok);
+            keep(spread);
+            keep(loss_rt);
+        }
+    }, line_bytes};
+}
+
+Sample make_sample(const SyntheticRow& row) {
+    Sample s;
+    s.spread = row.spread;
+    s.cong_spread = row.cong_da - row.cong_rt;
+    s.energy_spread = row.energy_da - row.energy_rt;
+    s.loss_spread = row.loss_da - row.loss_rt;
+    s.hour = row.hour_stamp % 24;
+    s.spread_fixed = to_fixed(row.spread);
+    return s;
+}
+
+} // namespace
+
+// Drives LMPScanner's private stages (friend of LMPScanner)
+class ScannerBench {
+public:
+    explicit ScannerBench(const SyntheticSpec& spec)
+        : scanner_({"synthetic:" + std::to_string(spec.nodes) + "x" + std::to_string(spec.hours) + ":" +
+                    std::to_string(spec.seed)}) {
+        Quiet quiet;
+        scanner_.analyze();
+
+        // Intra-hour volatility only exists for 5-minute inputs; fill it
+        // from twelve jittered intervals per synthetic hour
+        for (uint64_t i = 0; i < std::min<uint64_t>(spec.rows(), uint64_t(spec.nodes) * 24); i++) {
+            SyntheticRow row = synthesize_row(spec, i);
+            HourBucket bucket;
+            for (int k = 0; k < 12; k++) {
+                double jitter = (static_cast<int>((i * 12 + k) % 7) - 3) * 0.8;
+                bucket.add(row.spread + jitter, row.cong_da - row.cong_rt + jitter,
+                           row.energy_da - row.energy_rt, row.loss_da - row.loss_rt);
+            }
+            scanner_.intrahour_data_[row.pnode_id].add(bucket);
+        }
+    }
+
+    size_t nodes() const { return scanner_.node_data_.size(); }
+    size_t results() const { return scanner_.results_.size(); }
+
+    void calculate_results() {
+        scanner_.results_.clear();
+        scanner_.calculate_results();
+    }
+
+    void calculate_zone_summaries() {
+        scanner_.zone_summaries_.clear();
+        scanner_.calculate_zone_summaries();
+    }
+
+    using Writer = std::string (LMPScanner::*)();
+    void write(Writer writer) { (scanner_.*writer)(); }
+
+    static std::vector<std::pair<std::string, Writer>> writers() {
+        return {
+            {"node_rankings.csv", &LMPScanner::write_node_rankings},
+            {"zone_summary.csv", &LMPScanner::write_zone_summary},
+            {"component_analysis.csv", &LMPScanner::write_component_analysis},
+            {"hourly_patterns.csv", &LMPScanner::write_hourly_patterns},
+            {"intrahour_volatility.csv", &LMPScanner::write_intrahour_volatility},
+            {"summary_report.txt", &LMPScanner::write_summary_report},
+        };
+    }
+
+private:
+    LMPScanner scanner_;
+};
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    std::string out_path = "../output/lmp_bench.csv";
+    double min_time = 1.0;
+    SyntheticSpec spec;
+    spec.nodes = 2000;
+    spec.hours = 720;
+    spec.seed = 42;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) throw std::runtime_error("Missing value for " + arg);
+            std::string value = argv[++i];
+            if (arg == "--filter") filter = value;
+            else if (arg == "--min-time") min_time = std::stod(value);
+            else if (arg == "--nodes") spec.nodes = std::stoi(value);
+            else if (arg == "--hours") spec.hours = std::stoi(value);
+            else if (arg == "--seed") spec.seed = std::stoull(value);
+            else if (arg == "--out") out_path = value;
+            else throw std::runtime_error("Unknown option: " + arg);
+        }
+        if (spec.nodes <= 0 || spec.hours <= 0 || min_time <= 0) {
+            throw std::runtime_error("--nodes, --hours and --min-time must be positive");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--filter SUBSTR] [--min-time SECONDS] [--nodes N]"
+                  << " [--hours H] [--seed S] [--out PATH]" << std::endl;
+        return 1;
+    }
+    spec.start_hour = days_from_civil(2025, 1, 1) * 24;
+
+    try {
+        // Writers target ../output; run them in a scratch directory so real
+        // results are left alone
+        const auto out_file = std::filesystem::absolute(out_path);
+        const auto home = std::filesystem::current_path();
+        const auto scratch = std::filesystem::temp_directory_path() /
+                             ("lmp_bench." + std::to_string(getpid()));
+        std::filesystem::create_directories(scratch / "run");
+        std::filesystem::create_directories(scratch / "output");
+
+        std::cout << "Preparing inputs (" << spec.nodes << " nodes x " << spec.hours
+                  << " hours, seed " << spec.seed << ")..." << std::endl;
+        const TextRows text = make_rows(spec, 1 << 16);
+        const double line_bytes = static_cast<double>(text.text.size()) / text.count();
+
+        const FieldRun ints = join_fields(text, [](const SyntheticRow& r, char* out) {
+            return static_cast<size_t>(std::to_chars(out, out + 16, r.pnode_id).ptr - out);
+        });
+        const FieldRun prices = join_fields(text, [](const SyntheticRow& r, char* out) {
+            return static_cast<size_t>(std::to_chars(out, out + 32, r.cong_rt, std::chars_format::fixed, 5).ptr - out);
+        });
+
+        // Samples in file order (time-major), so accumulators are hit the way
+        // a scan hits them
+        std::vector<Sample> samples;
+        std::vector<int> sample_node;
+        for (const auto& row : text.rows) {
+            samples.push_back(make_sample(row));
+            sample_node.push_back((row.pnode_id - 1000) / 7);
+        }
+        std::vector<std::string> zone_names;
+        for (int n = 0; n < spec.nodes; n++) zone_names.push_back(synthetic_zone(n % synthetic_zone_count()));
+
+        // Merge inputs: partial accumulators of a few nodes over two halves
+        // of the hours
+        const int MERGE_NODES = std::min(spec.nodes, 256);
+        std::vector<NodeAccumulator> merge_into(MERGE_NODES), merge_from(MERGE_NODES);
+        for (uint64_t i = 0; i < uint64_t(spec.nodes) * spec.hours; i++) {
+            const int node = static_cast<int>(i % spec.nodes);
+            if (node >= MERGE_NODES) continue;
+            SyntheticRow row = synthesize_row(spec, i);
+            auto& acc = (i / spec.nodes) * 2 < uint64_t(spec.hours) ? merge_into[node] : merge_from[node];
+            acc.update(make_sample(row), zone_names[node], row.pnode_id);
+        }
+        const std::vector<NodeAccumulator> merge_base = merge_into;
+        std::vector<NodeAccumulator> merge_work;
+
+        std::filesystem::current_path(scratch / "run");
+        ScannerBench scanner(spec);
+        std::cout << "  " << scanner.nodes() << " nodes aggregated; inputs ready" << std::endl;
+
+        std::vector<NodeAccumulator> full(spec.nodes);
+        std::vector<SharpeAccumulator> sharpe(spec.nodes);
+
+        std::vector<Benchmark> benches;
+        benches.push_back({"fast_parser/skip", [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; i++) {
+                size_t r = i & (text.count() - 1);
+                FastCSVParser p(text.line(r), text.length(r));
+                for (int f = 1; f < NUM_COLUMNS; f++) p.skip();
+                keep(p.pos);
+            }
+        }, line_bytes});
+        benches.push_back({"fast_parser/parse_int", [&](uint64_t ops) {
+            FastCSVParser p(ints.text.data(), ints.text.size());
+            for (uint64_t i = 0; i < ops; i++) {
+                if (p.pos >= p.len) p.pos = 0;
+                keep(p.parse_int());
+            }
+        }, static_cast<double>(ints.text.size()) / ints.count});
+        benches.push_back({"fast_parser/parse_double", [&](uint64_t ops) {
+            FastCSVParser p(prices.text.data(), prices.text.size());
+            for (uint64_t i = 0; i < ops; i++) {
+                if (p.pos >= p.len) p.pos = 0;
+                keep(p.parse_double());
+            }
+        }, static_cast<double>(prices.text.size()) / prices.count});
+        benches.push_back({"fast_parser/parse_fixed", [&](uint64_t ops) {
+            FastCSVParser p(prices.text.data(), prices.text.size());
+            for (uint64_t i = 0; i < ops; i++) {
+                if (p.pos >= p.len) p.pos = 0;
+                keep(p.parse_fixed());
+            }
+        }, static_cast<double>(prices.text.size()) / prices.count});
+
+        // One row per op through each parser instantiation the scanner uses
+        benches.push_back(row_parser<true, true, false>("csv_row_parser/parse", text, line_bytes));
+        benches.push_back(row_parser<false, false, false>("csv_row_parser/parse_spread_only", text, line_bytes));
+        benches.push_back(row_parser<true, true, true>("csv_row_parser/parse_fixed", text, line_bytes));
+
+        benches.push_back({"accumulator/update_full", [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; i++) {
+                size_t r = i & (samples.size() - 1);
+                int node = sample_node[r];
+                full[node].update(samples[r], zone_names[node], node);
+            }
+        }, 0.0, [&]() { std::fill(full.begin(), full.end(), NodeAccumulator()); }});
+        benches.push_back({"accumulator/update_sharpe", [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; i++) {
+                size_t r = i & (samples.size() - 1);
+                int node = sample_node[r];
+                sharpe[node].update(samples[r], zone_names[node], node);
+            }
+        }, 0.0, [&]() { std::fill(sharpe.begin(), sharpe.end(), SharpeAccumulator()); }});
+        benches.push_back({"accumulator/chan_merge", [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; i++) {
+                size_t k = i % MERGE_NODES;
+                merge_work[k].merge(merge_from[k]);
+            }
+            keep(merge_work[0].n);
+        }, 0.0, [&]() { merge_work = merge_base; }});
+
+        benches.push_back({"scanner/calculate_results", [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; i++) scanner.calculate_results();
+        }});
+        benches.push_back({"scanner/calculate_zone_summaries", [&](uint64_t ops) {
+            for (uint64_t i = 0; i < ops; i++) scanner.calculate_zone_summaries();
+        }});
+        {
+            Quiet quiet;
+            scanner.calculate_results();
+            scanner.calculate_zone_summaries();
+        }
+
+        // Writers are sized by the file they produce
+        for (const auto& [file, writer] : ScannerBench::writers()) {
+            scanner.write(writer);
+            double bytes = static_cast<double>(std::filesystem::file_size(scratch / "output" / file));
+            std::string name = "write/" + file.substr(0, file.find('.'));
+            benches.push_back({name, [&scanner, writer = writer](uint64_t ops) {
+                for (uint64_t i = 0; i < ops; i++) scanner.write(writer);
+            }, bytes});
+        }
+
+        std::cout << "\n  " << std::left << std::setw(36) << "benchmark" << std::right << std::setw(14)
+                  << "ns/op" << std::setw(14) << "min ns/op" << std::setw(12) << "MB/s" << std::endl;
+        std::vector<BenchResult> results;
+        for (const auto& bench : benches) {
+            if (bench.name.find(filter) == std::string::npos) continue;
+            BenchResult r = measure(bench, min_time);
+            results.push_back(r);
+            std::cout << "  " << std::left << std::setw(36) << r.name << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(14) << r.ns_per_op << std::setw(14)
+                      << r.min_ns_per_op << std::setw(12);
+            if (r.bytes_per_op > 0) std::cout << r.bytes_per_s() / 1e6;
+            else std::cout << "-";
+            std::cout << std::endl;
+        }
+
+        std::filesystem::current_path(home);
+        std::filesystem::remove_all(scratch);
+
+        CsvWriter out(out_file.string(), 3);
+        out.text("benchmark,samples,ops_per_sample,ns_per_op,min_ns_per_op,bytes_per_op,bytes_per_s\n");
+        for (const auto& r : results) {
+            out.row(r.name, SAMPLES, r.ops_per_sample, r.ns_per_op, r.min_ns_per_op, r.bytes_per_op,
+                    r.bytes_per_s());
+        }
+        out.close();
+        std::cout << "\nResults written to " << out_path << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
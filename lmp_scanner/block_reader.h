@@ -0,0 +1,183 @@
+#pragma once
+#include "run_metrics.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+// A run of whole lines and the file offset of its first byte
+struct TextBlock {
+    std::string text;
+    uint64_t offset = 0;
+};
+
+// Reads a file in large blocks that always end on a line boundary, so
+// workers can parse a block without seeing the previous or next one
+class BlockReader {
+public:
+    explicit BlockReader(const std::string& path, size_t block_size = 8 << 20)
+        : file_(path, std::ios::binary), block_size_(block_size) {
+        if (!file_.is_open()) {
+            throw std::runtime_error("Cannot open CSV file: " + path);
+        }
+    }
+
+    // Consume the first line (the header)
+    std::string read_header() {
+        std::string header;
+        std::getline(file_, header);
+        next_offset_ = header.size() + 1;
+        if (!header.empty() && header.back() == '\r') header.pop_back();
+        return header;
+    }
+
+    // Fill `block` with the next run of complete lines; false at end of file
+    bool next(std::string& block) {
+        StageClock clock;
+        const size_t before = bytes_read_;
+        bool more = fill(block);
+        offset_ = next_offset_;
+        next_offset_ += block.size();
+        auto& metrics = thread_metrics();
+        clock.lap(metrics.stages[STAGE_READ]);
+        metrics.bytes += bytes_read_ - before;
+        return more;
+    }
+
+    size_t bytes_read() const { return bytes_read_; }
+
+    // File offset of the block last returned by next()
+    uint64_t offset() const { return offset_; }
+
+private:
+    std::ifstream file_;
+    size_t block_size_;
+    std::string carry_;
+    size_t bytes_read_ = 0;
+    uint64_t offset_ = 0;
+    uint64_t next_offset_ = 0;
+
+    bool fill(std::string& block) {
+        block.swap(carry_);
+        carry_.clear();
+        if (file_.eof() && block.empty()) return false;
+
+        size_t have = block.size();
+        block.resize(have + block_size_);
+        file_.read(&block[have], block_size_);
+        size_t got = file_.gcount();
+        block.resize(have + got);
+        bytes_read_ += got;
+
+        if (!file_.eof()) {
+            // Hold back the trailing partial line for the next block
+            size_t last_newline = block.rfind('\n');
+            if (last_newline == std::string::npos) {
+                carry_.swap(block);
+                return fill(block);
+            }
+            carry_.assign(block, last_newline + 1, std::string::npos);
+            block.resize(last_newline + 1);
+        }
+        return !block.empty();
+    }
+};
+
+// Walks the non-empty lines of a buffer, dropping any trailing '\r'
+class LineCursor {
+public:
+    LineCursor(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    bool next(const char*& line, size_t& len) {
+        while (p_ < end_) {
+            const char* nl = static_cast<const char*>(std::memchr(p_, '\n', end_ - p_));
+            const char* line_end = nl ? nl : end_;
+            line = p_;
+            len = line_end - p_;
+            p_ = line_end + 1;
+            if (len > 0 && line[len - 1] == '\r') len--;
+            if (len > 0) return true;
+        }
+        return false;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+// Calls fn(line, len) for every non-empty line in a block
+template <typename Fn>
+inline void for_each_line(const std::string& block, Fn&& fn) {
+    LineCursor lines(block.data(), block.data() + block.size());
+    const char* line;
+    size_t len;
+    while (lines.next(line, len)) fn(line, len);
+}
+
+// Bounded multi-producer/multi-consumer queue for handing blocks to workers.
+// Time spent blocked counts as the caller's wait time, and every pop samples
+// the depth it found.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+    // Blocks while full; false (item dropped) once the queue is closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (items_.size() >= capacity_ && !closed_) {
+            double start = run_seconds();
+            not_full_.wait(lock, [&] { return items_.size() < capacity_ || closed_; });
+            thread_metrics().wait += run_seconds() - start;
+        }
+        if (closed_) return false;
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available; false once closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (items_.empty() && !closed_) {
+            double start = run_seconds();
+            not_empty_.wait(lock, [&] { return !items_.empty() || closed_; });
+            thread_metrics().wait += run_seconds() - start;
+        }
+        depths_.record(items_.size());
+        if (items_.empty()) return false;
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Report the depth samples to the run metrics
+    void report_depths(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        run_metrics().add_queue(name, capacity_, depths_);
+    }
+
+private:
+    size_t capacity_;
+    std::deque<T> items_;
+    DepthHistogram depths_;
+    bool closed_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
@@ -0,0 +1,494 @@
+#include "column_store.h"
+#include "run_metrics.h"
+#include "block_reader.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+const char STORE_MAGIC[8] = {'L', 'M', 'P', 'B', 'L', 'O', 'C', 'K'};
+const uint32_t STORE_VERSION = 2;
+
+inline uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+// Byte layout of a block holding `rows` rows with `width`-byte prices
+inline uint64_t keys_bytes(uint32_t rows) { return align8(uint64_t(rows) * 10); }
+inline uint64_t price_offset(uint32_t rows, int column, size_t width) {
+    return keys_bytes(rows) + uint64_t(column) * rows * width;
+}
+
+template <typename T>
+void permute(std::vector<T>& column, const std::vector<uint32_t>& order) {
+    if (column.empty()) return;
+    std::vector<T> sorted(order.size());
+    for (size_t i = 0; i < order.size(); i++) sorted[i] = column[order[i]];
+    column.swap(sorted);
+}
+
+inline uint64_t zone_bit(uint16_t id) { return 1ULL << std::min<uint16_t>(id, 63); }
+
+} // namespace
+
+std::string format_hour_stamp(int hour_stamp) {
+    // Inverse of days_from_civil (Hinnant)
+    int z = hour_stamp / 24 + 719468;
+    int hour = hour_stamp % 24;
+    const int era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int y = static_cast<int>(yoe) + era * 400;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    y += m <= 2;
+
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04d-%02u-%02u %02d:00:00", y, m, d, hour);
+    return buf;
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+
+ColumnStoreWriter::ColumnStoreWriter(const std::string& path, bool fixed_point)
+    : file_(path, std::ios::binary | std::ios::trunc), path_(path), fixed_point_(fixed_point) {
+    if (!file_.is_open()) {
+        throw std::runtime_error("Cannot create store: " + path);
+    }
+    StoreHeader placeholder{};
+    file_.write(reinterpret_cast<const char*>(&placeholder), sizeof(placeholder));
+}
+
+ColumnStoreWriter::~ColumnStoreWriter() {
+    if (!closed_) {
+        try { close(); } catch (...) {}
+    }
+}
+
+void ColumnStoreWriter::append(int hour_stamp, int pnode_id, const char* zone, double spread,
+                               double cong_da, double cong_rt, double energy_da, double energy_rt,
+                               double loss_da, double loss_rt, const int64_t* fixed) {
+    auto it = zone_ids_.find(zone);
+    uint16_t zid;
+    if (it == zone_ids_.end()) {
+        zid = static_cast<uint16_t>(zones_.size());
+        zone_ids_.emplace(zone, zid);
+        zones_.emplace_back(zone);
+    } else {
+        zid = it->second;
+    }
+
+    if (hour_stamp < last_hour_) time_sorted_ = false;
+    last_hour_ = hour_stamp;
+
+    pending_.hour_stamp.push_back(hour_stamp);
+    pending_.pnode_id.push_back(pnode_id);
+    pending_.zone_id.push_back(zid);
+    pending_.prices[SC_SPREAD].push_back(spread);
+    pending_.prices[SC_CONG_DA].push_back(cong_da);
+    pending_.prices[SC_CONG_RT].push_back(cong_rt);
+    pending_.prices[SC_ENERGY_DA].push_back(energy_da);
+    pending_.prices[SC_ENERGY_RT].push_back(energy_rt);
+    pending_.prices[SC_LOSS_DA].push_back(loss_da);
+    pending_.prices[SC_LOSS_RT].push_back(loss_rt);
+    if (fixed_point_) {
+        for (int c = 0; c < SC_NUM_PRICES; c++) {
+            if (fixed[c] < INT32_MIN || fixed[c] > INT32_MAX) {
+                throw std::runtime_error("Price out of range for a fixed-point store at pnode " +
+                                         std::to_string(pnode_id));
+            }
+            pending_.fixed[c].push_back(static_cast<int32_t>(fixed[c]));
+        }
+    }
+    pending_.rows++;
+    total_rows_++;
+
+    if (pending_.rows == STORE_BLOCK_ROWS) flush_block();
+}
+
+void ColumnStoreWriter::flush_block() {
+    if (pending_.rows == 0) return;
+    const uint32_t n = pending_.rows;
+
+    // Group each node's rows, keeping their time order
+    std::vector<uint32_t> order(n);
+    for (uint32_t i = 0; i < n; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return pending_.pnode_id[a] < pending_.pnode_id[b];
+    });
+    permute(pending_.hour_stamp, order);
+    permute(pending_.pnode_id, order);
+    permute(pending_.zone_id, order);
+    for (int c = 0; c < SC_NUM_PRICES; c++) {
+        permute(pending_.prices[c], order);
+        permute(pending_.fixed[c], order);
+    }
+
+    BlockStats stats{};
+    stats.offset = static_cast<uint64_t>(file_.tellp());
+    stats.rows = n;
+    auto [min_h, max_h] = std::minmax_element(pending_.hour_stamp.begin(), pending_.hour_stamp.end());
+    auto [min_n, max_n] = std::minmax_element(pending_.pnode_id.begin(), pending_.pnode_id.end());
+    auto [min_s, max_s] = std::minmax_element(pending_.prices[SC_SPREAD].begin(),
+                                              pending_.prices[SC_SPREAD].end());
+    auto [min_cd, max_cd] = std::minmax_element(pending_.prices[SC_CONG_DA].begin(),
+                                                pending_.prices[SC_CONG_DA].end());
+    auto [min_cr, max_cr] = std::minmax_element(pending_.prices[SC_CONG_RT].begin(),
+                                                pending_.prices[SC_CONG_RT].end());
+    stats.min_hour = *min_h;
+    stats.max_hour = *max_h;
+    stats.min_node = *min_n;
+    stats.max_node = *max_n;
+    stats.min_spread = *min_s;
+    stats.max_spread = *max_s;
+    stats.min_cong_da = *min_cd;
+    stats.max_cong_da = *max_cd;
+    stats.min_cong_rt = *min_cr;
+    stats.max_cong_rt = *max_cr;
+    for (uint16_t z : pending_.zone_id) stats.zone_mask |= zone_bit(z);
+
+    file_.write(reinterpret_cast<const char*>(pending_.hour_stamp.data()), n * 4);
+    file_.write(reinterpret_cast<const char*>(pending_.pnode_id.data()), n * 4);
+    file_.write(reinterpret_cast<const char*>(pending_.zone_id.data()), n * 2);
+    static const char zeros[8] = {};
+    file_.write(zeros, keys_bytes(n) - uint64_t(n) * 10);
+    for (int c = 0; c < SC_NUM_PRICES; c++) {
+        if (fixed_point_) {
+            file_.write(reinterpret_cast<const char*>(pending_.fixed[c].data()), n * sizeof(int32_t));
+        } else {
+            file_.write(reinterpret_cast<const char*>(pending_.prices[c].data()), n * sizeof(double));
+        }
+    }
+
+    blocks_.push_back(stats);
+    pending_ = StoreBlock();
+}
+
+void ColumnStoreWriter::close() {
+    if (closed_) return;
+    flush_block();
+    closed_ = true;
+
+    StoreHeader header{};
+    std::memcpy(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    header.version = STORE_VERSION;
+    header.block_rows = STORE_BLOCK_ROWS;
+    header.total_rows = total_rows_;
+    header.num_blocks = static_cast<uint32_t>(blocks_.size());
+    header.time_sorted = time_sorted_ ? 1 : 0;
+    header.footer_offset = static_cast<uint64_t>(file_.tellp());
+    header.price_encoding = fixed_point_ ? PRICES_FIXED32 : PRICES_F64;
+
+    file_.write(reinterpret_cast<const char*>(blocks_.data()), blocks_.size() * sizeof(BlockStats));
+
+    uint32_t zone_count = static_cast<uint32_t>(zones_.size());
+    file_.write(reinterpret_cast<const char*>(&zone_count), sizeof(zone_count));
+    for (const auto& zone : zones_) {
+        uint16_t len = static_cast<uint16_t>(zone.size());
+        file_.write(reinterpret_cast<const char*>(&len), sizeof(len));
+        file_.write(zone.data(), len);
+    }
+
+    // One entry per day: the first block whose rows can reach that day
+    std::vector<std::pair<int32_t, uint32_t>> time_index;
+    if (time_sorted_ && !blocks_.empty()) {
+        int day = blocks_[0].min_hour / 24;
+        for (uint32_t b = 0; b < blocks_.size(); b++) {
+            while (day <= blocks_[b].max_hour / 24) {
+                time_index.emplace_back(day * 24, b);
+                day++;
+            }
+        }
+    }
+    uint32_t index_count = static_cast<uint32_t>(time_index.size());
+    file_.write(reinterpret_cast<const char*>(&index_count), sizeof(index_count));
+    for (const auto& [hour, block] : time_index) {
+        file_.write(reinterpret_cast<const char*>(&hour), sizeof(hour));
+        file_.write(reinterpret_cast<const char*>(&block), sizeof(block));
+    }
+
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file_.close();
+    if (!file_) {
+        throw std::runtime_error("Failed writing store: " + path_);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+
+bool ColumnStore::is_store(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[8] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && std::memcmp(magic, STORE_MAGIC, sizeof(magic)) == 0;
+}
+
+ColumnStore::ColumnStore(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open store: " + path);
+    }
+    struct stat st;
+    ::fstat(fd_, &st);
+    file_size_ = st.st_size;
+
+    pread_exact(&header_, sizeof(header_), 0);
+    if (std::memcmp(header_.magic, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0 ||
+        header_.version != STORE_VERSION) {
+        throw std::runtime_error("Not a supported .lmpb store: " + path);
+    }
+
+    // Footer: block stats, zone dictionary, time index
+    std::vector<char> footer(file_size_ - header_.footer_offset);
+    pread_exact(footer.data(), footer.size(), header_.footer_offset);
+    const char* p = footer.data();
+
+    blocks_.resize(header_.num_blocks);
+    std::memcpy(blocks_.data(), p, blocks_.size() * sizeof(BlockStats));
+    p += blocks_.size() * sizeof(BlockStats);
+
+    uint32_t zone_count;
+    std::memcpy(&zone_count, p, sizeof(zone_count));
+    p += sizeof(zone_count);
+    for (uint32_t z = 0; z < zone_count; z++) {
+        uint16_t len;
+        std::memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        zones_.emplace_back(p, len);
+        p += len;
+    }
+
+    uint32_t index_count;
+    std::memcpy(&index_count, p, sizeof(index_count));
+    p += sizeof(index_count);
+    time_index_.resize(index_count);
+    for (uint32_t i = 0; i < index_count; i++) {
+        std::memcpy(&time_index_[i].first, p, sizeof(int32_t));
+        std::memcpy(&time_index_[i].second, p + sizeof(int32_t), sizeof(uint32_t));
+        p += sizeof(int32_t) + sizeof(uint32_t);
+    }
+}
+
+ColumnStore::~ColumnStore() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void ColumnStore::pread_exact(void* dst, size_t len, uint64_t offset) const {
+    thread_metrics().bytes += len;
+    char* out = static_cast<char*>(dst);
+    while (len > 0) {
+        ssize_t n = ::pread(fd_, out, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error("Short read from store");
+        out += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+int ColumnStore::zone_id(const std::string& name) const {
+    for (size_t z = 0; z < zones_.size(); z++) {
+        if (zones_[z] == name) return static_cast<int>(z);
+    }
+    return -1;
+}
+
+uint64_t ColumnStore::data_bytes() const {
+    return header_.footer_offset - sizeof(StoreHeader);
+}
+
+std::vector<uint32_t> ColumnStore::candidate_blocks(const RowFilter& filter) const {
+    uint32_t lo = 0;
+    uint32_t hi = static_cast<uint32_t>(blocks_.size());
+
+    // Narrow the block range with the sparse time index first
+    if (!time_index_.empty()) {
+        auto day_entry = [&](int hour) {
+            int32_t day_start = (hour / 24) * 24;
+            return std::lower_bound(time_index_.begin(), time_index_.end(),
+                                    std::make_pair(day_start, uint32_t(0)));
+        };
+        if (filter.from_hour != INT_MIN) {
+            auto it = day_entry(filter.from_hour);
+            lo = it == time_index_.end() ? hi : it->second;
+        }
+        if (filter.to_hour != INT_MAX) {
+            auto it = day_entry(filter.to_hour + 24);
+            if (it != time_index_.end()) hi = std::min(hi, it->second + 1);
+        }
+    }
+
+    int zid = filter.zone.empty() ? -1 : zone_id(filter.zone);
+    if (!filter.zone.empty() && zid < 0) return {};
+
+    std::vector<uint32_t> result;
+    for (uint32_t b = lo; b < hi; b++) {
+        const auto& s = blocks_[b];
+        if (s.max_hour < filter.from_hour || s.min_hour > filter.to_hour) continue;
+        if (zid >= 0 && !(s.zone_mask & zone_bit(static_cast<uint16_t>(zid)))) continue;
+        if (!filter.nodes.empty()) {
+            auto it = std::lower_bound(filter.nodes.begin(), filter.nodes.end(), s.min_node);
+            if (it == filter.nodes.end() || *it > s.max_node) continue;
+        }
+        result.push_back(b);
+    }
+    return result;
+}
+
+bool ColumnStore::row_matches(const StoreBlock& block, uint32_t row, const RowFilter& filter,
+                              int filter_zone) const {
+    int hour_stamp = block.hour_stamp[row];
+    if (!filter.accepts_time(hour_stamp)) return false;
+    if (!filter.accepts_hour(hour_stamp % 24)) return false;
+    if (!filter.accepts_node(block.pnode_id[row])) return false;
+    if (filter_zone >= 0 && block.zone_id[row] != filter_zone) return false;
+    return true;
+}
+
+void ColumnStore::read_block(uint32_t index, StoreBlock& out, unsigned columns) const {
+    const auto& s = blocks_[index];
+    const uint32_t n = s.rows;
+    out.rows = n;
+
+    // Keys are one contiguous read
+    std::vector<char> keys(keys_bytes(n));
+    pread_exact(keys.data(), keys.size(), s.offset);
+    out.hour_stamp.resize(n);
+    out.pnode_id.resize(n);
+    out.zone_id.resize(n);
+    std::memcpy(out.hour_stamp.data(), keys.data(), n * 4);
+    std::memcpy(out.pnode_id.data(), keys.data() + n * 4, n * 4);
+    std::memcpy(out.zone_id.data(), keys.data() + n * 8, n * 2);
+    uint64_t bytes = keys.size();
+
+    // Price columns are read as contiguous runs of the requested groups;
+    // fixed-point columns are kept raw and decoded alongside
+    const bool fixed = fixed_point();
+    const size_t width = fixed ? sizeof(int32_t) : sizeof(double);
+    auto read_run = [&](int first, int last) {
+        uint64_t run_bytes = uint64_t(last - first + 1) * n * width;
+        std::vector<char> buf(run_bytes);
+        pread_exact(buf.data(), run_bytes, s.offset + price_offset(n, first, width));
+        for (int c = first; c <= last; c++) {
+            const char* src = buf.data() + uint64_t(c - first) * n * width;
+            out.prices[c].resize(n);
+            if (fixed) {
+                out.fixed[c].resize(n);
+                std::memcpy(out.fixed[c].data(), src, n * width);
+                for (uint32_t r = 0; r < n; r++) out.prices[c][r] = from_fixed(out.fixed[c][r]);
+            } else {
+                std::memcpy(out.prices[c].data(), src, n * width);
+            }
+        }
+        bytes += run_bytes;
+    };
+
+    for (auto& column : out.prices) column.clear();
+    for (auto& column : out.fixed) column.clear();
+    if (columns & READ_SPREAD) read_run(SC_SPREAD, SC_SPREAD);
+    if (columns & READ_COMPONENTS) read_run(SC_CONG_DA, SC_ENERGY_RT);
+    if (columns & READ_LOSS) read_run(SC_LOSS_DA, SC_LOSS_RT);
+
+    bytes_read_ += bytes;
+    blocks_read_++;
+}
+
+// ---------------------------------------------------------------------------
+
+std::vector<SpikeRow> top_spread_spikes(const ColumnStore& store, const RowFilter& filter, size_t k) {
+    auto bound = [&](uint32_t b) {
+        const auto& s = store.stats(b);
+        return std::max(std::abs(s.min_spread), std::abs(s.max_spread));
+    };
+    std::vector<uint32_t> blocks = store.candidate_blocks(filter);
+    std::sort(blocks.begin(), blocks.end(),
+              [&](uint32_t a, uint32_t b) { return bound(a) > bound(b); });
+
+    // Min-heap on |spread| holding the best k so far
+    auto weaker = [](const SpikeRow& a, const SpikeRow& b) {
+        return std::abs(a.spread) > std::abs(b.spread);
+    };
+    std::vector<SpikeRow> heap;
+    if (k == 0) return heap;
+    const int filter_zone = filter.zone.empty() ? -1 : store.zone_id(filter.zone);
+
+    StoreBlock block;
+    for (uint32_t b : blocks) {
+        if (heap.size() == k && bound(b) <= std::abs(heap.front().spread)) break;
+
+        store.read_block(b, block, READ_SPREAD | READ_COMPONENTS);
+        const auto& p = block.prices;
+        for (uint32_t r = 0; r < block.rows; r++) {
+            double spread = p[SC_SPREAD][r];
+            if (heap.size() == k && std::abs(spread) <= std::abs(heap.front().spread)) continue;
+            if (!store.row_matches(block, r, filter, filter_zone)) continue;
+
+            SpikeRow row{block.hour_stamp[r], block.pnode_id[r], block.zone_id[r], spread,
+                         p[SC_CONG_DA][r] - p[SC_CONG_RT][r]};
+            if (heap.size() == k) {
+                std::pop_heap(heap.begin(), heap.end(), weaker);
+                heap.back() = row;
+            } else {
+                heap.push_back(row);
+            }
+            std::push_heap(heap.begin(), heap.end(), weaker);
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), weaker);
+    return heap;
+}
+
+uint64_t convert_csv_to_store(const std::string& csv_path, const std::string& store_path,
+                              bool fixed_point) {
+    BlockReader reader(csv_path);
+    reader.read_header();
+    ColumnStoreWriter writer(store_path, fixed_point);
+
+    std::cout << "Converting " << csv_path << " -> " << store_path
+              << (fixed_point ? " (fixed-point prices)" : "") << "..." << std::endl;
+
+    std::string block;
+    long long skipped = 0;
+    while (reader.next(block)) {
+        for_each_line(block, [&](const char* line, size_t len) {
+            int pnode_id = 0, hour = 0, hour_stamp = -1;
+            char zone[32] = "";
+            double spread = 0.0, cong_da = 0.0, cong_rt = 0.0, energy_da = 0.0, energy_rt = 0.0;
+            double loss_da = 0.0, loss_rt = 0.0;
+            int64_t fixed[SC_NUM_PRICES] = {};
+            bool ok = fixed_point
+                ? CSVRowParser::parse<true, true, true>(line, len, pnode_id, zone, spread,
+                                                        cong_da, cong_rt, energy_da, energy_rt,
+                                                        loss_da, loss_rt, hour, hour_stamp,
+                                                        nullptr, fixed)
+                : CSVRowParser::parse(line, len, pnode_id, zone, spread,
+                                      cong_da, cong_rt, energy_da, energy_rt,
+                                      loss_da, loss_rt, hour, hour_stamp);
+            if (!ok || hour_stamp < 0) {
+                skipped++;
+                return;
+            }
+            writer.append(hour_stamp, pnode_id, zone, spread, cong_da, cong_rt,
+                          energy_da, energy_rt, loss_da, loss_rt, fixed);
+        });
+    }
+    writer.close();
+
+    std::cout << "  Rows written: " << writer.rows() << std::endl;
+    if (skipped > 0) {
+        std::cout << "  Rows skipped (unparseable): " << skipped << std::endl;
+    }
+    return writer.rows();
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "fast_parser.h"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Block-columnar binary store (.lmpb)
+//
+//   [StoreHeader]
+//   [block 0: hour_stamp i32 | pnode_id i32 | zone_id u16 | pad | 7 price columns]
+//   [block 1] ...
+//   [BlockStats x num_blocks][zone dictionary][sparse time index]
+//
+// Price columns are f64, or i32 fixed-point (1e-5 $/MWh) in stores written
+// with --fixed-point. Rows within a block are ordered by pnode_id (time order
+// is kept within a node) so each node's rows form contiguous runs.
+//
+// Every block carries a zone map (min/max of timestamp, pnode_id, spread and
+// the congestion columns, plus a zone bitmask) so scans can skip blocks that
+// cannot match. The sparse time index maps each day to the first block that
+// may contain it when the store was written in time order.
+
+const uint32_t STORE_BLOCK_ROWS = 65536;
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_rows;
+    uint64_t total_rows;
+    uint32_t num_blocks;
+    uint32_t time_sorted;
+    uint64_t footer_offset;
+    uint32_t price_encoding;     // StorePriceEncoding
+    uint32_t reserved;
+};
+
+enum StorePriceEncoding : uint32_t {
+    PRICES_F64 = 0,
+    PRICES_FIXED32 = 1
+};
+
+struct BlockStats {
+    uint64_t offset;
+    uint32_t rows;
+    uint32_t reserved;
+    int32_t min_hour, max_hour;
+    int32_t min_node, max_node;
+    uint64_t zone_mask;          // bit z for zone id z; bit 63 also covers ids >= 63
+    double min_spread, max_spread;
+    double min_cong_da, max_cong_da;
+    double min_cong_rt, max_cong_rt;
+};
+
+// Price columns in block order
+enum StoreColumn {
+    SC_SPREAD,
+    SC_CONG_DA,
+    SC_CONG_RT,
+    SC_ENERGY_DA,
+    SC_ENERGY_RT,
+    SC_LOSS_DA,
+    SC_LOSS_RT,
+    SC_NUM_PRICES
+};
+
+// Which column groups a read needs (keys are always read)
+enum StoreColumns : unsigned {
+    READ_SPREAD = 1u << 0,
+    READ_COMPONENTS = 1u << 1,   // congestion and energy, DA and RT
+    READ_LOSS = 1u << 2,
+    READ_ALL = READ_SPREAD | READ_COMPONENTS | READ_LOSS
+};
+
+// One decoded block; price vectors not requested stay empty. Fixed-point
+// stores also keep the raw integer columns.
+struct StoreBlock {
+    uint32_t rows = 0;
+    std::vector<int32_t> hour_stamp;
+    std::vector<int32_t> pnode_id;
+    std::vector<uint16_t> zone_id;
+    std::vector<double> prices[SC_NUM_PRICES];
+    std::vector<int32_t> fixed[SC_NUM_PRICES];
+};
+
+class ColumnStoreWriter {
+public:
+    explicit ColumnStoreWriter(const std::string& path, bool fixed_point = false);
+    ~ColumnStoreWriter();
+
+    // fixed holds the prices in StoreColumn order and is required for a
+    // fixed-point store
+    void append(int hour_stamp, int pnode_id, const char* zone, double spread,
+                double cong_da, double cong_rt, double energy_da, double energy_rt,
+                double loss_da, double loss_rt, const int64_t* fixed = nullptr);
+    void close();
+
+    uint64_t rows() const { return total_rows_; }
+
+private:
+    std::ofstream file_;
+    std::string path_;
+    bool fixed_point_;
+    bool closed_ = false;
+
+    StoreBlock pending_;
+    std::vector<BlockStats> blocks_;
+    std::unordered_map<std::string, uint16_t> zone_ids_;
+    std::vector<std::string> zones_;
+    uint64_t total_rows_ = 0;
+    int last_hour_ = INT32_MIN;
+    bool time_sorted_ = true;
+
+    void flush_block();
+};
+
+class ColumnStore {
+public:
+    explicit ColumnStore(const std::string& path);
+    ~ColumnStore();
+
+    static bool is_store(const std::string& path);
+
+    uint64_t total_rows() const { return header_.total_rows; }
+    size_t num_blocks() const { return blocks_.size(); }
+    uint64_t file_size() const { return file_size_; }
+    bool fixed_point() const { return header_.price_encoding == PRICES_FIXED32; }
+    const BlockStats& stats(size_t block) const { return blocks_[block]; }
+    const std::string& zone_name(uint16_t id) const { return zones_[id]; }
+    size_t num_zones() const { return zones_.size(); }
+
+    // Zone id for a name, or -1 if the store has no such zone
+    int zone_id(const std::string& name) const;
+
+    // Blocks whose zone maps overlap the filter, via the time index when sorted
+    std::vector<uint32_t> candidate_blocks(const RowFilter& filter) const;
+
+    // Whether a row passes the filter (the block-level check is coarser)
+    bool row_matches(const StoreBlock& block, uint32_t row, const RowFilter& filter,
+                     int filter_zone) const;
+
+    void read_block(uint32_t index, StoreBlock& out, unsigned columns) const;
+
+    // I/O accounting across all reads so far
+    uint64_t bytes_read() const { return bytes_read_.load(); }
+    uint64_t blocks_read() const { return blocks_read_.load(); }
+    uint64_t data_bytes() const;
+
+private:
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+    StoreHeader header_{};
+    std::vector<BlockStats> blocks_;
+    std::vector<std::string> zones_;
+    std::vector<std::pair<int32_t, uint32_t>> time_index_;   // day start hour -> first block
+
+    mutable std::atomic<uint64_t> bytes_read_{0};
+    mutable std::atomic<uint64_t> blocks_read_{0};
+
+    void pread_exact(void* dst, size_t len, uint64_t offset) const;
+};
+
+// One row pulled out of the store by a point query
+struct SpikeRow {
+    int hour_stamp;
+    int pnode_id;
+    uint16_t zone_id;
+    double spread;
+    double cong_spread;
+};
+
+// The k rows with the largest |spread| passing the filter, largest first.
+// Blocks are visited in order of their spread bound and the scan stops once
+// no remaining block can beat the k-th row found so far.
+std::vector<SpikeRow> top_spread_spikes(const ColumnStore& store, const RowFilter& filter, size_t k);
+
+// Convert a merged CSV into a .lmpb store
+uint64_t convert_csv_to_store(const std::string& csv_path, const std::string& store_path,
+                              bool fixed_point = false);
+
+// "YYYY-MM-DD HH:00:00" for an hours-since-epoch stamp
+std::string format_hour_stamp(int hour_stamp);
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// Column binding by header name, for inputs whose layout isn't fixed
+// (PJM API dumps, fetch.py merges with suffixed names, live RT feeds)
+struct CSVHeader {
+    std::vector<std::string> names;
+
+    explicit CSVHeader(const std::string& line) {
+        size_t start = 0;
+        while (start <= line.size()) {
+            size_t end = line.find(',', start);
+            if (end == std::string::npos) end = line.size();
+            std::string name = line.substr(start, end - start);
+            if (!name.empty() && name.back() == '\r') name.pop_back();
+            names.push_back(name);
+            start = end + 1;
+        }
+    }
+
+    // First column matching a candidate: exact names win over prefix matches,
+    // so "total_lmp_da" binds both "total_lmp_da" and "total_lmp_da_da"
+    int find(std::initializer_list<const char*> candidates) const {
+        for (const char* candidate : candidates) {
+            for (size_t i = 0; i < names.size(); i++) {
+                if (names[i] == candidate) return static_cast<int>(i);
+            }
+            size_t len = std::strlen(candidate);
+            for (size_t i = 0; i < names.size(); i++) {
+                if (names[i].compare(0, len, candidate) == 0) return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+};
+
+// Split a line into field offsets without copying; returns the field count
+inline int split_fields(const char* line, size_t len,
+                        const char** starts, size_t* lengths, int max_fields) {
+    int count = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= len && count < max_fields; i++) {
+        if (i == len || line[i] == ',') {
+            starts[count] = line + start;
+            lengths[count] = i - start;
+            count++;
+            start = i + 1;
+        }
+    }
+    return count;
+}
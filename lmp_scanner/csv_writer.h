@@ -0,0 +1,122 @@
+#pragma once
+#include <charconv>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Buffered CSV output. Fields are formatted with std::to_chars straight into
+// a large buffer that reaches the file in few big writes, with no stream
+// state or locale. Doubles print fixed-point at the writer's precision, the
+// same text as std::fixed << std::setprecision(p).
+class CsvWriter {
+public:
+    explicit CsvWriter(const std::string& path, int precision = 4, size_t buffer_bytes = 4 << 20)
+        : path_(path), precision_(precision), capacity_(buffer_bytes),
+          buffer_(new char[buffer_bytes]) {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            throw std::runtime_error("Cannot write output file: " + path);
+        }
+    }
+
+    // Closing from the destructor can't report errors; call close() to see them
+    ~CsvWriter() {
+        if (file_) {
+            flush();
+            std::fclose(file_);
+        }
+    }
+
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+
+    void precision(int p) { precision_ = p; }
+
+    // Text written as-is (headers, preformatted lines)
+    void text(std::string_view s) {
+        if (s.size() > capacity_ - used_) flush();
+        if (s.size() > capacity_) {
+            write(s.data(), s.size());
+            return;
+        }
+        s.copy(&buffer_[used_], s.size());
+        used_ += s.size();
+    }
+
+    // One comma-separated line from any mix of numbers and strings
+    template <typename First, typename... Rest>
+    void row(const First& first, const Rest&... rest) {
+        put(first);
+        ((put_char(','), put(rest)), ...);
+        put_char('\n');
+        rows_++;
+    }
+
+    void close() {
+        if (!file_) return;
+        flush();
+        int result = std::fclose(file_);
+        file_ = nullptr;
+        if (result != 0) {
+            throw std::runtime_error("Error writing output file: " + path_);
+        }
+    }
+
+    size_t rows() const { return rows_; }
+
+private:
+    // Longest fixed-point double (1.8e308) plus sign and fraction
+    static constexpr size_t MAX_FIELD = 330;
+
+    std::string path_;
+    int precision_;
+    size_t capacity_;
+    std::unique_ptr<char[]> buffer_;
+    size_t used_ = 0;
+    size_t rows_ = 0;
+    FILE* file_ = nullptr;
+
+    void write(const char* data, size_t size) {
+        if (std::fwrite(data, 1, size, file_) != size) {
+            throw std::runtime_error("Error writing output file: " + path_);
+        }
+    }
+
+    void flush() {
+        if (used_ > 0) write(buffer_.get(), used_);
+        used_ = 0;
+    }
+
+    void put_char(char c) {
+        if (used_ == capacity_) flush();
+        buffer_[used_++] = c;
+    }
+
+    template <typename T>
+    void put(const T& value) {
+        if constexpr (std::is_floating_point_v<T> || std::is_integral_v<T>) {
+            if (capacity_ - used_ < MAX_FIELD) flush();
+            char* first = &buffer_[used_];
+            char* last = buffer_.get() + capacity_;
+            std::to_chars_result result;
+            if constexpr (std::is_floating_point_v<T>) {
+                result = std::to_chars(first, last, value, std::chars_format::fixed, precision_);
+            } else {
+                result = std::to_chars(first, last, value);
+            }
+            used_ = result.ptr - buffer_.get();
+        } else {
+            text(std::string_view(value));
+        }
+    }
+
+    // An unset optional is an empty field
+    template <typename T>
+    void put(const std::optional<T>& value) {
+        if (value) put(*value);
+    }
+};
@@ -0,0 +1,156 @@
+#include "data_quality.h"
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// JSON string literal; sampled lines may hold any bytes, so control and
+// non-ASCII characters are replaced
+std::string quoted(const char* s, size_t len) {
+    std::string out = "\"";
+    for (size_t i = 0; i < len; i++) {
+        const unsigned char c = s[i];
+        if (c == '"' || c == '\\') out += '\\';
+        out += c < 0x20 || c >= 0x7f ? '?' : static_cast<char>(c);
+    }
+    return out + "\"";
+}
+
+std::string quoted(const std::string& s) { return quoted(s.data(), s.size()); }
+
+} // namespace
+
+const char* row_issue_name(RowIssue issue) {
+    static const char* const NAMES[NUM_ROW_ISSUES] = {
+        "ok", "filtered", "too_few_fields", "too_many_fields", "bad_datetime", "bad_number", "duplicate_node_hour"
+    };
+    return NAMES[issue];
+}
+
+void DataQuality::NodeCache::insert(int pnode_id, uint32_t index) {
+    if (2 * (used_ + 1) > slots_.size()) {
+        // Keep the table at most half full
+        std::vector<std::pair<int, uint32_t>> old(slots_.size() * 2, {EMPTY, 0});
+        old.swap(slots_);
+        used_ = 0;
+        for (const auto& [id, i] : old) {
+            if (id != EMPTY) insert(id, i);
+        }
+    }
+    size_t i = slot(pnode_id);
+    while (slots_[i].first != EMPTY) i = (i + 1) & (slots_.size() - 1);
+    slots_[i] = {pnode_id, index};
+    used_++;
+}
+
+DataQuality::~DataQuality() {
+    for (size_t i = 0; i < HOUR_BLOCKS; i++) {
+        HourBlock* b = hour_blocks_[i].load();
+        if (!b) continue;
+        for (auto& chunk : b->chunks) delete[] chunk.load();
+        delete[] b;
+    }
+}
+
+uint32_t DataQuality::node_index(int pnode_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return node_ids_.emplace(pnode_id, static_cast<uint32_t>(node_ids_.size())).first->second;
+}
+
+long long DataQuality::overlap(const DataQuality& other) const {
+    std::scoped_lock lock(mutex_, other.mutex_);
+    long long shared = 0;
+    for (size_t b = 0; b < HOUR_BLOCKS; b++) {
+        const HourBlock* mine = hour_blocks_[b].load(std::memory_order_acquire);
+        const HourBlock* theirs = other.hour_blocks_[b].load(std::memory_order_acquire);
+        if (!mine || !theirs) continue;
+        for (const auto& [pnode_id, index] : other.node_ids_) {
+            auto it = node_ids_.find(pnode_id);
+            if (it == node_ids_.end()) continue;
+            shared += std::popcount(word(*mine, it->second) & word(*theirs, index));
+        }
+    }
+    return shared;
+}
+
+void DataQuality::absorb(const DataQuality& other) {
+    std::lock_guard<std::mutex> lock(other.mutex_);
+    std::vector<std::pair<uint32_t, uint32_t>> nodes;   // (their index, mine)
+    nodes.reserve(other.node_ids_.size());
+    for (const auto& [pnode_id, index] : other.node_ids_) nodes.emplace_back(index, node_index(pnode_id));
+
+    for (size_t b = 0; b < HOUR_BLOCKS; b++) {
+        const HourBlock* theirs = other.hour_blocks_[b].load(std::memory_order_acquire);
+        if (!theirs) continue;
+        for (const auto& [index, mine] : nodes) {
+            const uint64_t bits = word(*theirs, index);
+            if (bits == 0 || mine >= NODE_CHUNKS << CHUNK_BITS) continue;
+            HourBlock* block = claim(hour_blocks_[b], 1);
+            Chunk* chunk = claim(block->chunks[mine >> CHUNK_BITS], size_t(1) << CHUNK_BITS);
+            chunk[mine & ((1u << CHUNK_BITS) - 1)].fetch_or(bits, std::memory_order_relaxed);
+        }
+    }
+}
+
+void DataQuality::record(RowIssue issue, const std::string& file, uint64_t offset, const char* line,
+                         size_t len) {
+    const long long seen = counts_[issue]++;
+    if (strict_) stopped_ = true;
+    if (seen >= static_cast<long long>(MAX_SAMPLES)) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& samples = samples_[issue];
+    if (samples.size() < MAX_SAMPLES) {
+        samples.push_back({file, offset, std::string(line, std::min(len, SAMPLE_TEXT))});
+    }
+}
+
+long long DataQuality::issues() const {
+    long long total = 0;
+    for (int i = ROW_FEW_FIELDS; i < NUM_ROW_ISSUES; i++) total += counts_[i].load();
+    return total;
+}
+
+std::string DataQuality::first_issue() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = ROW_FEW_FIELDS; i < NUM_ROW_ISSUES; i++) {
+        if (samples_[i].empty()) continue;
+        const Sample& s = samples_[i].front();
+        return std::string(row_issue_name(static_cast<RowIssue>(i))) + " at " + s.file + ":" +
+               std::to_string(s.offset);
+    }
+    return "";
+}
+
+void DataQuality::write_json(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot write output file: " + path);
+    }
+    out << "{\n";
+    out << "  \"lines_checked\": " << checked_.load() << ",\n";
+    out << "  \"lines_with_issues\": " << issues() << ",\n";
+    out << "  \"duplicates_checked\": " << (node_ids_.empty() ? "false" : "true") << ",\n";
+    out << "  \"strict\": " << (strict_ ? "true" : "false") << ",\n";
+    out << "  \"issues\": {";
+    const char* sep = "\n";
+    for (int i = ROW_FEW_FIELDS; i < NUM_ROW_ISSUES; i++) {
+        out << sep << "    " << quoted(row_issue_name(static_cast<RowIssue>(i)))
+            << ": {\"count\": " << counts_[i].load() << ", \"samples\": [";
+        const char* item = "";
+        for (const auto& s : samples_[i]) {
+            out << item << "\n      {\"file\": " << quoted(s.file) << ", \"offset\": " << s.offset
+                << ", \"line\": " << quoted(s.text) << "}";
+            item = ",";
+        }
+        out << (samples_[i].empty() ? "]}" : "\n    ]}");
+        sep = ",\n";
+    }
+    out << "\n  }\n}\n";
+    if (!out.flush()) {
+        throw std::runtime_error("Error writing output file: " + path);
+    }
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include "fast_parser.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What row validation found during a scan: a count per RowIssue and the
+// first few offending lines of each kind (file and byte offset), written as
+// data_quality.json. Each LMPScanner run has its own, so repeated scans in
+// one process (serve reloads, plan repeats) start clean. Clean rows never
+// touch it except for the duplicate test; with strict set, the first issue
+// stops the scan.
+//
+// Duplicates are found with one bitmap over (node index, stamp), the stamp
+// being the hour or, for 5-minute input, the interval: a word holds 64
+// consecutive stamps of one node, and words are laid out by stamp block,
+// then node, so the rows of a time-major file (every node, hour by hour)
+// land on neighbouring words. Blocks and node chunks are allocated on first
+// use and shared by all workers, which set bits atomically, so a repeat is
+// caught whichever worker sees it.
+class DataQuality {
+public:
+    static constexpr size_t MAX_SAMPLES = 10;
+    static constexpr size_t SAMPLE_TEXT = 160;   // bytes of a sampled line kept
+
+    // A worker's pnode_id -> node index map (open addressing), filled from
+    // the shared dictionary on first sight of each node
+    class NodeCache {
+    public:
+        NodeCache() : slots_(1024, {EMPTY, 0}) {}
+
+        // Node index, or -1 if this worker hasn't seen the node yet
+        int64_t find(int pnode_id) const {
+            for (size_t i = slot(pnode_id);; i = (i + 1) & (slots_.size() - 1)) {
+                if (slots_[i].first == pnode_id) return slots_[i].second;
+                if (slots_[i].first == EMPTY) return -1;
+            }
+        }
+
+        void insert(int pnode_id, uint32_t index);
+
+    private:
+        static constexpr int EMPTY = INT_MIN;
+        size_t slot(int pnode_id) const {
+            return (static_cast<uint32_t>(pnode_id) * 0x9E3779B1u) & (slots_.size() - 1);
+        }
+        std::vector<std::pair<int, uint32_t>> slots_;
+        size_t used_ = 0;
+    };
+
+    DataQuality() : hour_blocks_(new std::atomic<HourBlock*>[HOUR_BLOCKS]()) {}
+    ~DataQuality();
+    DataQuality(const DataQuality&) = delete;
+    DataQuality& operator=(const DataQuality&) = delete;
+
+    void set_strict(bool strict) { strict_ = strict; }
+    bool strict() const { return strict_; }
+
+    // Strict mode has seen an issue: sources stop handing out lines
+    bool stopped() const { return stopped_.load(std::memory_order_relaxed); }
+
+    void add_checked(long long lines) { checked_ += lines; }
+
+    // A line that failed validation; `offset` is its first byte in `file`
+    void record(RowIssue issue, const std::string& file, uint64_t offset, const char* line, size_t len);
+
+    // True if (pnode_id, hour_stamp) was already seen, which records it
+    bool duplicate(NodeCache& cache, int pnode_id, int hour_stamp) {
+        int64_t index = cache.find(pnode_id);
+        if (index < 0) {
+            index = node_index(pnode_id);
+            cache.insert(pnode_id, static_cast<uint32_t>(index));
+        }
+        return mark(static_cast<uint32_t>(index), hour_stamp);
+    }
+
+    // The same for 5-minute interval `interval` (0-11) of the hour; a scan
+    // checks either hours or intervals, not both
+    bool duplicate(NodeCache& cache, int pnode_id, int hour_stamp, int interval) {
+        return duplicate(cache, pnode_id, hour_stamp * 12 + interval);
+    }
+
+    // Node-hours seen by both this and `other` (nodes matched by pnode_id);
+    // call once both scans are done
+    long long overlap(const DataQuality& other) const;
+
+    // Add the node-hours `other` has seen to this one's
+    void absorb(const DataQuality& other);
+
+    long long count(RowIssue issue) const { return counts_[issue].load(); }
+    long long issues() const;   // lines with any issue
+    std::string first_issue() const;   // "kind at file:offset", "" if none
+
+    void write_json(const std::string& path) const;
+
+private:
+    struct Sample {
+        std::string file;
+        uint64_t offset;
+        std::string text;
+    };
+
+    static constexpr int HOUR_STAMP_BITS = 24;   // hour stamps, or 5-minute ones up to 2129
+    static constexpr int CHUNK_BITS = 10;        // nodes per chunk: 1024 words, 8 KB
+    static constexpr int NODE_CHUNKS = 64;       // 65536 nodes
+    static constexpr size_t HOUR_BLOCKS = (size_t(1) << HOUR_STAMP_BITS) / 64;
+
+    using Chunk = std::atomic<uint64_t>;   // array of 1 << CHUNK_BITS words
+    struct HourBlock {
+        std::array<std::atomic<Chunk*>, NODE_CHUNKS> chunks{};
+    };
+
+    uint32_t node_index(int pnode_id);
+
+    // The word holding `node`'s 64 hours in `block`, 0 if never set
+    static uint64_t word(const HourBlock& block, uint32_t node) {
+        if (node >= NODE_CHUNKS << CHUNK_BITS) return 0;
+        const Chunk* chunk = block.chunks[node >> CHUNK_BITS].load(std::memory_order_acquire);
+        return chunk ? chunk[node & ((1u << CHUNK_BITS) - 1)].load(std::memory_order_relaxed) : 0;
+    }
+
+    // Pointer in `slot`, allocating it (zeroed) if no worker has yet
+    template <typename T>
+    static T* claim(std::atomic<T*>& slot, size_t count) {
+        T* p = slot.load(std::memory_order_acquire);
+        if (p) return p;
+        T* fresh = new T[count]();
+        if (slot.compare_exchange_strong(p, fresh, std::memory_order_acq_rel)) return fresh;
+        delete[] fresh;   // another worker got there first
+        return p;
+    }
+
+    // Sets the (node, stamp) bit; true if it was already set. Stamps and
+    // nodes past the bitmap's range aren't checked.
+    bool mark(uint32_t node, int hour_stamp) {
+        const uint32_t h = static_cast<uint32_t>(hour_stamp);
+        if (h >> HOUR_STAMP_BITS || node >= NODE_CHUNKS << CHUNK_BITS) return false;
+        HourBlock* block = claim(hour_blocks_[h >> 6], 1);
+        Chunk* chunk = claim(block->chunks[node >> CHUNK_BITS], size_t(1) << CHUNK_BITS);
+        const uint64_t mask = 1ULL << (h & 63);
+        return chunk[node & ((1u << CHUNK_BITS) - 1)].fetch_or(mask, std::memory_order_relaxed) & mask;
+    }
+
+    bool strict_ = false;
+    std::atomic<bool> stopped_{false};
+    std::atomic<long long> checked_{0};
+    std::array<std::atomic<long long>, NUM_ROW_ISSUES> counts_{};
+
+    mutable std::mutex mutex_;
+    std::array<std::vector<Sample>, NUM_ROW_ISSUES> samples_;
+    std::unordered_map<int, uint32_t> node_ids_;
+    std::unique_ptr<std::atomic<HourBlock*>[]> hour_blocks_;   // HOUR_BLOCKS, 2 MB
+};
+
+const char* row_issue_name(RowIssue issue);
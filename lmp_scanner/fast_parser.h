@@ -1,6 +1,22 @@
 #pragma once
+#include "fixed_point.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
+
+// True unless x is inf or nan. std::isfinite can't be used: -ffast-math
+// lets the compiler assume it is always true.
+inline bool is_finite(double x) {
+    constexpr uint64_t EXPONENT = 0x7ffULL << 52;
+    return (std::bit_cast<uint64_t>(x) & EXPONENT) != EXPONENT;
+}
 
 // Ultra-fast CSV parser - zero allocations, direct parsing
 struct FastCSVParser {
@@ -21,27 +37,91 @@ struct FastCSVParser {
     inline int parse_int() {
         while (pos < len && data[pos] == ',') pos++;
         
+        size_t start = pos;
         int val = 0;
-        bool neg = data[pos] == '-';
+        bool neg = pos < len && data[pos] == '-';
         if (neg) pos++;
         
+        size_t digits = pos;
         while (pos < len && data[pos] >= '0' && data[pos] <= '9') {
             val = val * 10 + (data[pos++] - '0');
         }
+        if (pos == digits) {
+            // No digits ("" or "-"): nothing is consumed, like strtod
+            pos = start;
+            return 0;
+        }
+        if (pos < len && data[pos] == ',') pos++; // Consume delimiter
         
         return neg ? -val : val;
     }
     
-    // Parse double using strtod (fastest standard method)
+    // Parse double with std::from_chars, several times faster than strtod
+    // and rounded the same. A field it doesn't take whole (a leading '+' or
+    // space, hex, out of range) goes through strtod as before.
     inline double parse_double() {
         while (pos < len && data[pos] == ',') pos++;
         
-        char* end;
-        double val = strtod(data + pos, &end);
-        pos = end - data;
+        double val = 0.0;
+        auto [stop, ec] = std::from_chars(data + pos, data + len, val);
+        if (ec == std::errc() && (stop == data + len || *stop == ',')) {
+            pos = stop - data;
+        } else {
+            char* end;
+            val = strtod(data + pos, &end);
+            pos = end - data;
+        }
+        if (pos < len && data[pos] == ',') pos++; // Consume delimiter
         return val;
     }
     
+    // Parse a decimal as fixed-point (1e-5 units) without going through a
+    // double; digits past the fifth decimal round half away from zero
+    inline int64_t parse_fixed() {
+        while (pos < len && data[pos] == ',') pos++;
+        
+        size_t start = pos;
+        bool neg = pos < len && data[pos] == '-';
+        if (pos < len && (data[pos] == '-' || data[pos] == '+')) pos++;
+        
+        int64_t whole = 0;
+        const size_t whole_start = pos;
+        while (pos < len && data[pos] >= '0' && data[pos] <= '9') {
+            whole = whole * 10 + (data[pos++] - '0');
+        }
+        const bool has_whole = pos > whole_start;
+        int64_t frac = 0;
+        int decimals = 0;
+        bool round_up = false;
+        if (pos < len && data[pos] == '.') {
+            pos++;
+            while (pos < len && data[pos] >= '0' && data[pos] <= '9') {
+                if (decimals < FIXED_DECIMALS) {
+                    frac = frac * 10 + (data[pos] - '0');
+                } else if (decimals == FIXED_DECIMALS) {
+                    round_up = data[pos] >= '5';
+                }
+                decimals++;
+                pos++;
+            }
+        }
+        if (!has_whole && decimals == 0) {
+            // No digits ("-", ".", "-."): nothing is consumed, like strtod
+            pos = start;
+            return 0;
+        }
+        if (pos < len && (data[pos] == 'e' || data[pos] == 'E')) {
+            // Exponent notation is rare enough to take the slow path
+            pos = start;
+            return to_fixed(parse_double());
+        }
+        for (int d = std::min(decimals, FIXED_DECIMALS); d < FIXED_DECIMALS; d++) frac *= 10;
+        
+        if (pos < len && data[pos] == ',') pos++; // Consume delimiter
+        int64_t value = whole * FIXED_SCALE + frac + round_up;
+        return neg ? -value : value;
+    }
+    
     // Parse string (copies to output)
     inline void parse_string(char* out, size_t max_len) {
         while (pos < len && data[pos] == ',') pos++;
@@ -54,53 +134,207 @@ struct FastCSVParser {
     }
 };
 
-// Optimized row parser for your specific CSV format
+// Days since 1970-01-01 for a proleptic Gregorian date (Hinnant's algorithm)
+inline int days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const int yoe = y - era * 400;
+    const int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Hours since the epoch from "YYYY-MM-DD HH..." (or 'T' separator); -1 if malformed
+inline int parse_hour_stamp(const char* s, size_t len) {
+    if (len < 13) return -1;
+    auto digit = [&](int i) { return s[i] - '0'; };
+    for (int i : {0, 1, 2, 3, 5, 6, 8, 9, 11, 12}) {
+        if (static_cast<unsigned>(digit(i)) > 9) return -1;
+    }
+    int y = digit(0) * 1000 + digit(1) * 100 + digit(2) * 10 + digit(3);
+    int m = digit(5) * 10 + digit(6);
+    int d = digit(8) * 10 + digit(9);
+    int h = digit(11) * 10 + digit(12);
+    if (m < 1 || m > 12 || d < 1 || d > 31 || h < 0 || h > 23) return -1;
+    return days_from_civil(y, m, d) * 24 + h;
+}
+
+// 5-minute interval within the hour (0-11) from "YYYY-MM-DD HH:MM..."; -1
+// if the minutes are missing or not on a 5-minute boundary
+inline int parse_interval(const char* s, size_t len) {
+    if (len < 16 || s[13] != ':') return -1;
+    const unsigned tens = s[14] - '0', ones = s[15] - '0';
+    if (tens > 5 || ones > 9) return -1;
+    const unsigned minute = tens * 10 + ones;
+    return minute % 5 == 0 ? static_cast<int>(minute / 5) : -1;
+}
+
+// Column positions in the merged CSV
+enum CSVColumn {
+    COL_CONG_DA = 7,
+    COL_LOSS_DA = 8,
+    COL_ENERGY_DA = 9,
+    COL_CONG_RT = 17,
+    COL_LOSS_RT = 18,
+    COL_ENERGY_RT = 19,
+    COL_DATETIME = 20,
+    COL_PNODE_ID = 21,
+    COL_ZONE = 22,
+    COL_SPREAD = 23,
+    NUM_COLUMNS = 24
+};
+
+// Why a line didn't become a row. The parser reports all but the last;
+// duplicates are found after parsing (see DataQuality).
+enum RowIssue : uint8_t {
+    ROW_OK,
+    ROW_FILTERED,         // rejected by a RowFilter, not an error
+    ROW_FEW_FIELDS,
+    ROW_EXTRA_FIELDS,     // columns shifted, e.g. by an unquoted comma
+    ROW_BAD_DATETIME,     // not "YYYY-MM-DD HH...", month/day/hour out of range, or
+                          // (5-minute input) minutes off a 5-minute boundary
+    ROW_BAD_NUMBER,       // pnode_id or a price empty or not wholly numeric
+    ROW_DUPLICATE,        // a second row for the same (node, hour), or 5-minute interval
+    NUM_ROW_ISSUES
+};
+
+// Row predicates pushed down into the parser. They only look at the
+// datetime, pnode_id and zone columns, so a rejected row never reaches
+// strtod.
+struct RowFilter {
+    static constexpr uint32_t ALL_HOURS = (1u << 24) - 1;
+    
+    int from_hour = INT_MIN;   // inclusive, hours since epoch
+    int to_hour = INT_MAX;     // inclusive
+    std::string zone;          // empty = any zone
+    std::vector<int> nodes;    // sorted; empty = any node
+    uint32_t hours = ALL_HOURS; // bit h set = hour-of-day h accepted
+    
+    bool active() const {
+        return from_hour != INT_MIN || to_hour != INT_MAX || !zone.empty() || !nodes.empty() ||
+               hours != ALL_HOURS;
+    }
+    
+    bool accepts_time(int hour_stamp) const {
+        return hour_stamp >= from_hour && hour_stamp <= to_hour;
+    }
+    
+    bool accepts_hour(int hour) const {
+        return (hours >> hour) & 1u;
+    }
+    
+    bool accepts_node(int pnode_id) const {
+        return nodes.empty() || std::binary_search(nodes.begin(), nodes.end(), pnode_id);
+    }
+    
+    bool accepts_zone(const char* value, size_t len) const {
+        return zone.empty() || (zone.size() == len && std::memcmp(zone.data(), value, len) == 0);
+    }
+};
+
+// Optimized row parser for your specific CSV format. One delimiter scan
+// locates every field; filters run on the cheap columns first, and price
+// components a run doesn't use are never converted.
+//
+// Validation rides on the same pass: the field count falls out of the
+// delimiter scan, and a number is well formed when its conversion stops
+// exactly at the field's end. A rejected line sets `issue` (if given).
+//
+// With Fixed, prices are parsed as exact fixed-point integers into fixed[]
+// (spread, cong_da, cong_rt, energy_da, energy_rt, loss_da, loss_rt) and the
+// double outputs are derived from them.
 struct CSVRowParser {
+    template <bool Components = true, bool WithLoss = true, bool Fixed = false>
     static inline bool parse(const char* line, size_t len,
                             int& pnode_id, char* zone, double& spread,
                             double& cong_da, double& cong_rt,
                             double& energy_da, double& energy_rt,
-                            int& hour) {
-        FastCSVParser p(line, len);
+                            double& loss_da, double& loss_rt,
+                            int& hour, int& hour_stamp,
+                            const RowFilter* filter = nullptr,
+                            int64_t* fixed = nullptr,
+                            RowIssue* issue = nullptr,
+                            int* interval = nullptr) {
+        auto reject = [&](RowIssue why) {
+            if (issue) *issue = why;
+            return false;
+        };
         
-        // Skip to column 7 (congestion_da)
-        for (int i = 0; i < 7; i++) p.skip();
-        cong_da = p.parse_double();
-        
-        p.skip(); // loss_da (col 8)
-        energy_da = p.parse_double(); // col 9
-        
-        // Skip to column 17 (congestion_rt)
-        for (int i = 0; i < 7; i++) p.skip();
-        cong_rt = p.parse_double();
-        
-        p.skip(); // loss_rt (col 18)
-        energy_rt = p.parse_double(); // col 19
-        
-        // Parse datetime for hour (col 20)
-        p.skip();
-        // Extract hour from datetime string "YYYY-MM-DD HH:MM:SS"
-        // Fast forward to space, then parse HH
-        const char* dt_start = line + p.pos;
-        while (p.pos < len && line[p.pos] != ' ' && line[p.pos] != ',') p.pos++;
-        if (p.pos < len && line[p.pos] == ' ') {
-            p.pos++;
-            hour = (line[p.pos] - '0') * 10 + (line[p.pos + 1] - '0');
-        } else {
-            hour = 0;
+        // start[i] is the offset of field i; start[i + 1] - 1 is its end
+        uint32_t start[NUM_COLUMNS + 1];
+        start[0] = 0;
+        const char* cursor = line;
+        const char* end = line + len;
+        for (int i = 1; i < NUM_COLUMNS; i++) {
+            const char* comma = static_cast<const char*>(std::memchr(cursor, ',', end - cursor));
+            if (!comma) return reject(ROW_FEW_FIELDS);
+            start[i] = comma - line + 1;
+            cursor = comma + 1;
         }
+        start[NUM_COLUMNS] = len + 1;
+        if (std::memchr(cursor, ',', end - cursor)) return reject(ROW_EXTRA_FIELDS);
+        
+        auto field_len = [&](int col) { return start[col + 1] - 1 - start[col]; };
         
-        p.skip(); // Move past datetime
+        // Datetime (col 20): "YYYY-MM-DD HH:MM:SS"
+        hour_stamp = parse_hour_stamp(line + start[COL_DATETIME], field_len(COL_DATETIME));
+        if (hour_stamp < 0) return reject(ROW_BAD_DATETIME);
+        if (interval) {
+            *interval = parse_interval(line + start[COL_DATETIME], field_len(COL_DATETIME));
+            if (*interval < 0) return reject(ROW_BAD_DATETIME);
+        }
+        hour = hour_stamp % 24;
+        if (filter && (!filter->accepts_time(hour_stamp) || !filter->accepts_hour(hour))) {
+            return reject(ROW_FILTERED);
+        }
         
-        // Parse pnode_id (col 21)
+        FastCSVParser p(line, len);
+        
+        // pnode_id (col 21)
+        p.pos = start[COL_PNODE_ID];
         pnode_id = p.parse_int();
+        if (field_len(COL_PNODE_ID) == 0 || p.pos != start[COL_PNODE_ID + 1]) return reject(ROW_BAD_NUMBER);
+        if (filter && !filter->accepts_node(pnode_id)) return reject(ROW_FILTERED);
         
-        // Parse zone (col 22)
-        p.parse_string(zone, 32);
+        // Zone (col 22)
+        size_t zone_len = std::min<size_t>(field_len(COL_ZONE), 31);
+        if (filter && !filter->accepts_zone(line + start[COL_ZONE], field_len(COL_ZONE))) {
+            return reject(ROW_FILTERED);
+        }
+        std::memcpy(zone, line + start[COL_ZONE], zone_len);
+        zone[zone_len] = '\0';
         
-        // Parse spread (col 23)
-        spread = p.parse_double();
+        // Prices, only for rows that passed. A conversion that stops short
+        // of the field's end, or (for an empty field) runs past it, fails.
+        bool numbers_ok = true;
+        auto price = [&](int col, int slot) {
+            p.pos = start[col];
+            const size_t field_end = start[col + 1] - 1;
+            double value;
+            if constexpr (Fixed) {
+                fixed[slot] = p.parse_fixed();
+                value = from_fixed(fixed[slot]);
+            } else {
+                (void)slot;
+                value = p.parse_double();
+            }
+            numbers_ok &= field_len(col) > 0 && p.pos - field_end <= 1 && is_finite(value);
+            return value;
+        };
+        spread = price(COL_SPREAD, 0);
+        if constexpr (Components) {
+            cong_da = price(COL_CONG_DA, 1);
+            cong_rt = price(COL_CONG_RT, 2);
+            energy_da = price(COL_ENERGY_DA, 3);
+            energy_rt = price(COL_ENERGY_RT, 4);
+        }
+        if constexpr (WithLoss) {
+            loss_da = price(COL_LOSS_DA, 5);
+            loss_rt = price(COL_LOSS_RT, 6);
+        }
+        if (!numbers_ok) return reject(ROW_BAD_NUMBER);
         
+        if (issue) *issue = ROW_OK;
         return true;
     }
-};
\ No newline at end of file
+};
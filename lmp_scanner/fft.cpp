@@ -0,0 +1,93 @@
+#include "fft.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Complex points per block in the blocked stages: 1024 x 16 bytes = 16 KB
+const size_t BLOCK_POINTS = 1024;
+
+// One radix-2 stage (butterflies spanning 2h points) over data[0, len)
+template <bool Inverse>
+void butterflies(std::complex<double>* data, size_t len, size_t h, const std::complex<double>* twiddle,
+                 size_t stride) {
+    for (size_t base = 0; base < len; base += 2 * h) {
+        std::complex<double>* lo = data + base;
+        std::complex<double>* hi = lo + h;
+        for (size_t j = 0; j < h; j++) {
+            const std::complex<double> w = Inverse ? std::conj(twiddle[j * stride]) : twiddle[j * stride];
+            const std::complex<double> b = hi[j] * w;
+            hi[j] = lo[j] - b;
+            lo[j] += b;
+        }
+    }
+}
+
+} // namespace
+
+RealFFT::RealFFT(size_t n) : n_(n), m_(n / 2) {
+    if (n < 4 || (n & (n - 1)) != 0) {
+        throw std::runtime_error("FFT length must be a power of two of at least 4: " + std::to_string(n));
+    }
+    const double pi = std::acos(-1.0);
+    twiddle_.resize(m_ / 2);
+    for (size_t j = 0; j < twiddle_.size(); j++) twiddle_[j] = std::polar(1.0, -2 * pi * j / m_);
+    split_.resize(m_ + 1);
+    for (size_t k = 0; k <= m_; k++) split_[k] = std::polar(1.0, -2 * pi * k / n_);
+
+    int bits = 0;
+    while ((size_t(1) << bits) < m_) bits++;
+    for (uint32_t i = 0; i < m_; i++) {
+        uint32_t r = 0;
+        for (int b = 0; b < bits; b++) r |= ((i >> b) & 1u) << (bits - 1 - b);
+        if (i < r) swaps_.emplace_back(i, r);
+    }
+    scratch_.resize(m_);
+}
+
+void RealFFT::transform(Complex* data, bool inverse) const {
+    for (const auto& [i, r] : swaps_) std::swap(data[i], data[r]);
+
+    // Stages whose butterflies stay inside one block run block by block,
+    // while the block is in L1; the wider stages then sweep the array
+    const size_t block = std::min(BLOCK_POINTS, m_);
+    auto stage = inverse ? butterflies<true> : butterflies<false>;
+    for (size_t start = 0; start < m_; start += block) {
+        for (size_t h = 1; h < block; h *= 2) stage(data + start, block, h, twiddle_.data(), m_ / (2 * h));
+    }
+    for (size_t h = block; h < m_; h *= 2) stage(data, m_, h, twiddle_.data(), m_ / (2 * h));
+}
+
+void RealFFT::forward(const double* in, Complex* out) {
+    Complex* z = scratch_.data();
+    for (size_t i = 0; i < m_; i++) z[i] = Complex(in[2 * i], in[2 * i + 1]);
+    transform(z, false);
+
+    // Separate the transforms of the even and odd samples, then combine
+    for (size_t k = 0; k <= m_; k++) {
+        const Complex a = z[k == m_ ? 0 : k];
+        const Complex b = std::conj(z[k == 0 ? 0 : m_ - k]);
+        const Complex even = 0.5 * (a + b);
+        const Complex odd = Complex(0.0, -0.5) * (a - b);
+        out[k] = even + split_[k] * odd;
+    }
+}
+
+void RealFFT::inverse(const Complex* in, double* out) {
+    Complex* z = scratch_.data();
+    for (size_t k = 0; k < m_; k++) {
+        const Complex a = in[k];
+        const Complex b = std::conj(in[m_ - k]);
+        const Complex even = 0.5 * (a + b);
+        const Complex odd = 0.5 * (a - b) * std::conj(split_[k]);
+        z[k] = even + Complex(0.0, 1.0) * odd;
+    }
+    transform(z, true);
+
+    const double scale = 1.0 / m_;
+    for (size_t i = 0; i < m_; i++) {
+        out[2 * i] = z[i].real() * scale;
+        out[2 * i + 1] = z[i].imag() * scale;
+    }
+}
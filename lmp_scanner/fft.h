@@ -0,0 +1,36 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Real-input FFT of a fixed power-of-two length n, computed as a complex FFT
+// of n/2 points (even samples real, odd samples imaginary) plus one split
+// pass. The complex FFT is iterative radix-2; its first stages run block by
+// block over L1-sized spans, so only the last few stages stream the whole
+// array. Instances hold a scratch buffer: one per thread.
+class RealFFT {
+public:
+    using Complex = std::complex<double>;
+
+    explicit RealFFT(size_t n);
+
+    size_t size() const { return n_; }
+    size_t bins() const { return m_ + 1; }   // non-negative frequencies, 0..n/2
+
+    // n samples -> bins() coefficients
+    void forward(const double* in, Complex* out);
+
+    // bins() coefficients -> n samples, scaled so inverse(forward(x)) == x
+    void inverse(const Complex* in, double* out);
+
+private:
+    void transform(Complex* data, bool inverse) const;
+
+    size_t n_;
+    size_t m_;                         // complex FFT length, n/2
+    std::vector<Complex> twiddle_;     // e^{-2 pi i j / m}, j < m/2
+    std::vector<Complex> split_;       // e^{-2 pi i k / n}, k <= m
+    std::vector<std::pair<uint32_t, uint32_t>> swaps_;   // bit-reversal permutation
+    std::vector<Complex> scratch_;
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Fixed-point prices: integer counts of 1e-5 $/MWh. PJM publishes LMPs with
+// at most five decimals, so every published price is represented exactly.
+const int FIXED_DECIMALS = 5;
+const int64_t FIXED_SCALE = 100000;
+
+inline int64_t to_fixed(double price) {
+    return std::llround(price * FIXED_SCALE);
+}
+
+inline double from_fixed(int64_t value) {
+    return static_cast<double>(value) / FIXED_SCALE;
+}
+
+// Integer moments of a run of fixed-point values. Sums are exact, so runs
+// can be reduced in any order or split across threads with identical results.
+struct FixedMoments {
+    int64_t count = 0;
+    int64_t sum = 0;
+    __int128 sum_sq = 0;
+    int64_t sum_abs = 0;
+    int64_t positive = 0;
+    int32_t min = INT32_MAX;
+    int32_t max = INT32_MIN;
+};
+
+inline FixedMoments reduce_fixed_scalar(const int32_t* values, size_t n) {
+    FixedMoments m;
+    m.count = static_cast<int64_t>(n);
+    for (size_t i = 0; i < n; i++) {
+        int64_t x = values[i];
+        m.sum += x;
+        m.sum_sq += static_cast<__int128>(x * x);
+        m.sum_abs += x < 0 ? -x : x;
+        m.positive += x > 0;
+        m.min = std::min(m.min, values[i]);
+        m.max = std::max(m.max, values[i]);
+    }
+    return m;
+}
+
+#ifdef __AVX2__
+// Eight lanes per step. Squares (< 2^62) are split into high and low 32-bit
+// halves before accumulating, so the 64-bit lanes cannot overflow for any
+// run shorter than 2^31 values.
+inline FixedMoments reduce_fixed_avx2(const int32_t* values, size_t n) {
+    const __m256i low_mask = _mm256_set1_epi64x(0xffffffffLL);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero, sum_abs = zero, sq_hi = zero, sq_lo = zero, positive = zero;
+    __m256i vmin = _mm256_set1_epi32(INT32_MAX);
+    __m256i vmax = _mm256_set1_epi32(INT32_MIN);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        __m256i lo = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v));
+        __m256i hi = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1));
+        sum = _mm256_add_epi64(sum, _mm256_add_epi64(lo, hi));
+
+        __m256i a = _mm256_abs_epi32(v);
+        sum_abs = _mm256_add_epi64(sum_abs, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(a)));
+        sum_abs = _mm256_add_epi64(sum_abs, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(a, 1)));
+
+        __m256i sq_a = _mm256_mul_epi32(lo, lo);
+        __m256i sq_b = _mm256_mul_epi32(hi, hi);
+        sq_hi = _mm256_add_epi64(sq_hi, _mm256_add_epi64(_mm256_srli_epi64(sq_a, 32),
+                                                         _mm256_srli_epi64(sq_b, 32)));
+        sq_lo = _mm256_add_epi64(sq_lo, _mm256_add_epi64(_mm256_and_si256(sq_a, low_mask),
+                                                         _mm256_and_si256(sq_b, low_mask)));
+
+        // Compare mask is -1 per positive lane
+        positive = _mm256_sub_epi32(positive, _mm256_cmpgt_epi32(v, zero));
+        vmin = _mm256_min_epi32(vmin, v);
+        vmax = _mm256_max_epi32(vmax, v);
+    }
+
+    alignas(32) int64_t l_sum[4], l_abs[4], l_hi[4], l_lo[4];
+    alignas(32) int32_t l_pos[8], l_min[8], l_max[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(l_sum), sum);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(l_abs), sum_abs);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(l_hi), sq_hi);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(l_lo), sq_lo);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(l_pos), positive);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(l_min), vmin);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(l_max), vmax);
+
+    FixedMoments m = reduce_fixed_scalar(values + i, n - i);
+    m.count = static_cast<int64_t>(n);
+    for (int k = 0; k < 4; k++) {
+        m.sum += l_sum[k];
+        m.sum_abs += l_abs[k];
+        m.sum_sq += (static_cast<__int128>(l_hi[k]) << 32) + l_lo[k];
+    }
+    for (int k = 0; k < 8; k++) {
+        m.positive += l_pos[k];
+        m.min = std::min(m.min, l_min[k]);
+        m.max = std::max(m.max, l_max[k]);
+    }
+    return m;
+}
+#endif
+
+inline FixedMoments reduce_fixed(const int32_t* values, size_t n) {
+#ifdef __AVX2__
+    return reduce_fixed_avx2(values, n);
+#else
+    return reduce_fixed_scalar(values, n);
+#endif
+}
@@ -0,0 +1,234 @@
+// Writes synthetic data in the merged CSV layout fetch.py produces, for
+// scale tests and for sharing inputs that contain no real market data.
+//
+//   lmp_gen out.csv --nodes 12000 --hours 5832 --threads 8
+//   lmp_gen - --nodes 500 --hours 48 --zones PECO=3,PSEG=2,DOM=1 | lmp_scanner -
+//
+// Options:
+//   --nodes N, --hours H     size (rows = N x H, written hour by hour)
+//   --seed S                 the same seed gives the same file
+//   --start YYYY-MM-DD       first operating day (default 2025-01-01)
+//   --zones Z=W,...          relative node share per zone (default: even)
+//   --tail-index A           power-law tails on RT congestion (smaller = heavier)
+//   --zone-corr R            share of RT congestion noise common to a zone (0-1)
+//   --malformed F            fraction of lines damaged the ways real dumps are
+//   --threads T              formatting threads (default: all cores)
+//   --no-header              omit the header line
+//   --help                   print this usage
+//
+// Rows are formatted in parallel in fixed-size chunks and written in order,
+// so the output doesn't depend on the thread count.
+#include "synthetic.h"
+#include "fast_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const uint64_t CHUNK_ROWS = 16384;
+
+// "PECO=3,PSEG=2" as weights by synthetic zone index; unlisted zones get none
+std::vector<double> parse_zone_weights(const std::string& value) {
+    std::vector<double> weights(synthetic_zone_count(), 0.0);
+    size_t start = 0;
+    while (start < value.size()) {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos) end = value.size();
+        std::string item = value.substr(start, end - start);
+        size_t eq = item.find('=');
+        std::string zone = item.substr(0, eq);
+        double weight = eq == std::string::npos ? 1.0 : std::stod(item.substr(eq + 1));
+        int index = -1;
+        for (int z = 0; z < synthetic_zone_count(); z++) {
+            if (zone == synthetic_zone(z)) index = z;
+        }
+        if (index < 0 || weight < 0) {
+            throw std::runtime_error("Invalid zone weight: " + item);
+        }
+        weights[index] = weight;
+        start = end + 1;
+    }
+    if (std::all_of(weights.begin(), weights.end(), [](double w) { return w == 0; })) {
+        throw std::runtime_error("--zones needs at least one positive weight");
+    }
+    return weights;
+}
+
+// Formats chunks on every thread and hands them to the file in chunk order
+class ChunkWriter {
+public:
+    ChunkWriter(const SyntheticSpec& spec, FILE* out) : spec_(spec), out_(out) {}
+
+    void run(int threads) {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([this]() { work(); });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (!error_.empty()) throw std::runtime_error(error_);
+    }
+
+    uint64_t bytes() const { return bytes_; }
+    uint64_t malformed() const { return malformed_; }
+
+private:
+    const SyntheticSpec& spec_;
+    FILE* out_;
+    std::atomic<uint64_t> next_chunk_{0};
+    std::mutex mutex_;
+    std::condition_variable turn_;
+    uint64_t next_write_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t malformed_ = 0;
+    std::string error_;
+
+    void work() {
+        std::unique_ptr<char[]> buffer(new char[CHUNK_ROWS * SYNTHETIC_MAX_LINE]);
+        SyntheticCursor cursor(spec_);
+        for (;;) {
+            const uint64_t chunk = next_chunk_++;
+            const uint64_t first = chunk * CHUNK_ROWS;
+            if (first >= spec_.rows()) break;
+            const uint64_t last = std::min(spec_.rows(), first + CHUNK_ROWS);
+
+            size_t used = 0;
+            uint64_t damaged = 0;
+            cursor.seek(first);
+            for (uint64_t i = first; i < last; i++) {
+                char* line = &buffer[used];
+                size_t len = format_synthetic_row(cursor.next(), line);
+                damaged += corrupt_synthetic_line(spec_, i, line, len);
+                used += len;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            turn_.wait(lock, [&]() { return next_write_ == chunk || !error_.empty(); });
+            if (!error_.empty()) break;
+            if (std::fwrite(buffer.get(), 1, used, out_) != used) {
+                error_ = "Error writing output";
+            }
+            bytes_ += used;
+            malformed_ += damaged;
+            next_write_++;
+            turn_.notify_all();
+        }
+    }
+};
+
+void print_usage(std::ostream& out, const char* program) {
+    out << "Usage: " << program
+        << " <out.csv|-> [--nodes N] [--hours H] [--seed S] [--start YYYY-MM-DD]"
+        << " [--zones Z=W,...] [--tail-index A] [--zone-corr R] [--malformed F]"
+        << " [--threads T] [--no-header]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage(std::cout, argv[0]);
+            return 0;
+        }
+    }
+    if (argc < 2) {
+        print_usage(std::cerr, argv[0]);
+        return 1;
+    }
+
+    // A mistyped flag in first position must not become a ~200 MB file named after it
+    const std::string out_path = argv[1];
+    if (out_path.size() > 1 && out_path[0] == '-') {
+        std::cerr << "Error: Expected an output path, got option " << out_path
+                  << " (use ./" << out_path << " for a file of that name)" << std::endl;
+        print_usage(std::cerr, argv[0]);
+        return 1;
+    }
+    SyntheticSpec spec;
+    spec.start_hour = days_from_civil(2025, 1, 1) * 24;
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    bool header = true;
+
+    try {
+        for (int i = 2; i < argc; i++) {
+            std::string flag = argv[i];
+            if (flag == "--no-header") {
+                header = false;
+                continue;
+            }
+            if (i + 1 >= argc) throw std::runtime_error("Missing value for " + flag);
+            std::string value = argv[++i];
+            if (flag == "--nodes") spec.nodes = std::stoi(value);
+            else if (flag == "--hours") spec.hours = std::stoi(value);
+            else if (flag == "--seed") spec.seed = std::stoull(value);
+            else if (flag == "--threads") threads = std::stoi(value);
+            else if (flag == "--zones") spec.zone_weights = parse_zone_weights(value);
+            else if (flag == "--tail-index") spec.tail_index = std::stod(value);
+            else if (flag == "--zone-corr") spec.zone_correlation = std::stod(value);
+            else if (flag == "--malformed") spec.malformed_rate = std::stod(value);
+            else if (flag == "--start") {
+                std::string stamp = value + " 00";
+                spec.start_hour = parse_hour_stamp(stamp.c_str(), stamp.size());
+                if (value.size() != 10 || spec.start_hour < 0) {
+                    throw std::runtime_error("Invalid date: " + value + " (expected YYYY-MM-DD)");
+                }
+            } else {
+                throw std::runtime_error("Unknown option: " + flag);
+            }
+        }
+        if (spec.nodes <= 0 || spec.hours <= 0) throw std::runtime_error("--nodes and --hours must be positive");
+        if (spec.zone_correlation < 0 || spec.zone_correlation > 1) throw std::runtime_error("--zone-corr must be 0-1");
+        if (spec.tail_index < 0) throw std::runtime_error("--tail-index must be positive");
+        if (spec.malformed_rate < 0 || spec.malformed_rate > 1) throw std::runtime_error("--malformed must be 0-1");
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    threads = std::max(threads, 1);
+
+    // With the data on stdout, progress goes to stderr
+    const bool to_stdout = out_path == "-";
+    std::ostream& log = to_stdout ? std::cerr : std::cout;
+    FILE* out = to_stdout ? stdout : std::fopen(out_path.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Error: Cannot write output file: " << out_path << std::endl;
+        return 1;
+    }
+
+    log << "Generating " << spec.rows() << " rows (" << spec.nodes << " nodes x " << spec.hours
+        << " hours, seed " << spec.seed << ") on " << threads << " threads..." << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        if (header) {
+            std::fputs(SYNTHETIC_CSV_HEADER, out);
+            std::fputc('\n', out);
+        }
+        ChunkWriter writer(spec, out);
+        writer.run(threads);
+        if ((to_stdout ? std::fflush(out) : std::fclose(out)) != 0) {
+            throw std::runtime_error("Error writing output file: " + out_path);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        log << "Wrote " << (writer.bytes() >> 20) << " MB";
+        if (spec.malformed_rate > 0) log << " (" << writer.malformed() << " malformed rows)";
+        log << " in " << seconds << "s, " << writer.bytes() / seconds / 1e9 << " GB/s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+// Minimal C++20 generator: a coroutine that co_yields references. Values
+// are never copied, so a generator of batches hands the consumer the
+// producer's own buffer. Exceptions propagate to the consumer on resume.
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        T* value = nullptr;
+        std::exception_ptr error;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T& v) noexcept {
+            value = &v;
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        explicit iterator(Handle h) : handle_(h) {}
+        T& operator*() const { return *handle_.promise().value; }
+        iterator& operator++() {
+            resume(handle_);
+            return *this;
+        }
+        bool operator==(std::default_sentinel_t) const { return !handle_ || handle_.done(); }
+
+    private:
+        Handle handle_;
+    };
+
+    explicit Generator(Handle h) : handle_(h) {}
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        if (handle_) handle_.destroy();
+    }
+
+    iterator begin() {
+        resume(handle_);
+        return iterator(handle_);
+    }
+    std::default_sentinel_t end() { return {}; }
+
+private:
+    Handle handle_;
+
+    static void resume(Handle h) {
+        h.resume();
+        if (h.done() && h.promise().error) std::rethrow_exception(h.promise().error);
+    }
+};
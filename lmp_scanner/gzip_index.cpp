@@ -0,0 +1,319 @@
+#include "gzip_index.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+
+const char INDEX_MAGIC[8] = {'L', 'M', 'P', 'G', 'Z', 'I', 'X', '1'};
+
+const size_t WINDOW_BYTES = 32 << 10;   // deflate's largest back-reference
+const size_t CHUNK_BYTES = 256 << 10;
+
+// Window bits for inflateInit2: a gzip member with header and trailer, or a
+// bare deflate stream (resuming at a seek point)
+const int GZIP_STREAM = 15 + 16;
+const int RAW_STREAM = -15;
+
+template <typename T>
+void put(std::ostream& out, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool get(std::istream& in, T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+};
+
+FileStamp stamp_of(int fd, const std::string& path) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0) throw std::runtime_error("Cannot stat gzip file: " + path);
+    return {static_cast<uint64_t>(st.st_size),
+            static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec};
+}
+
+int open_file(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open gzip file: " + path);
+    return fd;
+}
+
+// Closes the descriptor and ends the inflate stream on every exit
+struct InflateScope {
+    z_stream strm{};
+    int fd = -1;
+    bool started = false;
+
+    ~InflateScope() {
+        if (started) inflateEnd(&strm);
+        if (fd >= 0) ::close(fd);
+    }
+
+    void init(int window_bits, const std::string& path) {
+        if (inflateInit2(&strm, window_bits) != Z_OK) {
+            throw std::runtime_error("Cannot start inflate for " + path);
+        }
+        started = true;
+    }
+};
+
+// Reads the sidecar's leading fields; false if they don't match the file
+bool read_stamp(std::istream& in, const FileStamp& stamp) {
+    char magic[8];
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    return in.read(magic, 8) && std::memcmp(magic, INDEX_MAGIC, 8) == 0 && get(in, size) &&
+           get(in, mtime_ns) && size == stamp.size && mtime_ns == stamp.mtime_ns;
+}
+
+} // namespace
+
+bool GzipIndex::is_gzip(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    unsigned char magic[2] = {0, 0};
+    const bool gzip = ::pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+    ::close(fd);
+    return gzip;
+}
+
+bool GzipIndex::sidecar_current(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    FileStamp stamp;
+    try {
+        stamp = stamp_of(fd, path);
+    } catch (const std::exception&) {
+        ::close(fd);
+        return false;
+    }
+    ::close(fd);
+    std::ifstream in(sidecar_path(path), std::ios::binary);
+    return in.is_open() && read_stamp(in, stamp);
+}
+
+bool GzipIndex::load(const std::string& path) {
+    int fd = open_file(path);
+    const FileStamp stamp = stamp_of(fd, path);
+    ::close(fd);
+
+    std::ifstream in(sidecar_path(path), std::ios::binary);
+    if (!in.is_open() || !read_stamp(in, stamp)) return false;
+
+    std::vector<GzipSeekPoint> points;
+    uint64_t total_out = 0, count = 0;
+    uint32_t header_len = 0;
+    if (!get(in, total_out) || !get(in, header_len)) return false;
+    std::string header(header_len, '\0');
+    if (!in.read(header.data(), header_len) || !get(in, count)) return false;
+    points.resize(count);
+    for (auto& p : points) {
+        uint32_t window_len = 0;
+        if (!get(in, p.in) || !get(in, p.out) || !get(in, p.bits) || !get(in, p.line_skip) ||
+            !get(in, window_len) || window_len > WINDOW_BYTES) {
+            return false;
+        }
+        p.window.resize(window_len);
+        if (!in.read(reinterpret_cast<char*>(p.window.data()), window_len)) return false;
+    }
+
+    points_ = std::move(points);
+    total_out_ = total_out;
+    file_size_ = stamp.size;
+    mtime_ns_ = stamp.mtime_ns;
+    header_ = std::move(header);
+    return true;
+}
+
+void GzipIndex::save(const std::string& path) const {
+    const std::string sidecar = sidecar_path(path);
+    const std::string temp = sidecar + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(temp, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot write output file: " + temp);
+        }
+        out.write(INDEX_MAGIC, 8);
+        put(out, file_size_);
+        put(out, mtime_ns_);
+        put(out, total_out_);
+        put(out, static_cast<uint32_t>(header_.size()));
+        out.write(header_.data(), header_.size());
+        put(out, static_cast<uint64_t>(points_.size()));
+        for (const auto& p : points_) {
+            put(out, p.in);
+            put(out, p.out);
+            put(out, p.bits);
+            put(out, p.line_skip);
+            put(out, static_cast<uint32_t>(p.window.size()));
+            out.write(reinterpret_cast<const char*>(p.window.data()), p.window.size());
+        }
+        if (!out.flush()) {
+            std::filesystem::remove(temp);
+            throw std::runtime_error("Error writing output file: " + temp);
+        }
+    }
+    std::filesystem::rename(temp, sidecar);
+}
+
+void GzipIndex::build(const std::string& path, const std::function<void(const char*, size_t)>& sink) {
+    InflateScope z;
+    z.fd = open_file(path);
+    const FileStamp stamp = stamp_of(z.fd, path);
+    z.init(GZIP_STREAM, path);
+    z_stream& strm = z.strm;
+
+    points_.assign(1, GzipSeekPoint());
+    total_out_ = 0;
+    header_.clear();
+
+    std::vector<unsigned char> in(CHUNK_BYTES), out(CHUNK_BYTES);
+    std::vector<unsigned char> history;   // recent output, trimmed to the last window
+    uint64_t read_pos = 0;
+    bool header_done = false;
+    bool pending = true;                  // the last point's first line start isn't known yet
+    bool stream_end = false;
+
+    for (;;) {
+        if (strm.avail_in == 0) {
+            ssize_t n = ::read(z.fd, in.data(), in.size());
+            if (n < 0) throw std::runtime_error("Error reading gzip file: " + path);
+            if (n == 0) break;
+            strm.next_in = in.data();
+            strm.avail_in = n;
+            read_pos += n;
+        }
+        if (stream_end) {
+            // Another member follows
+            inflateReset(&strm);
+            stream_end = false;
+        }
+
+        strm.next_out = out.data();
+        strm.avail_out = out.size();
+        const int ret = inflate(&strm, Z_BLOCK);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            throw std::runtime_error("Corrupt gzip data in " + path);
+        }
+        const size_t produced = out.size() - strm.avail_out;
+        if (produced > 0) {
+            const char* data = reinterpret_cast<const char*>(out.data());
+            if (!header_done) {
+                const char* nl = static_cast<const char*>(std::memchr(data, '\n', produced));
+                header_.append(data, nl ? nl - data : produced);
+                header_done = nl != nullptr;
+                if (header_done && !header_.empty() && header_.back() == '\r') header_.pop_back();
+            }
+            if (pending) {
+                // The first point skips the header; later ones the partial line
+                const char* nl = static_cast<const char*>(std::memchr(data, '\n', produced));
+                if (nl) {
+                    points_.back().line_skip = total_out_ + (nl - data) + 1 - points_.back().out;
+                    pending = false;
+                }
+            }
+            history.insert(history.end(), out.begin(), out.begin() + produced);
+            if (history.size() > 4 * WINDOW_BYTES) {
+                history.erase(history.begin(), history.end() - WINDOW_BYTES);
+            }
+            if (sink) sink(data, produced);
+            total_out_ += produced;
+        }
+        if (ret == Z_STREAM_END) {
+            stream_end = true;
+            continue;
+        }
+
+        // Between two deflate blocks (not after the member's last one)
+        const bool boundary = (strm.data_type & 128) && !(strm.data_type & 64);
+        if (boundary && !pending && total_out_ - points_.back().out >= SPAN) {
+            GzipSeekPoint p;
+            p.in = read_pos - strm.avail_in;
+            p.out = total_out_;
+            p.bits = strm.data_type & 7;
+            const size_t keep = std::min(history.size(), WINDOW_BYTES);
+            p.window.assign(history.end() - keep, history.end());
+            pending = history.empty() || history.back() != '\n';
+            points_.push_back(std::move(p));
+        }
+    }
+    if (!stream_end) throw std::runtime_error("Truncated gzip file: " + path);
+
+    // A last point with no line after it starts an empty span
+    if (pending) points_.back().line_skip = total_out_ - points_.back().out;
+    file_size_ = stamp.size;
+    mtime_ns_ = stamp.mtime_ns;
+}
+
+size_t GzipIndex::read_span(int fd, size_t index, std::vector<char>& buffer) const {
+    const GzipSeekPoint& p = points_[index];
+    const uint64_t to = index + 1 < points_.size() ? points_[index + 1].out + points_[index + 1].line_skip
+                                                   : total_out_;
+    buffer.resize(to - p.out);
+    if (to <= p.out + p.line_skip) return buffer.size();
+
+    InflateScope z;
+    z_stream& strm = z.strm;
+    bool raw = index > 0;
+    z.init(raw ? RAW_STREAM : GZIP_STREAM, "gzip span");
+
+    std::vector<unsigned char> in(CHUNK_BYTES);
+    uint64_t offset = p.in;
+    if (p.bits > 0) {
+        unsigned char byte = 0;
+        if (::pread(fd, &byte, 1, p.in - 1) != 1) throw std::runtime_error("Error reading gzip file");
+        inflatePrime(&strm, p.bits, byte >> (8 - p.bits));
+    }
+    if (!p.window.empty()) {
+        inflateSetDictionary(&strm, p.window.data(), p.window.size());
+    }
+
+    strm.next_out = reinterpret_cast<unsigned char*>(buffer.data());
+    strm.avail_out = buffer.size();
+    size_t skip_trailer = 0;
+    while (strm.avail_out > 0) {
+        if (strm.avail_in == 0) {
+            ssize_t n = ::pread(fd, in.data(), in.size(), offset);
+            if (n <= 0) throw std::runtime_error("Truncated gzip data");
+            strm.next_in = in.data();
+            strm.avail_in = n;
+            offset += n;
+        }
+        if (skip_trailer > 0) {
+            const size_t n = std::min<size_t>(skip_trailer, strm.avail_in);
+            strm.next_in += n;
+            strm.avail_in -= n;
+            skip_trailer -= n;
+            continue;
+        }
+        const int ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            // End of a member. Raw inflate leaves its trailer; from here on
+            // zlib reads each member's header and trailer itself.
+            if (raw) {
+                skip_trailer = 8;
+                raw = false;
+                inflateReset2(&strm, GZIP_STREAM);
+            } else {
+                inflateReset(&strm);
+            }
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            throw std::runtime_error("Corrupt gzip data");
+        }
+    }
+    return p.line_skip;
+}
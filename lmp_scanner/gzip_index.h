@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Random access into gzip files (one member or many concatenated) through
+// seek points. One sequential inflate records a point at a deflate block
+// boundary every SPAN uncompressed bytes, holding the 32KB window the next
+// block may refer back to; from any point a worker can then inflate its
+// span independently. Points are kept in a sidecar next to the file
+// (<file>.lmpidx), so only the first run pays for the sequential pass.
+//
+// Each point also records where the first line starting at or after it
+// begins, so a span decodes to whole lines: from its own first line start
+// to the next span's.
+
+struct GzipSeekPoint {
+    uint64_t in = 0;          // compressed offset of the first whole byte
+    uint64_t out = 0;         // uncompressed offset
+    uint32_t bits = 0;        // bits of the byte before `in` still to be read (0-7)
+    uint32_t line_skip = 0;   // bytes from `out` to the first line start
+    std::vector<unsigned char> window;   // output preceding `out` (up to 32KB)
+};
+
+class GzipIndex {
+public:
+    static constexpr uint64_t SPAN = 8 << 20;
+
+    // Starts with the gzip magic bytes
+    static bool is_gzip(const std::string& path);
+    static std::string sidecar_path(const std::string& path) { return path + ".lmpidx"; }
+
+    // A sidecar exists and matches the file (size and mtime)
+    static bool sidecar_current(const std::string& path);
+
+    // False if there is no sidecar or it was made for another version of
+    // the file (size and mtime)
+    bool load(const std::string& path);
+
+    // The sequential pass; `sink`, if given, receives the decompressed
+    // bytes in order as they are produced
+    void build(const std::string& path, const std::function<void(const char*, size_t)>& sink = {});
+
+    void save(const std::string& path) const;
+
+    size_t spans() const { return points_.size(); }
+    uint64_t total_out() const { return total_out_; }
+    uint64_t file_size() const { return file_size_; }
+    const std::string& header() const { return header_; }   // first line, no newline
+    uint64_t span_offset(size_t index) const { return points_[index].out; }   // uncompressed
+
+    // Decodes span `index` of the open file `fd` into `buffer`, ending at the
+    // next span's first line start; returns the offset of its own first line
+    size_t read_span(int fd, size_t index, std::vector<char>& buffer) const;
+
+private:
+    std::vector<GzipSeekPoint> points_;
+    uint64_t total_out_ = 0;
+    uint64_t file_size_ = 0;
+    int64_t mtime_ns_ = 0;
+    std::string header_;
+};
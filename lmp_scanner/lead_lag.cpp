@@ -0,0 +1,212 @@
+#include "lead_lag.h"
+#include "fft.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Ranking order: stronger first, then by node ids so ties are stable
+bool stronger(const LeadLag& a, const LeadLag& b) {
+    const double x = std::abs(a.correlation), y = std::abs(b.correlation);
+    if (x != y) return x > y;
+    if (a.leader != b.leader) return a.leader < b.leader;
+    return a.follower < b.follower;
+}
+
+// The best `limit` pairs seen, as a heap with the weakest on top
+class TopPairs {
+public:
+    explicit TopPairs(size_t limit) : limit_(limit) {}
+
+    void add(const LeadLag& pair) {
+        if (heap_.size() == limit_ && !stronger(pair, heap_.front())) return;
+        heap_.push_back(pair);
+        std::push_heap(heap_.begin(), heap_.end(), stronger);
+        if (heap_.size() > limit_) {
+            std::pop_heap(heap_.begin(), heap_.end(), stronger);
+            heap_.pop_back();
+        }
+    }
+
+    void merge(const TopPairs& other) {
+        for (const auto& pair : other.heap_) add(pair);
+    }
+
+    std::vector<LeadLag> sorted() const {
+        std::vector<LeadLag> out = heap_;
+        std::sort(out.begin(), out.end(), stronger);
+        return out;
+    }
+
+private:
+    size_t limit_;
+    std::vector<LeadLag> heap_;
+};
+
+// Run `work` on `threads` threads and wait for them
+template <typename Work>
+void on_workers(int threads, Work work) {
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) workers.emplace_back(work);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+LeadLagResult find_lead_lag(const std::unordered_map<int, std::vector<SeriesPoint>>& series,
+                            const std::vector<std::vector<int>>& groups, int threads,
+                            const LeadLagParams& params) {
+    LeadLagResult result;
+
+    // One hourly grid for every node
+    int first = INT_MAX, last = INT_MIN;
+    for (const auto& group : groups) {
+        for (int node_id : group) {
+            auto it = series.find(node_id);
+            if (it == series.end()) continue;
+            for (const auto& p : it->second) {
+                first = std::min(first, p.hour_stamp);
+                last = std::max(last, p.hour_stamp);
+            }
+        }
+    }
+    if (first > last) return result;
+    const size_t grid = static_cast<size_t>(last - first) + 1;
+
+    // Zero padding past max_lag keeps the circular correlation linear
+    size_t n = 4;
+    while (n < grid + params.max_lag) n *= 2;
+    result.fft_size = n;
+    const size_t bins = n / 2 + 1;
+
+    TopPairs top(params.top);
+    for (const auto& group : groups) {
+        // Nodes with enough rows to standardize
+        std::vector<int> nodes;
+        for (int node_id : group) {
+            auto it = series.find(node_id);
+            if (it != series.end() && static_cast<int>(it->second.size()) >= params.min_rows) {
+                nodes.push_back(node_id);
+            }
+        }
+        if (nodes.size() < 2) continue;
+
+        // Spectrum of each node's standardized series, and of its presence
+        // mask when it has missing hours
+        std::vector<RealFFT::Complex> spectra(nodes.size() * bins);
+        std::vector<char> usable(nodes.size(), 0);
+        std::vector<int> mask_slot(nodes.size(), -1);
+        for (size_t k = 0, slots = 0; k < nodes.size(); k++) {
+            if (series.at(nodes[k]).size() < grid) mask_slot[k] = static_cast<int>(slots++);
+        }
+        const size_t gapped = std::count_if(mask_slot.begin(), mask_slot.end(), [](int s) { return s >= 0; });
+        std::vector<RealFFT::Complex> masks((gapped + 1) * bins);
+        auto mask = [&](size_t k) {
+            return &masks[(mask_slot[k] >= 0 ? mask_slot[k] + 1 : 0) * bins];
+        };
+        if (gapped > 0) {
+            // Slot 0: the mask of a node with every hour
+            std::vector<double> ones(n, 0.0);
+            std::fill(ones.begin(), ones.begin() + grid, 1.0);
+            RealFFT(n).forward(ones.data(), masks.data());
+        }
+        std::atomic<size_t> next{0};
+        on_workers(threads, [&]() {
+            RealFFT fft(n);
+            std::vector<double> values(n);
+            for (size_t k; (k = next++) < nodes.size();) {
+                const auto& points = series.at(nodes[k]);
+                double mean = 0.0, M2 = 0.0;
+                int count = 0;
+                for (const auto& p : points) {
+                    count++;
+                    double delta = p.congestion - mean;
+                    mean += delta / count;
+                    M2 += delta * (p.congestion - mean);
+                }
+                if (M2 <= 0) continue;
+                const double scale = 1.0 / std::sqrt(M2 / count);
+                std::fill(values.begin(), values.end(), 0.0);
+                for (const auto& p : points) values[p.hour_stamp - first] = (p.congestion - mean) * scale;
+                fft.forward(values.data(), &spectra[k * bins]);
+                if (mask_slot[k] >= 0) {
+                    std::fill(values.begin(), values.end(), 0.0);
+                    for (const auto& p : points) values[p.hour_stamp - first] = 1.0;
+                    fft.forward(values.data(), mask(k));
+                }
+                usable[k] = 1;
+            }
+        });
+
+        // Pairs (i, j > i): IFFT(conj(X_i) * X_j)[lag] = sum_t x_i[t] x_j[t + lag].
+        // Missing hours are zeros, so each lag's sum is divided by the hours
+        // both nodes have there, from the same product of their masks
+        std::mutex top_mutex;
+        std::atomic<long long> pairs{0};
+        next = 0;
+        on_workers(threads, [&]() {
+            RealFFT fft(n);
+            std::vector<RealFFT::Complex> product(bins);
+            std::vector<double> correlation(n);
+            std::vector<double> overlap(n);
+            TopPairs local(params.top);
+            long long done = 0;
+            for (size_t i; (i = next++) < nodes.size();) {
+                if (!usable[i]) continue;
+                const RealFFT::Complex* x = &spectra[i * bins];
+                for (size_t j = i + 1; j < nodes.size(); j++) {
+                    if (!usable[j]) continue;
+                    const RealFFT::Complex* y = &spectra[j * bins];
+                    for (size_t k = 0; k < bins; k++) product[k] = std::conj(x[k]) * y[k];
+                    fft.inverse(product.data(), correlation.data());
+                    const bool full = mask_slot[i] < 0 && mask_slot[j] < 0;
+                    if (!full) {
+                        const RealFFT::Complex* a = mask(i);
+                        const RealFFT::Complex* b = mask(j);
+                        for (size_t k = 0; k < bins; k++) product[k] = std::conj(a[k]) * b[k];
+                        fft.inverse(product.data(), overlap.data());
+                    }
+                    done++;
+
+                    int best_lag = 0;
+                    double best = 0.0, at_zero = 0.0;
+                    bool found = false;
+                    for (int lag = -params.max_lag; lag <= params.max_lag; lag++) {
+                        const size_t slot = lag < 0 ? n + lag : lag;
+                        const double hours = full ? static_cast<double>(grid) - std::abs(lag) : std::round(overlap[slot]);
+                        if (hours < params.min_rows) continue;
+                        const double c = correlation[slot] / hours;
+                        if (lag == 0) at_zero = c;
+                        if (!found || std::abs(c) > std::abs(best)) {
+                            best = c;
+                            best_lag = lag;
+                            found = true;
+                        }
+                    }
+                    if (!found || best_lag == 0) continue;
+
+                    // A positive lag means node j follows node i
+                    LeadLag pair{nodes[i], nodes[j], best_lag, best, at_zero};
+                    if (best_lag < 0) {
+                        std::swap(pair.leader, pair.follower);
+                        pair.lag_hours = -best_lag;
+                    }
+                    local.add(pair);
+                }
+            }
+            std::lock_guard<std::mutex> lock(top_mutex);
+            top.merge(local);
+            pairs += done;
+        });
+        result.pairs += pairs;
+    }
+
+    result.strongest = top.sorted();
+    return result;
+}
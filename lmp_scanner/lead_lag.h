@@ -0,0 +1,40 @@
+#pragma once
+#include "regimes.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Lead-lag analysis (--lead-lag). Each node's congestion spread is laid on
+// the dataset's hourly grid, standardized (missing hours at the mean) and
+// transformed once; a pair's cross-correlation at every lag is then one
+// spectrum product and one inverse real FFT. Nodes with missing hours also
+// transform their presence mask, so each lag is divided by the hours both
+// nodes have rather than the grid. Pairs run in parallel, each worker taking
+// the next node and all its later partners.
+
+struct LeadLagParams {
+    int max_lag = 48;       // hours either way
+    size_t top = 200;       // strongest pairs kept
+    int min_rows = 168;     // nodes with fewer rows, and lags with fewer shared hours, are left out
+};
+
+// A pair whose cross-correlation peaks away from lag 0: the follower's
+// congestion spread tracks the leader's `lag_hours` later
+struct LeadLag {
+    int leader;
+    int follower;
+    int lag_hours;
+    double correlation;      // at lag_hours
+    double correlation_0;    // at lag 0, for comparison
+};
+
+struct LeadLagResult {
+    std::vector<LeadLag> strongest;   // by |correlation|, descending
+    long long pairs = 0;              // pairs cross-correlated
+    size_t fft_size = 0;
+};
+
+// Every pair within each group of pnode_ids
+LeadLagResult find_lead_lag(const std::unordered_map<int, std::vector<SeriesPoint>>& series,
+                            const std::vector<std::vector<int>>& groups, int threads,
+                            const LeadLagParams& params = {});
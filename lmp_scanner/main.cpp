@@ -1,28 +1,476 @@
 #include "scanner.h"
+#include "server.h"
+#include "stream.h"
+#include "column_store.h"
+#include "csv_writer.h"
+#include "perf_counters.h"
+#include "pipeline.h"
 #include <iostream>
+#include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+static bool is_number(const std::string& text) {
+    char* end = nullptr;
+    std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
+}
+
+// "YYYY-MM-DD" or "YYYY-MM-DD HH" as hours since epoch; a bare date used as an
+// upper bound covers the whole day
+static int parse_date_arg(const std::string& value, bool end_of_day) {
+    std::string text = value;
+    bool date_only = text.size() == 10;
+    if (date_only) text += " 00";
+    int stamp = parse_hour_stamp(text.c_str(), text.size());
+    if (stamp < 0) {
+        throw std::runtime_error("Invalid date: " + value + " (expected YYYY-MM-DD)");
+    }
+    return (date_only && end_of_day) ? stamp + 23 : stamp;
+}
+
+// pnode_ids separated by newlines, commas or spaces; anything else is skipped
+static std::vector<int> read_nodes_file(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open nodes file: " + path);
+    }
+    std::vector<int> nodes;
+    std::string token;
+    while (file >> token) {
+        std::replace(token.begin(), token.end(), ',', ' ');
+        std::istringstream parts(token);
+        std::string part;
+        while (parts >> part) {
+            char* end;
+            long id = std::strtol(part.c_str(), &end, 10);
+            if (*end == '\0') nodes.push_back(static_cast<int>(id));
+        }
+    }
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    if (nodes.empty()) {
+        throw std::runtime_error("No pnode_ids in nodes file: " + path);
+    }
+    return nodes;
+}
+
+// "A-B" hour-of-day range, inclusive; wraps past midnight when A > B
+static uint32_t parse_hours_arg(const std::string& value) {
+    int from, to;
+    char dash;
+    std::istringstream in(value);
+    if (!(in >> from >> dash >> to) || dash != '-' || from < 0 || from > 23 || to < 0 || to > 23) {
+        throw std::runtime_error("Invalid hours: " + value + " (expected A-B, 0-23)");
+    }
+    uint32_t mask = 0;
+    for (int h = from; ; h = (h + 1) % 24) {
+        mask |= 1u << h;
+        if (h == to) break;
+    }
+    return mask;
+}
+
+// Set one row filter field by name (from, to, zone, nodes-file, hours);
+// false if the name isn't a filter field
+static bool set_filter_field(RowFilter& filter, const std::string& name, const std::string& value) {
+    if (name == "from") {
+        filter.from_hour = parse_date_arg(value, false);
+    } else if (name == "to") {
+        filter.to_hour = parse_date_arg(value, true);
+    } else if (name == "zone") {
+        filter.zone = value;
+    } else if (name == "nodes-file") {
+        filter.nodes = read_nodes_file(value);
+    } else if (name == "hours") {
+        filter.hours = parse_hours_arg(value);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Row filter flags shared by the scan and store subcommands; consumes the
+// flag's value and returns true when argv[i] was one of them
+static bool parse_filter_arg(int argc, char* argv[], int& i, RowFilter& filter) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc || arg.rfind("--", 0) != 0) return false;
+    if (!set_filter_field(filter, arg.substr(2), argv[i + 1])) return false;
+    i++;
+    return true;
+}
+
+// lmp_scanner convert <csv> <store.lmpb> [--fixed-point]
+static int run_convert(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " convert <csv> <store.lmpb> [--fixed-point]" << std::endl;
+        return 1;
+    }
+    bool fixed_point = argc > 4 && std::string(argv[4]) == "--fixed-point";
+    auto start = std::chrono::high_resolution_clock::now();
+    convert_csv_to_store(argv[2], argv[3], fixed_point);
+    
+    ColumnStore store(argv[3]);
+    auto elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start);
+    std::cout << "  Blocks: " << store.num_blocks() << " x " << STORE_BLOCK_ROWS << " rows" << std::endl;
+    std::cout << "  Store size: " << (store.file_size() >> 20) << " MB" << std::endl;
+    std::cout << "  Converted in " << std::fixed << std::setprecision(2) << elapsed.count() << "s" << std::endl;
+    return 0;
+}
+
+// lmp_scanner spikes <store.lmpb> [--top K] [--from --to --zone --nodes-file --hours]
+static int run_spikes(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " spikes <store.lmpb> [--top K]"
+                  << " [--from D] [--to D] [--zone Z] [--nodes-file F] [--hours A-B]" << std::endl;
+        return 1;
+    }
+    RowFilter filter;
+    size_t top = 100;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (parse_filter_arg(argc, argv, i, filter)) continue;
+        if (arg == "--top" && i + 1 < argc) top = std::stoul(argv[++i]);
+        else throw std::runtime_error("Unknown option: " + arg);
+    }
+    
+    ColumnStore store(argv[2]);
+    std::vector<SpikeRow> spikes = top_spread_spikes(store, filter, top);
+    
+    CsvWriter file("../output/spread_spikes.csv");
+    file.text("datetime,pnode_id,zone,spread,congestion_spread\n");
+    for (const auto& s : spikes) {
+        file.row(format_hour_stamp(s.hour_stamp), s.pnode_id, store.zone_name(s.zone_id),
+                 s.spread, s.cong_spread);
+    }
+    file.close();
+    
+    std::cout << "Top " << spikes.size() << " |spread| rows written to ../output/spread_spikes.csv" << std::endl;
+    std::cout << "  Blocks read: " << store.blocks_read() << " of " << store.num_blocks() << std::endl;
+    std::cout << "  Bytes read: " << (store.bytes_read() >> 20) << " MB of "
+              << (store.data_bytes() >> 20) << " MB" << std::endl;
+    return 0;
+}
+
+// A parsed `plan` query: scan <input> [| filter k=v ...] [| project [components] [loss]]
+// [| aggregate nodes|zone_hourly|count]
+struct QueryPlan {
+    std::string input;
+    RowFilter filter;
+    bool project = false;
+    BatchColumns columns{false, false, false};
+    std::string sink = "count";
+};
+
+static QueryPlan parse_plan(const std::string& text) {
+    QueryPlan plan;
+    std::istringstream stages(text);
+    std::string stage;
+    bool aggregated = false;
+    for (int index = 0; std::getline(stages, stage, '|'); index++) {
+        std::istringstream words(stage);
+        std::string op, word;
+        words >> op;
+        if (aggregated) {
+            throw std::runtime_error("aggregate must be the last plan stage");
+        }
+        if ((op == "scan") != (index == 0)) {
+            throw std::runtime_error("A plan starts with exactly one scan stage");
+        }
+        if (op == "scan") {
+            if (!(words >> plan.input)) throw std::runtime_error("scan needs an input");
+        } else if (op == "filter") {
+            while (words >> word) {
+                size_t eq = word.find('=');
+                if (eq == std::string::npos ||
+                    !set_filter_field(plan.filter, word.substr(0, eq), word.substr(eq + 1))) {
+                    throw std::runtime_error("Invalid filter term: " + word);
+                }
+            }
+        } else if (op == "project") {
+            plan.project = true;
+            while (words >> word) {
+                if (word == "components") plan.columns.components = true;
+                else if (word == "loss") plan.columns.loss = true;
+                else throw std::runtime_error("Unknown projection: " + word);
+            }
+        } else if (op == "aggregate") {
+            words >> plan.sink;
+            if (plan.sink != "nodes" && plan.sink != "zone_hourly" && plan.sink != "count") {
+                throw std::runtime_error("Unknown aggregate: " + plan.sink + " (nodes, zone_hourly, count)");
+            }
+            aggregated = true;
+        } else {
+            throw std::runtime_error("Unknown plan stage: " + op);
+        }
+    }
+    if (plan.input.empty()) {
+        throw std::runtime_error("A plan starts with exactly one scan stage");
+    }
+    // Grouping by hour needs the derived hour column
+    if (plan.sink != "count") plan.project = true;
+    return plan;
+}
+
+using PlanNodeAccumulator = Accumulator<Welford<Spread>>;
+
+template <typename Sink>
+static Sink make_plan_sink(BatchSource& source) {
+    if constexpr (std::is_constructible_v<Sink, ZoneDictionary&>) return Sink(source.zones());
+    else return Sink();
+}
+
+// Open the plan's source and run it, hand-fused or as an operator chain;
+// done(result, source, rows) sees the merged sink. Returns wall time in ms.
+template <typename Sink, typename Done>
+static double run_plan_once(const QueryPlan& plan, int threads, bool fused, bool verbose, Done done) {
+    DataQuality quality;
+    auto source = open_batch_source({plan.input}, plan.filter, plan.columns, threads, quality);
+    Pipeline pipeline(*source);
+    pipeline.filter(plan.filter);
+    if (plan.project) pipeline.project(plan.columns);
+
+    auto make_sink = [&]() { return make_plan_sink<Sink>(*source); };
+    Sink result = make_sink();
+    auto start = std::chrono::high_resolution_clock::now();
+    long long rows = fused ? run_fused(pipeline, threads, result, make_sink, plan.filter)
+                           : run_parallel(pipeline, threads, result, make_sink, verbose);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start);
+    done(result, *source, rows);
+    return elapsed.count();
+}
+
+template <typename Sink, typename Done>
+static void run_plan(const QueryPlan& plan, int threads, int bench_reps, Done done) {
+    if (bench_reps == 0) {
+        double ms = run_plan_once<Sink>(plan, threads, false, true, done);
+        std::cout << "  Plan ran in " << std::fixed << std::setprecision(1) << ms << " ms" << std::endl;
+        return;
+    }
+    // Alternate the two so cache and page-cache state favour neither
+    double best_fused = 1e300, best_chain = 1e300;
+    auto ignore = [](Sink&, BatchSource&, long long) {};
+    for (int rep = 0; rep < bench_reps; rep++) {
+        best_fused = std::min(best_fused, run_plan_once<Sink>(plan, threads, true, false, ignore));
+        best_chain = std::min(best_chain, run_plan_once<Sink>(plan, threads, false, false, ignore));
+    }
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "\nBest of " << bench_reps << ":" << std::endl;
+    std::cout << "  Hand-fused loop: " << best_fused << " ms" << std::endl;
+    std::cout << "  Operator chain:  " << best_chain << " ms" << std::endl;
+    std::cout << "  Overhead: " << std::setprecision(2) << 100.0 * (best_chain - best_fused) / best_fused
+              << "%" << std::endl;
+}
+
+// lmp_scanner plan "<scan ... | filter ... | project | aggregate ...>" [--threads N] [--bench [REPS]]
+static int run_plan_command(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " plan \"scan <input> | filter from=D to=D zone=Z"
+                  << " hours=A-B nodes-file=F | project [components] [loss]"
+                  << " | aggregate nodes|zone_hourly|count\" [--threads N] [--bench [REPS]]" << std::endl;
+        return 1;
+    }
+    QueryPlan plan = parse_plan(argv[2]);
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    int bench_reps = 0;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else if (arg == "--bench") {
+            bench_reps = 5;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                bench_reps = std::stoi(argv[++i]);
+            }
+        } else {
+            throw std::runtime_error("Unknown option: " + arg);
+        }
+    }
+    if (threads <= 0) threads = 1;
+    std::cout << "Plan: " << argv[2] << " (" << threads << " threads)" << std::endl;
+
+    auto summary = [](BatchSource& source, long long rows) {
+        std::cout << "  Rows: " << rows << " of " << source.rows_scanned() << " scanned" << std::endl;
+        source.report();
+    };
+    if (plan.sink == "nodes") {
+        run_plan<NodeSink<PlanNodeAccumulator>>(plan, threads, bench_reps,
+            [&](NodeSink<PlanNodeAccumulator>& sink, BatchSource& source, long long rows) {
+                summary(source, rows);
+                std::vector<int> ids;
+                for (const auto& [id, acc] : sink.nodes) ids.push_back(id);
+                std::sort(ids.begin(), ids.end());
+
+                CsvWriter file("../output/plan_nodes.csv");
+                file.text("pnode_id,zone,samples,mean_spread,std_spread,sharpe_ratio\n");
+                for (int id : ids) {
+                    const auto& acc = sink.nodes.at(id);
+                    const auto& spread = acc.get<Welford<Spread>>();
+                    double std_spread = std::sqrt(spread.M2 / acc.n);
+                    file.row(id, acc.zone, acc.n, spread.mean, std_spread,
+                             std_spread > 0 ? spread.mean / std_spread : 0.0);
+                }
+                file.close();
+                std::cout << "  " << ids.size() << " nodes written to ../output/plan_nodes.csv" << std::endl;
+            });
+    } else if (plan.sink == "zone_hourly") {
+        run_plan<ZoneHourSink>(plan, threads, bench_reps,
+            [&](ZoneHourSink& sink, BatchSource& source, long long rows) {
+                summary(source, rows);
+                sink.write("../output/plan_zone_hourly.csv", source.zones());
+                std::cout << "  Zone x hour means written to ../output/plan_zone_hourly.csv" << std::endl;
+            });
+    } else {
+        run_plan<CountSink>(plan, threads, bench_reps,
+            [&](CountSink& sink, BatchSource& source, long long rows) {
+                summary(source, rows);
+                if (sink.rows > 0) {
+                    std::cout << "  Mean spread: " << std::fixed << std::setprecision(4)
+                              << sink.spread_sum / sink.rows << std::endl;
+                    std::cout << "  Hours: " << format_hour_stamp(sink.first_hour) << " to "
+                              << format_hour_stamp(sink.last_hour) << std::endl;
+                }
+            });
+    }
+    return 0;
+}
+
+// lmp_scanner serve <csv> [cost] [socket_path]
+static int run_server(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " serve <csv> [cost] [socket_path]\n"
+                  << "  RELOAD <csv> from a client only reads files in <csv>'s directory,"
+                  << " each at most once" << std::endl;
+        return 1;
+    }
+    std::string csv_path = argv[2];
+    double transaction_cost = argc > 3 ? std::stod(argv[3]) : 0.75;
+    std::string socket_path = argc > 4 ? argv[4] : "/tmp/lmp_scanner.sock";
+    
+    QueryServer server(socket_path, transaction_cost);
+    server.allow_reloads_from(std::filesystem::absolute(csv_path).parent_path().string());
+    server.load(csv_path);
+    server.run();
+    return 0;
+}
+
+// lmp_scanner stream <da_csv> [rt_source|-] [--follow] [--threshold X] [--zscore Z]
+//                    [--halflife N] [--warmup N] [--stats-every S]
+static int run_stream(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " stream <da_csv> [rt_source|-] [--follow]"
+                  << " [--threshold X] [--zscore Z] [--halflife N] [--warmup N]"
+                  << " [--stats-every S]" << std::endl;
+        return 1;
+    }
+    
+    StreamOptions options;
+    options.da_path = argv[2];
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--follow") options.follow = true;
+        else if (arg == "--threshold" && i + 1 < argc) options.spread_threshold = std::stod(argv[++i]);
+        else if (arg == "--zscore" && i + 1 < argc) options.z_threshold = std::stod(argv[++i]);
+        else if (arg == "--halflife" && i + 1 < argc) options.halflife = std::stod(argv[++i]);
+        else if (arg == "--warmup" && i + 1 < argc) options.warmup = std::stoi(argv[++i]);
+        else if (arg == "--stats-every" && i + 1 < argc) options.stats_interval = std::stoi(argv[++i]);
+        else options.rt_source = arg;
+    }
+    
+    SpreadStream stream(options);
+    stream.run();
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
     try {
-        std::string csv_path = "lmp_data_merged.csv";
+        if (argc > 1 && std::string(argv[1]) == "serve") {
+            return run_server(argc, argv);
+        }
+        if (argc > 1 && std::string(argv[1]) == "stream") {
+            return run_stream(argc, argv);
+        }
+        if (argc > 1 && std::string(argv[1]) == "convert") {
+            return run_convert(argc, argv);
+        }
+        if (argc > 1 && std::string(argv[1]) == "spikes") {
+            return run_spikes(argc, argv);
+        }
+        if (argc > 1 && std::string(argv[1]) == "plan") {
+            return run_plan_command(argc, argv);
+        }
+        
+        std::vector<std::string> inputs = {"lmp_data_merged.csv"};
         double transaction_cost = 0.75;
+        ScanOptions options;
         
-        // Parse command line arguments
-        if (argc > 1) {
-            csv_path = argv[1];
+        // Parse command line arguments: <input>... [cost] plus --flags anywhere
+        std::vector<std::string> positional;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (parse_filter_arg(argc, argv, i, options.filter)) continue;
+            if (arg == "--rt-fivemin") {
+                options.rt_fivemin = true;
+            } else if (arg == "--metrics" && i + 1 < argc) {
+                options.metrics = parse_metric_set(argv[++i]);
+            } else if (arg == "--fixed-point") {
+                options.fixed_point = true;
+            } else if (arg == "--group-by" && i + 1 < argc) {
+                options.group_by = parse_group_by(argv[++i]);
+            } else if (arg == "--threads" && i + 1 < argc) {
+                options.threads = std::stoi(argv[++i]);
+            } else if (arg == "--cache" && i + 1 < argc) {
+                options.cache_dir = argv[++i];
+            } else if (arg == "--sample" && i + 1 < argc) {
+                options.sample = std::stod(argv[++i]);
+            } else if (arg == "--sample-seed" && i + 1 < argc) {
+                options.sample_seed = std::stoull(argv[++i]);
+            } else if (arg == "--strict") {
+                options.strict = true;
+            } else if (arg == "--regimes") {
+                options.regimes = true;
+            } else if (arg == "--lead-lag") {
+                options.lead_lag = true;
+            } else if (arg == "--io" && i + 1 < argc) {
+                options.io = parse_io_mode(argv[++i]);
+            } else if (arg == "--perf-counters") {
+                std::string unavailable = enable_perf_counters();
+                if (!unavailable.empty()) {
+                    std::cout << "Note: perf counters unavailable, " << unavailable
+                              << "; continuing without them" << std::endl;
+                }
+            } else if (arg.rfind("--", 0) == 0) {
+                throw std::runtime_error("Unknown option: " + arg);
+            } else {
+                positional.push_back(arg);
+            }
         }
-        if (argc > 2) {
-            transaction_cost = std::stod(argv[2]);
+        // A trailing number is the cost; several inputs are scanned as one
+        // dataset (see is_multi_input)
+        if (positional.size() > 1 && is_number(positional.back())) {
+            transaction_cost = std::stod(positional.back());
+            positional.pop_back();
         }
+        if (positional.size() > 0) inputs = std::move(positional);
         
         std::cout << "═══════════════════════════════════════════════════════════\n";
-        std::cout << "           LMP ARBITRAGE SCANNER v1.0\n";
+        std::cout << "           LMP ARBITRAGE SCANNER v" << SCANNER_VERSION << "\n";
         std::cout << "═══════════════════════════════════════════════════════════\n\n";
         
         auto start = std::chrono::high_resolution_clock::now();
         
-        LMPScanner scanner(csv_path, transaction_cost);
-        scanner.analyze();
+        LMPScanner scanner(std::move(inputs), transaction_cost, options);
+        scanner.analyze(true);
         scanner.write_results();
         
         auto end = std::chrono::high_resolution_clock::now();
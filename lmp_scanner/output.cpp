@@ -1,119 +1,220 @@
 #include "scanner.h"
+#include "column_store.h"
+#include "csv_writer.h"
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <optional>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
-void LMPScanner::write_node_rankings() {
-    std::ofstream out("../output/node_rankings.csv");
+std::string LMPScanner::write_node_rankings() {
+    CsvWriter out("../output/node_rankings.csv");
     
-    out << "pnode_id,zone,mean_spread,std_spread,sharpe_ratio,hit_rate,"
-        << "sample_size,mean_abs_spread,net_profit_10mw,congestion_sharpe,"
-        << "energy_sharpe,best_hour,best_hour_avg\n";
+    // --regimes adds the current spread regime and a recent-change flag
+    const bool regimes = options_.regimes;
+    out.text("pnode_id,zone,mean_spread,std_spread,sharpe_ratio,hit_rate,"
+             "sample_size,mean_abs_spread,net_profit_10mw,congestion_sharpe,"
+             "energy_sharpe,best_hour,best_hour_avg");
+    out.text(regimes ? ",regimes,regime_start,regime_mean,regime_sharpe,recent_break\n" : "\n");
     
-    out << std::fixed << std::setprecision(4);
+    // Columns whose metrics this run's set didn't compute are left empty
+    const bool components = options_.metrics != MetricSet::Sharpe;
+    const bool hourly = options_.metrics == MetricSet::Full;
+    auto when = [](bool computed, auto value) { return computed ? std::optional(value) : std::nullopt; };
     
     // Write top 100 nodes (or all if less than 100)
     int limit = std::min(100, static_cast<int>(results_.size()));
     for (int i = 0; i < limit; i++) {
         const auto& r = results_[i];
-        out << r.pnode_id << ","
-            << r.zone << ","
-            << r.mean_spread << ","
-            << r.std_spread << ","
-            << r.sharpe_ratio << ","
-            << r.hit_rate << ","
-            << r.sample_size << ","
-            << r.mean_abs_spread << ","
-            << r.net_profit_10mw << ","
-            << r.congestion_sharpe << ","
-            << r.energy_sharpe << ","
-            << r.best_hour << ","
-            << r.best_hour_avg << "\n";
+        auto congestion_sharpe = when(components, r.congestion_sharpe);
+        auto energy_sharpe = when(components, r.energy_sharpe);
+        auto best_hour = when(hourly, r.best_hour);
+        auto best_hour_avg = when(hourly, r.best_hour_avg);
+        auto it = regimes_.find(r.pnode_id);
+        if (!regimes || it == regimes_.end() || it->second.spread.empty()) {
+            out.row(r.pnode_id, r.zone, r.mean_spread, r.std_spread, r.sharpe_ratio, r.hit_rate,
+                    r.sample_size, r.mean_abs_spread, r.net_profit_10mw, congestion_sharpe,
+                    energy_sharpe, best_hour, best_hour_avg);
+            continue;
+        }
+        const NodeRegimes& node = it->second;
+        const Regime& current = node.spread.back();
+        out.row(r.pnode_id, r.zone, r.mean_spread, r.std_spread, r.sharpe_ratio, r.hit_rate,
+                r.sample_size, r.mean_abs_spread, r.net_profit_10mw, congestion_sharpe,
+                energy_sharpe, best_hour, best_hour_avg, static_cast<int>(node.spread.size()),
+                format_hour_stamp(current.start_hour), current.mean,
+                current.std_dev > 0 ? current.mean / current.std_dev : 0.0, node.recent_break ? 1 : 0);
     }
     
     out.close();
-    std::cout << "  ✓ node_rankings.csv (top " << limit << " nodes)" << std::endl;
+    return "node_rankings.csv (top " + std::to_string(limit) + " nodes)";
 }
 
-void LMPScanner::write_zone_summary() {
-    std::ofstream out("../output/zone_summary.csv");
-    
-    out << "zone,avg_sharpe,num_profitable_nodes,total_samples\n";
-    out << std::fixed << std::setprecision(4);
+std::string LMPScanner::write_zone_summary() {
+    CsvWriter out("../output/zone_summary.csv");
     
+    out.text("zone,avg_sharpe,num_profitable_nodes,total_samples\n");
     for (const auto& z : zone_summaries_) {
-        out << z.zone << ","
-            << z.avg_sharpe << ","
-            << z.num_profitable_nodes << ","
-            << z.total_samples << "\n";
+        out.row(z.zone, z.avg_sharpe, z.num_profitable_nodes, z.total_samples);
     }
     
     out.close();
-    std::cout << "  ✓ zone_summary.csv" << std::endl;
+    return "zone_summary.csv";
 }
 
-void LMPScanner::write_component_analysis() {
-    std::ofstream out("../output/component_analysis.csv");
+std::string LMPScanner::write_component_analysis() {
+    CsvWriter out("../output/component_analysis.csv");
     
-    out << "pnode_id,zone,total_sharpe,congestion_mean,congestion_std,congestion_sharpe,"
-        << "energy_mean,energy_std,energy_sharpe\n";
+    out.text("pnode_id,zone,total_sharpe,congestion_mean,congestion_std,congestion_sharpe,"
+             "energy_mean,energy_std,energy_sharpe,loss_mean,loss_std,loss_sharpe\n");
     
-    out << std::fixed << std::setprecision(4);
+    // Top 50 by congestion Sharpe, selected through an index permutation
+    // so results_ is neither copied nor reordered
+    std::vector<uint32_t> order(results_.size());
+    std::iota(order.begin(), order.end(), 0u);
+    int limit = std::min(50, static_cast<int>(order.size()));
+    std::partial_sort(order.begin(), order.begin() + limit, order.end(),
+                      [&](uint32_t a, uint32_t b) {
+                          return results_[a].congestion_sharpe > results_[b].congestion_sharpe;
+                      });
     
-    // Top 50 by congestion Sharpe
-    auto sorted = results_;
-    std::sort(sorted.begin(), sorted.end(),
-              [](const NodeResult& a, const NodeResult& b) {
-                  return a.congestion_sharpe > b.congestion_sharpe;
-              });
-    
-    int limit = std::min(50, static_cast<int>(sorted.size()));
     for (int i = 0; i < limit; i++) {
-        const auto& r = sorted[i];
-        out << r.pnode_id << ","
-            << r.zone << ","
-            << r.sharpe_ratio << ","
-            << r.congestion_mean << ","
-            << r.congestion_std << ","
-            << r.congestion_sharpe << ","
-            << r.energy_mean << ","
-            << r.energy_std << ","
-            << r.energy_sharpe << "\n";
+        const auto& r = results_[order[i]];
+        out.row(r.pnode_id, r.zone, r.sharpe_ratio,
+                r.congestion_mean, r.congestion_std, r.congestion_sharpe,
+                r.energy_mean, r.energy_std, r.energy_sharpe,
+                r.loss_mean, r.loss_std, r.loss_sharpe);
     }
     
     out.close();
-    std::cout << "  ✓ component_analysis.csv (top 50 by congestion Sharpe)" << std::endl;
+    return "component_analysis.csv (top 50 by congestion Sharpe)";
 }
 
-void LMPScanner::write_hourly_patterns() {
+std::string LMPScanner::write_hourly_patterns() {
     // Aggregate across all nodes
     std::array<double, 24> hourly_spread_sum{};
-    std::array<double, 24> hourly_variance_sum{};
     std::array<int, 24> hourly_obs{};
     
     for (const auto& [node_id, acc] : node_data_) {
+        const auto& hourly = acc.get<Hourly<Spread>>();
         for (int h = 0; h < 24; h++) {
-            if (acc.hourly_count[h] > 0) {
-                hourly_spread_sum[h] += acc.hourly_sum[h];
-                hourly_obs[h] += acc.hourly_count[h];
+            if (hourly.count[h] > 0) {
+                hourly_spread_sum[h] += hourly.sum(h);
+                hourly_obs[h] += hourly.count[h];
             }
         }
     }
     
-    std::ofstream out("../output/hourly_patterns.csv");
-    out << "hour,avg_spread,num_observations\n";
-    out << std::fixed << std::setprecision(4);
-    
+    CsvWriter out("../output/hourly_patterns.csv");
+    out.text("hour,avg_spread,num_observations\n");
     for (int h = 0; h < 24; h++) {
         double avg = hourly_obs[h] > 0 ? hourly_spread_sum[h] / hourly_obs[h] : 0.0;
-        out << h << "," << avg << "," << hourly_obs[h] << "\n";
+        out.row(h, avg, static_cast<int>(std::lround(hourly_obs[h] / sample_fraction_)));
+    }
+    
+    out.close();
+    return "hourly_patterns.csv";
+}
+
+std::string LMPScanner::write_hour_strategies() {
+    CsvWriter out("../output/hour_strategies.csv");
+    
+    out.text("pnode_id,zone,hour,sample_size,mean_spread,std_spread,hit_rate,"
+             "net_mean,net_sharpe,net_profit_10mw\n");
+    
+    int limit = std::min(100, static_cast<int>(hour_results_.size()));
+    for (int i = 0; i < limit; i++) {
+        const auto& s = hour_results_[i];
+        out.row(s.pnode_id, s.zone, s.hour, s.sample_size, s.mean_spread, s.std_spread, s.hit_rate,
+                s.net_mean, s.net_sharpe, s.net_profit_10mw);
+    }
+    
+    out.close();
+    return "hour_strategies.csv (top " + std::to_string(limit) + " node-hours)";
+}
+
+std::string LMPScanner::write_regimes() {
+    CsvWriter out("../output/regimes.csv");
+    
+    out.text("pnode_id,zone,series,regime,start,end,rows,mean,std,sharpe\n");
+    
+    std::vector<int> order;
+    order.reserve(regimes_.size());
+    for (const auto& [node_id, node] : regimes_) order.push_back(node_id);
+    std::sort(order.begin(), order.end());
+    
+    size_t recent = 0;
+    for (int node_id : order) {
+        const NodeRegimes& node = regimes_.at(node_id);
+        auto acc = node_data_.find(node_id);
+        const std::string zone = acc == node_data_.end() || acc->second.zone.empty() ? "N/A" : acc->second.zone;
+        recent += node.recent_break;
+        for (const auto& [series, found] : {std::pair{"spread", &node.spread}, {"congestion", &node.congestion}}) {
+            for (size_t k = 0; k < found->size(); k++) {
+                const Regime& g = (*found)[k];
+                out.row(node_id, zone, series, static_cast<int>(k), format_hour_stamp(g.start_hour),
+                        format_hour_stamp(g.end_hour), g.rows, g.mean, g.std_dev,
+                        g.std_dev > 0 ? g.mean / g.std_dev : 0.0);
+            }
+        }
+    }
+    
+    out.close();
+    return "regimes.csv (" + std::to_string(recent) + " nodes with a recent change)";
+}
+
+std::string LMPScanner::write_lead_lag() {
+    CsvWriter out("../output/lead_lag.csv");
+    
+    out.text("leader,leader_zone,follower,follower_zone,lag_hours,correlation,correlation_lag0\n");
+    auto zone = [&](int node_id) {
+        auto acc = node_data_.find(node_id);
+        return acc == node_data_.end() || acc->second.zone.empty() ? std::string("N/A") : acc->second.zone;
+    };
+    for (const auto& p : lead_lag_.strongest) {
+        out.row(p.leader, zone(p.leader), p.follower, zone(p.follower), p.lag_hours, p.correlation,
+                p.correlation_0);
     }
     
     out.close();
-    std::cout << "  ✓ hourly_patterns.csv" << std::endl;
+    return "lead_lag.csv (strongest " + std::to_string(lead_lag_.strongest.size()) + " of " +
+           std::to_string(lead_lag_.pairs) + " pairs)";
 }
 
-void LMPScanner::write_summary_report() {
+std::string LMPScanner::write_intrahour_volatility() {
+    CsvWriter out("../output/intrahour_volatility.csv");
+    
+    out.text("pnode_id,zone,hours,intervals,mean_intrahour_std,max_intrahour_std,"
+             "mean_intrahour_range,max_intrahour_range\n");
+    
+    // Most volatile nodes first
+    std::vector<std::pair<int, const IntraHourStats*>> sorted;
+    sorted.reserve(intrahour_data_.size());
+    for (const auto& [node_id, stats] : intrahour_data_) {
+        if (stats.hours > 0) sorted.emplace_back(node_id, &stats);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second->sum_std / a.second->hours > b.second->sum_std / b.second->hours;
+    });
+    
+    static const std::string NO_ZONE = "N/A";
+    for (const auto& [node_id, stats] : sorted) {
+        auto it = node_data_.find(node_id);
+        const std::string& zone = (it == node_data_.end() || it->second.zone.empty())
+                                      ? NO_ZONE : it->second.zone;
+        out.row(node_id, zone, stats->hours, stats->intervals,
+                stats->sum_std / stats->hours, stats->max_std,
+                stats->sum_range / stats->hours, stats->max_range);
+    }
+    
+    out.close();
+    return "intrahour_volatility.csv (" + std::to_string(sorted.size()) + " nodes)";
+}
+
+std::string LMPScanner::write_summary_report() {
     std::ofstream out("../output/summary_report.txt");
     
     out << "═══════════════════════════════════════════════════════════════\n";
@@ -128,6 +229,7 @@ void LMPScanner::write_summary_report() {
     for (const auto& [_, acc] : node_data_) {
         total_obs += acc.n;
     }
+    total_obs = static_cast<int>(std::lround(total_obs / sample_fraction_));
     
     out << "DATASET SUMMARY\n";
     out << "───────────────────────────────────────────────────────────────\n";
@@ -179,47 +281,50 @@ void LMPScanner::write_summary_report() {
     out << "\nKEY INSIGHTS\n";
     out << "───────────────────────────────────────────────────────────────\n";
     
-    // Component analysis
+    // Component and hour-of-day insights only when this run's metric set has them
     if (!results_.empty()) {
-        double total_sharpe_sum = 0;
         double cong_sharpe_sum = 0;
         double energy_sharpe_sum = 0;
         
         for (const auto& r : results_) {
-            total_sharpe_sum += std::abs(r.sharpe_ratio);
             cong_sharpe_sum += std::abs(r.congestion_sharpe);
             energy_sharpe_sum += std::abs(r.energy_sharpe);
         }
         
-        double cong_contribution = cong_sharpe_sum / (cong_sharpe_sum + energy_sharpe_sum) * 100;
-        
-        out << "• Congestion component drives " << std::fixed << std::setprecision(1)
-            << cong_contribution << "% of spread variance\n";
+        if (options_.metrics != MetricSet::Sharpe && cong_sharpe_sum + energy_sharpe_sum > 0) {
+            double cong_contribution = cong_sharpe_sum / (cong_sharpe_sum + energy_sharpe_sum) * 100;
+            
+            out << "• Congestion component drives " << std::fixed << std::setprecision(1)
+                << cong_contribution << "% of spread variance\n";
+        }
         
         // Find best hour
         std::array<double, 24> hourly_totals{};
         std::array<int, 24> hourly_counts{};
         
         for (const auto& [node_id, acc] : node_data_) {
+            const auto& hourly = acc.get<Hourly<Spread>>();
             for (int h = 0; h < 24; h++) {
-                hourly_totals[h] += std::abs(acc.hourly_sum[h]);
-                hourly_counts[h] += acc.hourly_count[h];
+                hourly_totals[h] += std::abs(hourly.sum(h));
+                hourly_counts[h] += hourly.count[h];
             }
         }
         
-        int best_hour = 0;
+        int best_hour = -1;
         double best_hour_activity = 0;
         for (int h = 0; h < 24; h++) {
             if (hourly_counts[h] > 0) {
                 double avg = hourly_totals[h] / hourly_counts[h];
-                if (avg > best_hour_activity) {
+                if (best_hour < 0 || avg > best_hour_activity) {
                     best_hour = h;
                     best_hour_activity = avg;
                 }
             }
         }
         
-        out << "• Peak spread volatility at hour " << best_hour << ":00\n";
+        if (best_hour >= 0) {
+            out << "• Peak spread volatility at hour " << best_hour << ":00\n";
+        }
         
         // Profitability estimate
         double total_profit_10mw = 0;
@@ -239,5 +344,105 @@ void LMPScanner::write_summary_report() {
     out << "═══════════════════════════════════════════════════════════════\n";
     
     out.close();
-    std::cout << "  ✓ summary_report.txt" << std::endl;
-}
\ No newline at end of file
+    return "summary_report.txt";
+}
+
+namespace {
+
+// Two-sided 95% Student t quantile for `df` degrees of freedom
+double t_quantile_95(long long df) {
+    static const double TABLE[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df <= 30) return TABLE[std::max(1LL, df) - 1];
+    return 1.96 + 2.46 / df;
+}
+
+} // namespace
+
+std::string LMPScanner::write_preview_rankings() {
+    // 95% intervals from the sampled rows, narrowed by the finite-population
+    // correction for the share of the input already read. Blocks are
+    // clusters of consecutive hours, not independent rows, so each standard
+    // error comes from how the node's block totals of rows, spread and
+    // squared spread vary between blocks (BlockSpread::variances), with the
+    // t quantile for its block count. A node read in fewer than two blocks,
+    // or with a flat sample, gets no interval.
+    const double fpc = std::sqrt(std::max(0.0, 1.0 - sample_fraction_));
+    const int TOP = 100;   // node_rankings.csv
+    
+    // A node's few sampled rows rarely hold one of the input's rare spikes,
+    // so its own blocks understate how far its std can move. The std
+    // variance is at least the iid one, (kurtosis - 1) var / 4n, times the
+    // node's design effect, with the kurtosis taken from moments pooled
+    // over every node: one node's kurtosis can't exceed its row count.
+    double var_sum = 0.0, m4_sum = 0.0, rows = 0.0;
+    for (const auto& [node_id, spread] : sample_blocks_) {
+        const auto [var, m4] = spread.moments();
+        var_sum += var * spread.total[0];
+        m4_sum += m4 * spread.total[0];
+        rows += spread.total[0];
+    }
+    const double kurtosis = var_sum > 0 ? m4_sum * rows / (var_sum * var_sum) : 0.0;
+    
+    const size_t count = results_.size();
+    std::vector<char> bounded(count, 0);
+    std::vector<double> mean_half(count), std_half(count), sharpe_lo(count), sharpe_hi(count);
+    for (size_t i = 0; i < count; i++) {
+        const auto& r = results_[i];
+        auto it = sample_blocks_.find(r.pnode_id);
+        const auto v = it == sample_blocks_.end() ? BlockSpread::Variances{} : it->second.variances();
+        if (v.std_dev < 0) {
+            // Any rank is possible
+            sharpe_lo[i] = std::numeric_limits<double>::lowest();
+            sharpe_hi[i] = std::numeric_limits<double>::max();
+            continue;
+        }
+        const double n = node_data_.at(r.pnode_id).n;
+        const double var = r.std_spread * r.std_spread;
+        const double design_effect = std::max(1.0, v.mean / (var / n));
+        const double std_var = std::max(v.std_dev, std::max(0.0, kurtosis - 1) * var / (4 * n) * design_effect);
+        
+        const double width = t_quantile_95(it->second.blocks - 1) * fpc;
+        mean_half[i] = width * std::sqrt(v.mean);
+        std_half[i] = width * std::sqrt(std_var);
+        sharpe_lo[i] = r.sharpe_ratio - width * std::sqrt(v.sharpe);
+        sharpe_hi[i] = r.sharpe_ratio + width * std::sqrt(v.sharpe);
+        bounded[i] = 1;
+    }
+    
+    // A node can rank no better than one past every node whose interval lies
+    // wholly above its own, and no worse than the count of nodes whose
+    // intervals reach its lower end
+    std::vector<double> sorted_lo = sharpe_lo, sorted_hi = sharpe_hi;
+    std::sort(sorted_lo.begin(), sorted_lo.end());
+    std::sort(sorted_hi.begin(), sorted_hi.end());
+    
+    CsvWriter out("../output/preview_rankings.csv");
+    out.text("rank,pnode_id,zone,sampled_rows,est_rows,mean_spread,mean_lo,mean_hi,std_spread,std_lo,std_hi,"
+             "sharpe_ratio,sharpe_lo,sharpe_hi,rank_best,rank_worst,unstable\n");
+    
+    int unstable_top = 0;
+    for (size_t i = 0; i < count; i++) {
+        const auto& r = results_[i];
+        const long long n = node_data_.at(r.pnode_id).n;
+        auto bound = [&](double x) { return bounded[i] ? std::optional<double>(x) : std::nullopt; };
+        
+        const long long best = 1 + (sorted_lo.end() - std::upper_bound(sorted_lo.begin(), sorted_lo.end(),
+                                                                       sharpe_hi[i]));
+        const long long worst = sorted_hi.end() - std::lower_bound(sorted_hi.begin(), sorted_hi.end(),
+                                                                   sharpe_lo[i]);
+        // Sampling can't tell whether this node belongs in the top list
+        const int unstable = best <= TOP && worst > TOP;
+        if (unstable && static_cast<int>(i) < TOP) unstable_top++;
+        
+        out.row(static_cast<long long>(i + 1), r.pnode_id, r.zone, n, r.sample_size,
+                r.mean_spread, bound(r.mean_spread - mean_half[i]), bound(r.mean_spread + mean_half[i]),
+                r.std_spread, bound(std::max(0.0, r.std_spread - std_half[i])), bound(r.std_spread + std_half[i]),
+                r.sharpe_ratio, bound(sharpe_lo[i]), bound(sharpe_hi[i]), best, worst, unstable);
+    }
+    
+    out.close();
+    return "preview_rankings.csv (" + std::to_string(count) + " nodes, " + std::to_string(unstable_top) +
+           " of top " + std::to_string(std::min<size_t>(TOP, count)) + " unstable)";
+}
@@ -0,0 +1,150 @@
+#include "perf_counters.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<bool> enabled{false};
+std::atomic<uint32_t> available_mask{0};
+bool exclude_kernel = true;
+
+struct EventSpec {
+    uint32_t type;
+    uint64_t config;
+};
+
+const EventSpec EVENTS[NUM_PERF_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16)},
+};
+
+int open_event(PerfEvent event, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = EVENTS[event].type;
+    attr.config = EVENTS[event].config;
+    attr.exclude_kernel = exclude_kernel;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // This thread only, on whichever CPU it runs
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+int read_paranoid() {
+    std::ifstream file("/proc/sys/kernel/perf_event_paranoid");
+    int level = 2;
+    file >> level;
+    return level;
+}
+
+// One counter group per thread, opened on first use
+class PerfGroup {
+public:
+    PerfGroup() {
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            int fd = open_event(static_cast<PerfEvent>(e), leader_);
+            if (fd < 0) {
+                error_ = errno;
+                continue;
+            }
+            if (leader_ < 0) leader_ = fd;
+            slot_[e] = opened_++;
+            fds_[e] = fd;
+        }
+    }
+
+    ~PerfGroup() {
+        for (int fd : fds_) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    bool ok() const { return leader_ >= 0; }
+    int error() const { return error_; }
+    uint32_t mask() const {
+        uint32_t m = 0;
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) m |= (slot_[e] >= 0) << e;
+        return m;
+    }
+
+    PerfCounts read_counts() const {
+        PerfCounts counts{};
+        if (leader_ < 0) return counts;
+        // nr, time_enabled, time_running, then one value per event
+        uint64_t buf[3 + NUM_PERF_EVENTS];
+        if (::read(leader_, buf, sizeof(buf)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) return counts;
+        const double scale = buf[2] > 0 ? static_cast<double>(buf[1]) / buf[2] : 0.0;
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            if (slot_[e] >= 0 && static_cast<uint64_t>(slot_[e]) < buf[0]) {
+                counts[e] = static_cast<uint64_t>(buf[3 + slot_[e]] * scale);
+            }
+        }
+        return counts;
+    }
+
+private:
+    int leader_ = -1;
+    int opened_ = 0;
+    int error_ = 0;
+    std::array<int, NUM_PERF_EVENTS> fds_{-1, -1, -1, -1, -1};
+    std::array<int, NUM_PERF_EVENTS> slot_{-1, -1, -1, -1, -1};
+};
+
+PerfGroup& thread_group() {
+    thread_local PerfGroup group;
+    return group;
+}
+
+} // namespace
+
+const char* perf_event_name(PerfEvent event) {
+    static const char* const NAMES[NUM_PERF_EVENTS] = {
+        "cycles", "instructions", "cache_misses", "branch_misses", "llc_loads"
+    };
+    return NAMES[event];
+}
+
+std::string enable_perf_counters() {
+    const int paranoid = read_paranoid();
+    if (paranoid > 2) {
+        return "perf_event_paranoid is " + std::to_string(paranoid) +
+               " (counting a process's own threads needs 2 or lower)";
+    }
+    // Kernel-mode counts need paranoid <= 1; above that count user space only
+    exclude_kernel = paranoid > 1;
+
+    PerfGroup probe;
+    if (!probe.ok()) {
+        int err = probe.error();
+        if (err == ENOENT || err == ENODEV || err == EOPNOTSUPP) {
+            return "no hardware counters on this CPU or VM (" + std::string(std::strerror(err)) + ")";
+        }
+        return "perf_event_open failed: " + std::string(std::strerror(err)) +
+               " (perf_event_paranoid " + std::to_string(paranoid) + ")";
+    }
+    available_mask = probe.mask();
+    enabled = true;
+    return "";
+}
+
+bool perf_counters_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+bool perf_event_available(PerfEvent event) { return available_mask.load() & (1u << event); }
+
+PerfCounts read_perf_counters() {
+    if (!perf_counters_enabled()) return PerfCounts{};
+    return thread_group().read_counts();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Hardware performance counters for --perf-counters. Each thread opens one
+// perf_event_open group (cycles leading) the first time it times a stage;
+// stage laps then read the group alongside wall and CPU time. Events the
+// kernel or PMU refuses are left out, and when none can be opened the run
+// carries on without counters.
+
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_LLC_LOADS,
+    NUM_PERF_EVENTS
+};
+
+const char* perf_event_name(PerfEvent event);
+
+using PerfCounts = std::array<uint64_t, NUM_PERF_EVENTS>;
+
+// Turn counting on for the rest of the process. Probes the calling thread
+// and returns an empty string on success, otherwise why counters are off
+// (perf_event_paranoid, missing PMU, ...).
+std::string enable_perf_counters();
+
+bool perf_counters_enabled();
+
+// Which events opened; the others read as zero
+bool perf_event_available(PerfEvent event);
+
+// The calling thread's running totals, scaled for multiplexing; zeros when
+// counting is off
+PerfCounts read_perf_counters();
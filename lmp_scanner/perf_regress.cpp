@@ -0,0 +1,265 @@
+// End-to-end performance regression check (CTest: perf_regress).
+//
+//   perf_regress <lmp_scanner> <baseline.json> [--update] [--reps N]
+//
+// Generates a fixed synthetic merged CSV, runs the full scanner on it at 1,
+// 4 and all hardware threads (best of --reps runs each, every run its own
+// process so peak RSS is per run), and reads each run's metrics.json. Rows
+// per second, peak RSS and per-stage wall times are compared against the
+// baseline; anything worse than its tolerance fails the test. Stages faster
+// than the baseline's min_stage_s are too noisy to judge and are only
+// reported. --update rewrites the baseline from this machine instead.
+#include "synthetic.h"
+#include "fast_parser.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* const STAGES[] = {"read", "parse", "aggregate", "merge", "stats", "output"};
+
+struct RunResult {
+    int threads = 0;
+    double rows_per_s = 0.0;
+    double peak_rss_kb = 0.0;
+    std::map<std::string, double> stage_s;   // wall seconds
+};
+
+struct Tolerance {
+    double rows_per_s = 0.25;    // allowed fractional drop
+    double peak_rss_kb = 0.20;   // allowed fractional growth
+    double stage_s = 0.50;
+    double min_stage_s = 0.05;   // stages shorter than this aren't judged
+};
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open file: " + path.string());
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+// The number under a dotted key path, e.g. "stages.parse.wall_s". Enough
+// for metrics.json and the baseline, whose keys nest in a known order.
+double json_number(const std::string& text, const std::string& path, double fallback = -1.0) {
+    size_t pos = 0;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t dot = path.find('.', start);
+        if (dot == std::string::npos) dot = path.size();
+        pos = text.find("\"" + path.substr(start, dot - start) + "\"", pos);
+        if (pos == std::string::npos) return fallback;
+        pos = text.find(':', pos) + 1;
+        start = dot + 1;
+    }
+    return std::strtod(text.c_str() + pos, nullptr);
+}
+
+SyntheticSpec dataset() {
+    SyntheticSpec spec;
+    spec.nodes = 1500;
+    spec.hours = 480;
+    spec.seed = 7;
+    spec.start_hour = days_from_civil(2025, 1, 1) * 24;
+    return spec;
+}
+
+void write_dataset(const std::filesystem::path& path) {
+    const SyntheticSpec spec = dataset();
+    std::ofstream out(path, std::ios::binary);
+    out << SYNTHETIC_CSV_HEADER << '\n';
+    SyntheticCursor cursor(spec);
+    char line[SYNTHETIC_MAX_LINE];
+    for (uint64_t i = 0; i < spec.rows(); i++) {
+        out.write(line, format_synthetic_row(cursor.next(), line));
+    }
+    if (!out) {
+        throw std::runtime_error("Cannot write dataset: " + path.string());
+    }
+}
+
+RunResult run_scanner(const std::string& scanner, const std::filesystem::path& work,
+                      const std::filesystem::path& csv, int threads) {
+    const auto run_dir = work / "run";
+    const std::string command = "cd \"" + run_dir.string() + "\" && \"" + scanner + "\" \"" +
+                                csv.string() + "\" --threads " + std::to_string(threads) + " > scanner.log 2>&1";
+    if (std::system(command.c_str()) != 0) {
+        throw std::runtime_error("Scanner failed (see " + (run_dir / "scanner.log").string() + ")");
+    }
+    const std::string metrics = read_file(work / "output" / "metrics.json");
+
+    RunResult r;
+    r.threads = threads;
+    const double wall = json_number(metrics, "wall_s");
+    r.rows_per_s = wall > 0 ? json_number(metrics, "counters.rows") / wall : 0.0;
+    r.peak_rss_kb = json_number(metrics, "peak_rss_kb");
+    for (const char* stage : STAGES) {
+        r.stage_s[stage] = json_number(metrics, std::string("stages.") + stage + ".wall_s", 0.0);
+    }
+    return r;
+}
+
+// Keeps the best of repeated runs: highest throughput, least memory, and
+// each stage's shortest time
+void keep_best(RunResult& best, const RunResult& r) {
+    if (best.threads == 0) {
+        best = r;
+        return;
+    }
+    best.rows_per_s = std::max(best.rows_per_s, r.rows_per_s);
+    best.peak_rss_kb = std::min(best.peak_rss_kb, r.peak_rss_kb);
+    for (auto& [stage, seconds] : best.stage_s) seconds = std::min(seconds, r.stage_s.at(stage));
+}
+
+void write_baseline(const std::filesystem::path& path, const std::vector<std::pair<std::string, RunResult>>& runs,
+                    const Tolerance& tol) {
+    const SyntheticSpec spec = dataset();
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot write output file: " + path.string());
+    }
+    out << std::fixed << std::setprecision(6);
+    out << "{\n";
+    out << "  \"dataset\": \"synthetic " << spec.nodes << "x" << spec.hours << ":" << spec.seed << "\",\n";
+    out << "  \"tolerance\": {\"rows_per_s\": " << tol.rows_per_s << ", \"peak_rss_kb\": " << tol.peak_rss_kb
+        << ", \"stage_s\": " << tol.stage_s << ", \"min_stage_s\": " << tol.min_stage_s << "},\n";
+    out << "  \"runs\": {";
+    const char* sep = "\n";
+    for (const auto& [label, r] : runs) {
+        out << sep << "    \"" << label << "\": {\"threads\": " << r.threads << ", \"rows_per_s\": " << r.rows_per_s
+            << ", \"peak_rss_kb\": " << r.peak_rss_kb << ", \"stages\": {";
+        const char* stage_sep = "";
+        for (const char* stage : STAGES) {
+            out << stage_sep << "\"" << stage << "\": " << r.stage_s.at(stage);
+            stage_sep = ", ";
+        }
+        out << "}}";
+        sep = ",\n";
+    }
+    out << "\n  }\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <lmp_scanner> <baseline.json> [--update] [--reps N]" << std::endl;
+        return 1;
+    }
+    const std::string scanner = std::filesystem::absolute(argv[1]).string();
+    const std::filesystem::path baseline_path = std::filesystem::absolute(argv[2]);
+    bool update = false;
+    int reps = 3;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--update") update = true;
+        else if (arg == "--reps" && i + 1 < argc) reps = std::max(1, std::stoi(argv[++i]));
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        // Work in the current (build) directory; the scanner writes ../output
+        const auto work = std::filesystem::absolute("perf_regress_work");
+        std::filesystem::create_directories(work / "run");
+        std::filesystem::create_directories(work / "output");
+        const auto csv = work / "dataset.csv";
+        const SyntheticSpec spec = dataset();
+        std::cout << "Generating dataset (" << spec.rows() << " rows)..." << std::endl;
+        write_dataset(csv);
+
+        const int cores = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::pair<std::string, int>> configs = {{"1", 1}, {"4", 4}, {"max", cores}};
+
+        std::vector<std::pair<std::string, RunResult>> runs;
+        for (const auto& [label, threads] : configs) {
+            RunResult best;
+            for (int rep = 0; rep < reps; rep++) keep_best(best, run_scanner(scanner, work, csv, threads));
+            runs.emplace_back(label, best);
+        }
+        std::filesystem::remove(csv);
+
+        // Speedup over one thread, and how much of the ideal that is on
+        // this machine (threads beyond the core count can't add any)
+        const double single = runs.front().second.rows_per_s;
+        std::cout << std::fixed << "\nScaling (" << cores << " hardware threads):" << std::endl;
+        std::cout << "  threads      rows/s  speedup  efficiency   peak RSS MB" << std::endl;
+        for (const auto& [label, r] : runs) {
+            const double speedup = single > 0 ? r.rows_per_s / single : 0.0;
+            const double ideal = std::min(r.threads, cores);
+            std::cout << "  " << std::setw(7) << r.threads << std::setw(12) << std::setprecision(0) << r.rows_per_s
+                      << std::setw(8) << std::setprecision(2) << speedup << "x" << std::setw(11)
+                      << std::setprecision(0) << 100.0 * speedup / ideal << "%" << std::setw(14)
+                      << std::setprecision(1) << r.peak_rss_kb / 1024 << std::endl;
+        }
+
+        if (update) {
+            write_baseline(baseline_path, runs, Tolerance());
+            std::cout << "\nBaseline written to " << baseline_path.string() << std::endl;
+            return 0;
+        }
+
+        const std::string baseline = read_file(baseline_path);
+        Tolerance tol;
+        tol.rows_per_s = json_number(baseline, "tolerance.rows_per_s", tol.rows_per_s);
+        tol.peak_rss_kb = json_number(baseline, "tolerance.peak_rss_kb", tol.peak_rss_kb);
+        tol.stage_s = json_number(baseline, "tolerance.stage_s", tol.stage_s);
+        tol.min_stage_s = json_number(baseline, "tolerance.min_stage_s", tol.min_stage_s);
+
+        int failures = 0;
+        auto check = [&](const std::string& what, double value, double base, double allowed, bool higher_is_better) {
+            if (base <= 0) return;
+            const double change = (value - base) / base;
+            const bool regressed = higher_is_better ? change < -allowed : change > allowed;
+            if (regressed) failures++;
+            std::cout << "  " << (regressed ? "FAIL " : "ok   ") << std::left << std::setw(26) << what
+                      << std::right << std::setprecision(3) << std::setw(14) << value << "  baseline "
+                      << std::setw(14) << base << std::setprecision(1) << std::showpos << std::setw(8)
+                      << 100.0 * change << "%" << std::noshowpos << std::endl;
+        };
+
+        std::cout << "\nAgainst " << baseline_path.filename().string() << ":" << std::endl;
+        for (const auto& [label, r] : runs) {
+            const std::string key = "runs." + label;
+            if (json_number(baseline, key + ".threads") < 0) {
+                std::cout << "  (no baseline for " << label << " threads)" << std::endl;
+                continue;
+            }
+            const std::string prefix = label + " threads ";
+            check(prefix + "rows/s", r.rows_per_s, json_number(baseline, key + ".rows_per_s"), tol.rows_per_s, true);
+            check(prefix + "peak RSS KB", r.peak_rss_kb, json_number(baseline, key + ".peak_rss_kb"),
+                  tol.peak_rss_kb, false);
+            for (const char* stage : STAGES) {
+                const double base = json_number(baseline, key + ".stages." + stage, 0.0);
+                if (base < tol.min_stage_s) continue;
+                check(prefix + stage + " s", r.stage_s.at(stage), base, tol.stage_s, false);
+            }
+        }
+
+        if (failures > 0) {
+            std::cout << "\n" << failures << " performance regression(s)" << std::endl;
+            return 1;
+        }
+        std::cout << "\nNo performance regressions" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "pipeline.h"
+#include "csv_writer.h"
+#include <algorithm>
+
+Generator<RowBatch> filter_batches(Generator<RowBatch> in, const RowFilter& filter, int filter_zone) {
+    for (RowBatch& b : in) {
+        const uint32_t before = b.selected;
+        select_rows(b, filter, filter_zone);
+        thread_metrics().filtered += before - b.selected;
+        if (b.selected > 0) co_yield b;
+    }
+}
+
+Generator<RowBatch> project_batches(Generator<RowBatch> in, BatchColumns columns) {
+    for (RowBatch& b : in) {
+        derive_columns(b, columns);
+        co_yield b;
+    }
+}
+
+Pipeline& Pipeline::filter(const RowFilter& filter) {
+    filter_ = (filter.active() && !source_.applies_filter()) ? &filter : nullptr;
+    return *this;
+}
+
+Pipeline& Pipeline::project(const BatchColumns& columns) {
+    project_ = true;
+    columns_ = columns;
+    return *this;
+}
+
+int Pipeline::filter_zone() const {
+    if (!filter_ || filter_->zone.empty()) return -1;
+    return source_.zones().find(filter_->zone);
+}
+
+Generator<RowBatch> Pipeline::open(RowBatch& batch) const {
+    Generator<RowBatch> stream = source_.stream(batch);
+    if (filter_) stream = filter_batches(std::move(stream), *filter_, filter_zone());
+    if (project_) stream = project_batches(std::move(stream), columns_);
+    return stream;
+}
+
+void ZoneHourSink::consume(const RowBatch& b) {
+    for (uint32_t k = 0; k < b.selected; k++) {
+        const uint32_t i = b.sel[k];
+        const uint16_t zone = b.zone_id[i];
+        if (zone >= sum_.size()) {
+            sum_.resize(zone + 1, {});
+            count_.resize(zone + 1, {});
+        }
+        sum_[zone][b.hour[i]] += b.spread[i];
+        count_[zone][b.hour[i]]++;
+    }
+}
+
+void ZoneHourSink::merge(const ZoneHourSink& other) {
+    if (other.sum_.size() > sum_.size()) {
+        sum_.resize(other.sum_.size(), {});
+        count_.resize(other.count_.size(), {});
+    }
+    for (size_t z = 0; z < other.sum_.size(); z++) {
+        for (int h = 0; h < 24; h++) {
+            sum_[z][h] += other.sum_[z][h];
+            count_[z][h] += other.count_[z][h];
+        }
+    }
+}
+
+void ZoneHourSink::write(const std::string& path, ZoneDictionary& zones) const {
+    std::vector<std::pair<std::string, size_t>> order;
+    for (size_t z = 0; z < sum_.size(); z++) {
+        order.emplace_back(zones.name(static_cast<uint16_t>(z)), z);
+    }
+    std::sort(order.begin(), order.end());
+
+    CsvWriter file(path);
+    file.text("zone,hour,samples,mean_spread\n");
+    for (const auto& [name, z] : order) {
+        for (int h = 0; h < 24; h++) {
+            if (count_[z][h] == 0) continue;
+            file.row(name, h, count_[z][h], sum_[z][h] / count_[z][h]);
+        }
+    }
+    file.close();
+}
+
+void BlockSpreadSink::consume(const RowBatch& b) {
+    BlockSpread* node = nullptr;
+    int current = INT_MIN;
+    for (uint32_t k = 0; k < b.selected; k++) {
+        const uint32_t i = b.sel[k];
+        if (b.pnode_id[i] != current) {
+            current = b.pnode_id[i];
+            node = &nodes[current];
+        }
+        node->add(b.unit, b.spread[i]);
+    }
+}
+
+void BlockSpreadSink::merge(BlockSpreadSink& other) {
+    for (auto& [node_id, spread] : other.nodes) nodes[node_id].merge(spread);
+}
+
+void CountSink::consume(const RowBatch& b) {
+    rows += b.selected;
+    for (uint32_t k = 0; k < b.selected; k++) {
+        const uint32_t i = b.sel[k];
+        spread_sum += b.spread[i];
+        first_hour = std::min(first_hour, b.hour_stamp[i]);
+        last_hour = std::max(last_hour, b.hour_stamp[i]);
+    }
+}
+
+void CountSink::merge(const CountSink& other) {
+    rows += other.rows;
+    spread_sum += other.spread_sum;
+    first_hour = std::min(first_hour, other.first_hour);
+    last_hour = std::max(last_hour, other.last_hour);
+}
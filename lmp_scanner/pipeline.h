@@ -0,0 +1,294 @@
+#pragma once
+#include "batch.h"
+#include "run_metrics.h"
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Operator pipelines over batch streams. Each operator is a generator
+// adaptor: it pulls batches from the stream it wraps and yields the ones it
+// passes on, so scan | filter | project runs batch by batch on every worker
+// with no queues or copies between stages.
+
+// Narrow each batch's selection to rows passing the filter; batches left
+// with no rows are dropped
+Generator<RowBatch> filter_batches(Generator<RowBatch> in, const RowFilter& filter, int filter_zone);
+
+// Compute the derived columns (hour of day, component spreads)
+Generator<RowBatch> project_batches(Generator<RowBatch> in, BatchColumns columns);
+
+// scan -> [filter] -> [project] over one source
+class Pipeline {
+public:
+    explicit Pipeline(BatchSource& source) : source_(source) {}
+
+    // No-op when the filter is inactive or the source already applies it
+    Pipeline& filter(const RowFilter& filter);
+    Pipeline& project(const BatchColumns& columns);
+
+    BatchSource& source() const { return source_; }
+    bool filters() const { return filter_ != nullptr; }
+    bool projects() const { return project_; }
+    const BatchColumns& columns() const { return columns_; }
+    int filter_zone() const;
+
+    // One worker's stream through every stage
+    Generator<RowBatch> open(RowBatch& batch) const;
+
+private:
+    BatchSource& source_;
+    const RowFilter* filter_ = nullptr;
+    bool project_ = false;
+    BatchColumns columns_;
+};
+
+// Sinks consume the selected rows of a batch and merge with the sinks of
+// other workers. A sink is private to its worker until the merge.
+
+// Per-node accumulators
+template <typename Acc>
+class NodeSink {
+public:
+    explicit NodeSink(ZoneDictionary& zones) : zones_(&zones) { nodes.reserve(15000); }
+
+    void consume(const RowBatch& b) { aggregate_batch(b, nodes, *zones_); }
+
+    void merge(NodeSink& other) {
+        for (auto& [node_id, acc] : other.nodes) nodes[node_id].merge(acc);
+    }
+
+    std::unordered_map<int, Acc> nodes;
+
+private:
+    ZoneDictionary* zones_;
+};
+
+// Mean spread per zone and hour of day
+class ZoneHourSink {
+public:
+    void consume(const RowBatch& b);
+    void merge(const ZoneHourSink& other);
+    void write(const std::string& path, ZoneDictionary& zones) const;
+
+private:
+    std::vector<std::array<double, 24>> sum_;      // by zone id
+    std::vector<std::array<long long, 24>> count_;
+};
+
+// Row count, spread total and time range
+struct CountSink {
+    long long rows = 0;
+    double spread_sum = 0.0;
+    int first_hour = INT_MAX;
+    int last_hour = INT_MIN;
+
+    void consume(const RowBatch& b);
+    void merge(const CountSink& other);
+};
+
+// A node's spread totals over the blocks of a sampled scan. Rows in one
+// block are consecutive hours, so they are one cluster, not independent
+// draws; the variance of each estimate comes from the spread between
+// blocks. A worker finishes a block before taking the next, so a node's
+// block is closed when its rows arrive from a different one.
+struct BlockSpread {
+    uint32_t unit = UINT32_MAX;   // block still open
+    std::array<double, 3> open{};   // rows, sum, sum of squares
+
+    long long blocks = 0;             // closed blocks
+    std::array<double, 3> total{};    // the same totals over closed blocks
+    std::array<double, 6> products{}; // sums of their pairwise products per block
+    double cubes = 0.0, fourths = 0.0;   // every row, for the kurtosis
+
+    void add(uint32_t block, double spread) {
+        if (block != unit) {
+            close();
+            unit = block;
+        }
+        open[0] += 1;
+        open[1] += spread;
+        open[2] += spread * spread;
+        cubes += spread * spread * spread;
+        fourths += spread * spread * spread * spread;
+    }
+
+    void close() {
+        if (open[0] == 0) return;
+        blocks++;
+        for (int a = 0, k = 0; a < 3; a++) {
+            total[a] += open[a];
+            for (int b = a; b < 3; b++) products[k++] += open[a] * open[b];
+        }
+        open = {};
+    }
+
+    void merge(BlockSpread& other) {
+        other.close();
+        close();
+        blocks += other.blocks;
+        for (int a = 0; a < 3; a++) total[a] += other.total[a];
+        for (int k = 0; k < 6; k++) products[k] += other.products[k];
+        cubes += other.cubes;
+        fourths += other.fourths;
+    }
+
+    // Central moments over every row: {variance, fourth moment}
+    std::array<double, 2> moments() const {
+        const double rows = total[0] + open[0];
+        if (rows == 0) return {0.0, 0.0};
+        const double mean = (total[1] + open[1]) / rows;
+        const double squares = (total[2] + open[2]) / rows;
+        const double var = std::max(0.0, squares - mean * mean);
+        const double m4 = fourths / rows - 4 * mean * cubes / rows + 6 * mean * mean * squares -
+                          3 * mean * mean * mean * mean;
+        return {var, std::max(0.0, m4)};
+    }
+
+    // Between-block variances (blocks drawn with replacement) of the mean,
+    // the std and the Sharpe ratio, each linearized into a per-block
+    // residual over (rows, sum, sum of squares); -1 with fewer than two
+    // blocks or a flat series
+    struct Variances {
+        double mean = -1.0, std_dev = -1.0, sharpe = -1.0;
+    };
+
+    Variances variances() const {
+        Variances v;
+        if (blocks < 2) return v;
+        const double rows = total[0];
+        const double mean = total[1] / rows;
+        const double var = std::max(0.0, total[2] / rows - mean * mean);
+
+        // sum over blocks of (w . block totals)^2, divided down to the estimate
+        auto spread = [&](const std::array<double, 3>& w) {
+            double sum = 0.0;
+            for (int a = 0, k = 0; a < 3; a++) {
+                for (int b = a; b < 3; b++, k++) sum += (a == b ? 1.0 : 2.0) * w[a] * w[b] * products[k];
+            }
+            return static_cast<double>(blocks) / (blocks - 1) * std::max(0.0, sum) / (rows * rows);
+        };
+        const std::array<double, 3> d_mean{-mean, 1.0, 0.0};
+        const std::array<double, 3> d_var{2 * mean * mean - (var + mean * mean), -2 * mean, 1.0};
+        v.mean = spread(d_mean);
+        if (var <= 0) return v;
+
+        // std = sqrt(var), sharpe = mean / std
+        const double sd = std::sqrt(var);
+        v.std_dev = spread(d_var) / (4 * var);
+        std::array<double, 3> d_sharpe;
+        for (int a = 0; a < 3; a++) d_sharpe[a] = d_mean[a] / sd - mean / (2 * var * sd) * d_var[a];
+        v.sharpe = spread(d_sharpe);
+        return v;
+    }
+};
+
+class BlockSpreadSink {
+public:
+    void consume(const RowBatch& b);
+    void merge(BlockSpreadSink& other);
+
+    std::unordered_map<int, BlockSpread> nodes;
+};
+
+// Run the pipeline on `threads` workers, each consuming into its own sink
+// from make_sink(), then merge the sinks into `result`. Returns the rows
+// that reached the sinks.
+template <typename Sink, typename MakeSink>
+long long run_parallel(const Pipeline& pipeline, int threads, Sink& result, MakeSink make_sink,
+                       bool verbose = true) {
+    BatchSource& source = pipeline.source();
+    std::mutex merge_mutex;
+    long long total = 0;
+
+    source.start();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            ThreadScope scope("worker");
+            auto& metrics = thread_metrics();
+            Sink sink = make_sink();
+            RowBatch batch;
+            long long rows = 0;
+
+            // Time inside the chain is the source and operators; read and
+            // queue waits inside the source are taken back out below
+            StageClock clock;
+            for (RowBatch& b : pipeline.open(batch)) {
+                clock.lap(metrics.stages[STAGE_PARSE]);
+                rows += b.selected;
+                sink.consume(b);
+                clock.lap(metrics.stages[STAGE_AGGREGATE]);
+            }
+            clock.lap(metrics.stages[STAGE_PARSE]);
+            auto& parse = metrics.stages[STAGE_PARSE];
+            parse.busy -= metrics.stages[STAGE_READ].busy + metrics.wait;
+            parse.cpu -= metrics.stages[STAGE_READ].cpu;
+            for (int e = 0; e < NUM_PERF_EVENTS; e++) parse.events[e] -= metrics.stages[STAGE_READ].events[e];
+            metrics.rows += rows;
+
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            result.merge(sink);
+            clock.lap(metrics.stages[STAGE_MERGE]);
+            total += rows;
+            if (verbose) std::cout << "  Thread " << t << " complete (" << rows << " rows)" << std::endl;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    source.finish();
+    return total;
+}
+
+// The same work as run_parallel with the stages hand-fused into one loop;
+// the baseline for measuring what the operator chain costs
+template <typename Sink, typename MakeSink>
+long long run_fused(const Pipeline& pipeline, int threads, Sink& result, MakeSink make_sink,
+                    const RowFilter& filter) {
+    BatchSource& source = pipeline.source();
+    const int filter_zone = pipeline.filter_zone();
+    std::mutex merge_mutex;
+    long long total = 0;
+
+    source.start();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            // Instrumented like run_parallel so the comparison stays fair
+            ThreadScope scope("worker");
+            auto& metrics = thread_metrics();
+            Sink sink = make_sink();
+            RowBatch batch;
+            long long rows = 0;
+            StageClock clock;
+            for (RowBatch& b : source.stream(batch)) {
+                if (pipeline.filters()) {
+                    const uint32_t before = b.selected;
+                    select_rows(b, filter, filter_zone);
+                    metrics.filtered += before - b.selected;
+                    if (b.selected == 0) continue;
+                }
+                if (pipeline.projects()) derive_columns(b, pipeline.columns());
+                clock.lap(metrics.stages[STAGE_PARSE]);
+                rows += b.selected;
+                sink.consume(b);
+                clock.lap(metrics.stages[STAGE_AGGREGATE]);
+            }
+            clock.lap(metrics.stages[STAGE_PARSE]);
+            metrics.rows += rows;
+
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            result.merge(sink);
+            total += rows;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    source.finish();
+    return total;
+}
@@ -0,0 +1,139 @@
+#include "regimes.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <thread>
+
+void SeriesSink::consume(const RowBatch& b) {
+    std::vector<SeriesPoint>* points = nullptr;
+    int current = INT_MIN;
+    for (uint32_t k = 0; k < b.selected; k++) {
+        const uint32_t i = b.sel[k];
+        if (b.pnode_id[i] != current) {
+            current = b.pnode_id[i];
+            points = &nodes[current];
+        }
+        points->push_back({b.hour_stamp[i], static_cast<float>(b.spread[i]),
+                           static_cast<float>(b.cong_spread[i])});
+    }
+}
+
+void SeriesSink::merge(SeriesSink& other) {
+    for (auto& [node_id, points] : other.nodes) {
+        auto& mine = nodes[node_id];
+        if (mine.empty()) {
+            mine.swap(points);
+        } else {
+            mine.insert(mine.end(), points.begin(), points.end());
+        }
+    }
+    other.nodes.clear();
+}
+
+std::vector<Regime> detect_regimes(const std::vector<SeriesPoint>& points, float SeriesPoint::*value,
+                                   const RegimeParams& params) {
+    std::vector<Regime> regimes;
+    if (points.empty()) return regimes;
+
+    // Running statistics of the current regime
+    int count = 0;
+    double mean = 0.0;
+    double M2 = 0.0;
+    auto add = [&](double x) {
+        count++;
+        double delta = x - mean;
+        mean += delta / count;
+        M2 += delta * (x - mean);
+    };
+
+    // Rows [from, to) become a finished regime
+    auto close = [&](size_t from, size_t to) {
+        int n = 0;
+        double m = 0.0, m2 = 0.0;
+        for (size_t i = from; i < to; i++) {
+            double x = points[i].*value;
+            n++;
+            double delta = x - m;
+            m += delta / n;
+            m2 += delta * (x - m);
+        }
+        regimes.push_back({points[from].hour_stamp, points[to - 1].hour_stamp, n, m, std::sqrt(m2 / n)});
+    };
+
+    size_t start = 0;
+    double up = 0.0, down = 0.0;         // CUSUM of upward and downward shifts
+    size_t up_from = 0, down_from = 0;   // where each excursion began
+    for (size_t i = 0; i < points.size(); i++) {
+        const double x = points[i].*value;
+        if (count >= params.warmup && M2 > 0) {
+            const double z = std::clamp((x - mean) / std::sqrt(M2 / count), -params.clip, params.clip);
+            if (up == 0) up_from = i;
+            if (down == 0) down_from = i;
+            up = std::max(0.0, up + z - params.drift);
+            down = std::max(0.0, down - z - params.drift);
+            if (up > params.threshold || down > params.threshold) {
+                const size_t change = up > params.threshold ? up_from : down_from;
+                close(start, change);
+
+                // The new regime starts with the excursion's rows
+                start = change;
+                count = 0;
+                mean = M2 = 0.0;
+                up = down = 0.0;
+                for (size_t j = change; j <= i; j++) add(points[j].*value);
+                continue;
+            }
+        }
+        add(x);
+    }
+    close(start, points.size());
+    return regimes;
+}
+
+std::unordered_map<int, NodeRegimes> detect_node_regimes(std::unordered_map<int, std::vector<SeriesPoint>>& series,
+                                                         int threads, const RegimeParams& params) {
+    std::vector<std::pair<int, std::vector<SeriesPoint>*>> work;
+    work.reserve(series.size());
+    for (auto& [node_id, points] : series) work.emplace_back(node_id, &points);
+
+    std::vector<NodeRegimes> found(work.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            for (size_t k; (k = next++) < work.size();) {
+                auto& points = *work[k].second;
+                // Workers' rows interleave; within a node they are usually close to sorted
+                auto by_time = [](const SeriesPoint& a, const SeriesPoint& b) { return a.hour_stamp < b.hour_stamp; };
+                if (!std::is_sorted(points.begin(), points.end(), by_time)) {
+                    std::sort(points.begin(), points.end(), by_time);
+                }
+                NodeRegimes& node = found[k];
+                node.pnode_id = work[k].first;
+                node.spread = detect_regimes(points, &SeriesPoint::spread, params);
+                node.congestion = detect_regimes(points, &SeriesPoint::congestion, params);
+                std::vector<SeriesPoint>().swap(points);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // "Recent" is measured from the last hour in the data, not the clock
+    int last_hour = INT_MIN;
+    for (const auto& node : found) {
+        if (!node.spread.empty()) last_hour = std::max(last_hour, node.spread.back().end_hour);
+    }
+    std::unordered_map<int, NodeRegimes> regimes;
+    regimes.reserve(found.size());
+    for (auto& node : found) {
+        auto recent = [&](const std::vector<Regime>& r) {
+            return r.size() > 1 && r.back().start_hour >= last_hour - params.recent_hours;
+        };
+        node.recent_break = recent(node.spread) || recent(node.congestion);
+        regimes.emplace(node.pnode_id, std::move(node));
+    }
+    return regimes;
+}
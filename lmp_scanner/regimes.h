@@ -0,0 +1,62 @@
+#pragma once
+#include "batch.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Regime detection (--regimes). Each node's spread and congestion spread
+// are replayed in time order through a two-sided CUSUM against the running
+// mean and std of the current regime; an alarm closes the regime where the
+// excursion began and starts a new one there. Standardized deviations are
+// clipped, so one price spike can't raise an alarm on its own.
+
+// One hourly row of a node's series
+struct SeriesPoint {
+    int32_t hour_stamp;
+    float spread;
+    float congestion;
+};
+
+// Every row of every node, gathered during the scan. Workers keep their
+// own maps; merging appends, and detection sorts each node's rows by time.
+class SeriesSink {
+public:
+    void consume(const RowBatch& b);
+    void merge(SeriesSink& other);
+
+    std::unordered_map<int, std::vector<SeriesPoint>> nodes;
+};
+
+// A run of rows between change points
+struct Regime {
+    int start_hour;   // hour stamps of the first and last row
+    int end_hour;
+    int rows;
+    double mean;
+    double std_dev;
+};
+
+struct NodeRegimes {
+    int pnode_id = 0;
+    std::vector<Regime> spread;       // oldest first; back() is current
+    std::vector<Regime> congestion;
+    bool recent_break = false;        // either series changed within RECENT_HOURS of the data's end
+};
+
+struct RegimeParams {
+    int warmup = 48;           // rows that seed a regime before it is tested
+    double drift = 0.5;        // CUSUM allowance k, in regime std units
+    double threshold = 12.0;   // alarm level h
+    double clip = 3.0;         // |z| cap per row
+    int recent_hours = 14 * 24;
+};
+
+// The regimes of one series, oldest first
+std::vector<Regime> detect_regimes(const std::vector<SeriesPoint>& points, float SeriesPoint::*value,
+                                   const RegimeParams& params = {});
+
+// Detect both series of every node on `threads` workers, each taking the
+// next unclaimed node. Series are freed as they are processed.
+std::unordered_map<int, NodeRegimes> detect_node_regimes(std::unordered_map<int, std::vector<SeriesPoint>>& series,
+                                                         int threads, const RegimeParams& params = {});
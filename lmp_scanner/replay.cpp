@@ -0,0 +1,132 @@
+// Replays a historical merged CSV as a live RT feed for `lmp_scanner stream`.
+//
+//   lmp_replay <merged.csv> --day 2025-08-01 --da-out da.csv
+//   lmp_replay <merged.csv> --day 2025-08-01 --speed 3600 | lmp_scanner stream da.csv -
+//
+// --speed is simulated seconds per wall second (3600 = one market hour per
+// second, 0 = as fast as possible).
+#include "csv_header.h"
+#include "fast_parser.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <merged.csv> [--day YYYY-MM-DD] [--speed X] [--da-out path]" << std::endl;
+        return 1;
+    }
+
+    std::string csv_path = argv[1];
+    std::string day;
+    std::string da_out;
+    double speed = 0.0;
+
+    try {
+        for (int i = 2; i < argc; i += 2) {
+            std::string flag = argv[i];
+            if (flag != "--day" && flag != "--speed" && flag != "--da-out") {
+                throw std::runtime_error("Unknown option: " + flag);
+            }
+            if (i + 1 == argc) throw std::runtime_error(flag + " needs a value");
+            std::string value = argv[i + 1];
+            if (flag == "--day") day = value;
+            else if (flag == "--da-out") da_out = value;
+            else {
+                size_t used = 0;
+                try {
+                    speed = std::stod(value, &used);
+                } catch (const std::logic_error&) {   // invalid_argument, out_of_range
+                    used = 0;
+                }
+                if (used == 0 || used != value.size() || !is_finite(speed) || speed < 0) {
+                    throw std::runtime_error("Invalid --speed: " + value);
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(csv_path);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open CSV file: " << csv_path << std::endl;
+        return 1;
+    }
+
+    std::string line;
+    std::getline(file, line);
+    CSVHeader header(line);
+
+    int col_datetime = header.find({"datetime_beginning_ept", "datetime"});
+    int col_pnode = header.find({"pnode_id"});
+    int col_total_da = header.find({"total_lmp_da"});
+    int col_cong_da = header.find({"congestion_price_da"});
+    int col_total_rt = header.find({"total_lmp_rt"});
+    int col_cong_rt = header.find({"congestion_price_rt"});
+    if (col_datetime < 0 || col_pnode < 0 || col_total_da < 0 || col_cong_da < 0 ||
+        col_total_rt < 0 || col_cong_rt < 0) {
+        std::cerr << "Merged CSV is missing DA/RT price columns" << std::endl;
+        return 1;
+    }
+
+    const bool write_da = !da_out.empty();
+    std::ofstream da_file;
+    if (write_da) {
+        da_file.open(da_out);
+        da_file << "datetime_beginning_ept,pnode_id,total_lmp_da,congestion_price_da\n";
+    } else {
+        std::ios::sync_with_stdio(false);
+        std::cout << "datetime_beginning_ept,pnode_id,total_lmp_rt,congestion_price_rt\n";
+    }
+
+    const int MAX_FIELDS = 64;
+    const char* starts[MAX_FIELDS];
+    size_t lengths[MAX_FIELDS];
+
+    std::string current_interval;
+    auto interval_start = std::chrono::steady_clock::now();
+    long long rows = 0;
+
+    auto field = [&](int col) { return std::string(starts[col], lengths[col]); };
+
+    while (std::getline(file, line)) {
+        int fields = split_fields(line.data(), line.size(), starts, lengths, MAX_FIELDS);
+        if (fields <= col_cong_rt || fields <= col_datetime || fields <= col_pnode) continue;
+
+        std::string datetime = field(col_datetime);
+        if (!day.empty() && datetime.compare(0, day.size(), day) != 0) continue;
+
+        if (write_da) {
+            da_file << datetime << "," << field(col_pnode) << ","
+                    << field(col_total_da) << "," << field(col_cong_da) << "\n";
+            rows++;
+            continue;
+        }
+
+        // Pace the feed: each new interval is released one simulated hour later
+        if (datetime != current_interval) {
+            if (speed > 0 && !current_interval.empty()) {
+                std::cout.flush();
+                interval_start += std::chrono::microseconds(
+                    static_cast<long long>(3600.0 / speed * 1e6));
+                std::this_thread::sleep_until(interval_start);
+            }
+            current_interval = datetime;
+        }
+
+        std::cout << datetime << "," << field(col_pnode) << ","
+                  << field(col_total_rt) << "," << field(col_cong_rt) << "\n";
+        rows++;
+    }
+
+    std::cout.flush();
+    std::cerr << "Replayed " << rows << " rows" << (write_da ? " of DA prices" : "") << std::endl;
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include "result_cache.h"
+#include "batch.h"
+#include "synthetic.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'L', 'M', 'P', 'C', 'A', 'C', 'H', 'E'};
+
+// Sampled blocks hashed into the input fingerprint
+const int SAMPLE_BLOCKS = 64;
+const size_t SAMPLE_BYTES = 64 * 1024;
+
+// XXH64
+const uint64_t P1 = 0x9E3779B185EBCA87ULL;
+const uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t P3 = 0x165667B19E3779F9ULL;
+const uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * P2;
+    return rotl(acc, 31) * P1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= round64(0, val);
+    return acc * P1 + P4;
+}
+
+uint64_t xxh64(const void* data, size_t len, uint64_t seed = 0) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + P5;
+    }
+    h += len;
+    for (; p + 8 <= end; p += 8) h = rotl(h ^ round64(0, read64(p)), 27) * P1 + P4;
+    if (p + 4 <= end) {
+        h = rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) h = rotl(h ^ (*p * P5), 11) * P1;
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    return h ^ (h >> 32);
+}
+
+std::string hex(uint64_t v) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(v));
+    return text;
+}
+
+// size, mtime and a hash of the first and last blocks plus evenly spaced
+// ones between; "" if the file can't be read
+std::string file_fingerprint(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return "";
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return "";
+    }
+    const uint64_t size = st.st_size;
+    std::vector<char> block(SAMPLE_BYTES);
+    uint64_t hash = 0;
+    for (int b = 0; b < SAMPLE_BLOCKS; b++) {
+        uint64_t offset = size <= SAMPLE_BYTES ? 0 : (size - SAMPLE_BYTES) / (SAMPLE_BLOCKS - 1) * b;
+        if (b == SAMPLE_BLOCKS - 1 && size > SAMPLE_BYTES) offset = size - SAMPLE_BYTES;
+        ssize_t got = pread(fd, block.data(), block.size(), offset);
+        if (got < 0) {
+            ::close(fd);
+            return "";
+        }
+        hash = xxh64(block.data(), got, hash);
+        if (size <= SAMPLE_BYTES) break;
+    }
+    ::close(fd);
+    std::ostringstream out;
+    out << size << ":" << st.st_mtim.tv_sec << "." << st.st_mtim.tv_nsec << ":" << hex(hash);
+    return out.str();
+}
+
+template <typename T>
+void put(std::ostream& out, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool get(std::istream& in, T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+} // namespace
+
+std::string ResultCache::key(const std::vector<std::string>& inputs, const ScanOptions& options) {
+    std::string identity;
+    const std::string& input = inputs.front();
+    if (is_multi_input(inputs)) {
+        for (const auto& path : expand_inputs(inputs)) {
+            const std::string fingerprint = file_fingerprint(path);
+            if (fingerprint.empty()) return "";
+            identity += path + "=" + fingerprint + ";";
+        }
+    } else if (is_synthetic_spec(input)) {
+        identity = input;
+    } else {
+        std::string path = text_input_path(input);
+        if (path.empty()) path = input;   // .lmpb store or gzip file
+        if (path == "/dev/stdin") return "";
+        identity = file_fingerprint(path);
+        if (identity.empty()) return "";
+    }
+
+    const RowFilter& f = options.filter;
+    std::ostringstream key;
+    key << "lmp_scanner " << SCANNER_VERSION << "; acc " << sizeof(NodeAccumulator) << "/"
+        << sizeof(IntraHourStats) << "; input " << identity
+        << "; validated 1; metrics " << static_cast<int>(options.metrics) << "; fixed " << options.fixed_point
+        << "; fivemin " << options.rt_fivemin << "; from " << f.from_hour << "; to " << f.to_hour
+        << "; zone " << f.zone << "; hours " << f.hours << "; nodes " << f.nodes.size() << ":"
+        << hex(xxh64(f.nodes.data(), f.nodes.size() * sizeof(int)));
+    return key.str();
+}
+
+std::string ResultCache::entry_name(const std::string& key) {
+    return hex(xxh64(key.data(), key.size())) + ".lmpc";
+}
+
+bool ResultCache::load(const std::string& key, std::unordered_map<int, NodeAccumulator>& nodes,
+                       std::unordered_map<int, IntraHourStats>& intrahour) const {
+    std::ifstream in(std::filesystem::path(dir_) / entry_name(key), std::ios::binary);
+    if (!in.is_open()) return false;
+
+    char magic[8];
+    uint32_t key_len = 0;
+    if (!in.read(magic, 8) || std::memcmp(magic, CACHE_MAGIC, 8) != 0 || !get(in, key_len)) return false;
+    std::string stored(key_len, '\0');
+    if (!in.read(stored.data(), key_len) || stored != key) return false;
+
+    std::unordered_map<int, NodeAccumulator> loaded;
+    uint64_t count = 0;
+    if (!get(in, count)) return false;
+    loaded.reserve(count);
+    for (uint64_t i = 0; i < count; i++) {
+        int32_t node_id = 0;
+        uint16_t zone_len = 0;
+        if (!get(in, node_id)) return false;
+        NodeAccumulator& acc = loaded[node_id];
+        if (!get(in, acc.n) || !get(in, acc.pnode_id) || !get(in, zone_len)) return false;
+        acc.zone.resize(zone_len);
+        if (!in.read(acc.zone.data(), zone_len)) return false;
+        bool ok = true;
+        std::apply([&](auto&... policy) { ((ok = ok && get(in, policy)), ...); }, acc.metrics);
+        if (!ok) return false;
+    }
+
+    std::unordered_map<int, IntraHourStats> loaded_intrahour;
+    if (!get(in, count)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        int32_t node_id = 0;
+        if (!get(in, node_id) || !get(in, loaded_intrahour[node_id])) return false;
+    }
+
+    nodes = std::move(loaded);
+    intrahour = std::move(loaded_intrahour);
+    return true;
+}
+
+void ResultCache::store(const std::string& key, const std::unordered_map<int, NodeAccumulator>& nodes,
+                        const std::unordered_map<int, IntraHourStats>& intrahour) const {
+    std::filesystem::create_directories(dir_);
+    const auto path = std::filesystem::path(dir_) / entry_name(key);
+    const auto temp = path.string() + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(temp, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot write output file: " + temp);
+        }
+        out.write(CACHE_MAGIC, 8);
+        put(out, static_cast<uint32_t>(key.size()));
+        out.write(key.data(), key.size());
+
+        put(out, static_cast<uint64_t>(nodes.size()));
+        for (const auto& [node_id, acc] : nodes) {
+            put(out, static_cast<int32_t>(node_id));
+            put(out, acc.n);
+            put(out, acc.pnode_id);
+            put(out, static_cast<uint16_t>(acc.zone.size()));
+            out.write(acc.zone.data(), acc.zone.size());
+            std::apply([&](const auto&... policy) { (put(out, policy), ...); }, acc.metrics);
+        }
+
+        put(out, static_cast<uint64_t>(intrahour.size()));
+        for (const auto& [node_id, stats] : intrahour) {
+            put(out, static_cast<int32_t>(node_id));
+            put(out, stats);
+        }
+        if (!out.flush()) {
+            throw std::runtime_error("Error writing output file: " + temp);
+        }
+    }
+    std::filesystem::rename(temp, path);
+}
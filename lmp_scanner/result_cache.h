@@ -0,0 +1,39 @@
+#pragma once
+#include "scanner.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Finished per-node aggregates saved across runs (--cache DIR). The key
+// covers the input's identity (size, mtime and a hash of sampled blocks, per
+// file for multi-file inputs),
+// the scanner version and every option that changes aggregation (filters,
+// metric set, fixed-point, 5-minute roll-up). Transaction cost and ranking
+// are applied afterwards, so a run that only changes those loads the
+// aggregates and goes straight to calculate_results().
+//
+// Thread count and group-by are left out: they only reorder floating-point
+// sums.
+
+class ResultCache {
+public:
+    explicit ResultCache(const std::string& dir) : dir_(dir) {}
+
+    // Empty when the input can't be fingerprinted (stdin)
+    static std::string key(const std::vector<std::string>& inputs, const ScanOptions& options);
+
+    // False on a miss, or if the entry is unreadable or from another key
+    bool load(const std::string& key, std::unordered_map<int, NodeAccumulator>& nodes,
+              std::unordered_map<int, IntraHourStats>& intrahour) const;
+
+    // Written to a temporary name and renamed, so concurrent runs never see
+    // a partial entry
+    void store(const std::string& key, const std::unordered_map<int, NodeAccumulator>& nodes,
+               const std::unordered_map<int, IntraHourStats>& intrahour) const;
+
+    // The entry's file name (hash of the key)
+    static std::string entry_name(const std::string& key);
+
+private:
+    std::string dir_;
+};
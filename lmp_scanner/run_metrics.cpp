@@ -0,0 +1,233 @@
+#include "run_metrics.h"
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <sys/resource.h>
+
+namespace {
+
+const auto RUN_START = std::chrono::steady_clock::now();
+
+double cpu_clock(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+thread_local ThreadMetrics current_thread;
+
+// JSON string literal; input paths are the only free text
+std::string quoted(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out + "\"";
+}
+
+double per_second(double amount, double seconds) {
+    return seconds > 0 ? amount / seconds : 0.0;
+}
+
+} // namespace
+
+const char* stage_name(Stage stage) {
+    static const char* const NAMES[NUM_STAGES] = {
+        "read", "parse", "aggregate", "merge", "stats", "output"
+    };
+    return NAMES[stage];
+}
+
+double run_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - RUN_START).count();
+}
+
+double thread_cpu_seconds() { return cpu_clock(CLOCK_THREAD_CPUTIME_ID); }
+double process_cpu_seconds() { return cpu_clock(CLOCK_PROCESS_CPUTIME_ID); }
+
+ThreadMetrics& thread_metrics() { return current_thread; }
+
+ThreadScope::ThreadScope(const char* role) : cpu_start_(thread_cpu_seconds()) {
+    current_thread = ThreadMetrics();
+    current_thread.role = role;
+    current_thread.start = run_seconds();
+}
+
+ThreadScope::~ThreadScope() {
+    current_thread.end = run_seconds();
+    current_thread.cpu = thread_cpu_seconds() - cpu_start_;
+    run_metrics().add_thread(current_thread);
+    current_thread = ThreadMetrics();
+}
+
+void RunMetrics::add_thread(const ThreadMetrics& thread) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back(thread);
+    for (int s = 0; s < NUM_STAGES; s++) stages_[s].merge(thread.stages[s]);
+}
+
+void RunMetrics::add_stage(Stage stage, const StageTime& time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stages_[stage].merge(time);
+}
+
+void RunMetrics::add_queue(const std::string& name, size_t capacity, const DepthHistogram& depths) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& queue : queues_) {
+        if (queue.name == name) {
+            queue.depths.merge(depths);
+            return;
+        }
+    }
+    queues_.push_back({name, capacity, depths});
+}
+
+void RunMetrics::set_input(const std::string& input, const std::string& engine) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    input_ = input;
+    engine_ = engine;
+}
+
+void RunMetrics::add_skipped(long long rows) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    skipped_ += rows;
+}
+
+void RunMetrics::write_json(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    // Readers and the workers they feed see the same bytes; count them once
+    long long lines = 0, rows = 0, bytes = 0, invalid = 0, filtered = 0, skipped = skipped_;
+    for (const auto& t : threads_) {
+        lines += t.lines;
+        rows += t.rows;
+        if (t.role != "reader") bytes += t.bytes;
+        invalid += t.invalid;
+        filtered += t.filtered;
+        skipped += t.skipped;
+    }
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot write output file: " + path);
+    }
+    out << std::fixed << std::setprecision(6);
+    out << "{\n";
+    out << "  \"input\": " << quoted(input_) << ",\n";
+    out << "  \"engine\": " << quoted(engine_) << ",\n";
+    out << "  \"wall_s\": " << run_seconds() << ",\n";
+    out << "  \"cpu_s\": " << process_cpu_seconds() << ",\n";
+    out << "  \"peak_rss_kb\": " << usage.ru_maxrss << ",\n";
+    out << "  \"nodes\": " << nodes_ << ",\n";
+    out << "  \"counters\": {\"lines\": " << lines << ", \"rows\": " << rows
+        << ", \"bytes\": " << bytes << ", \"invalid\": " << invalid
+        << ", \"filtered\": " << filtered << ", \"skipped\": " << skipped << "},\n";
+
+    // A stage's wall time spans the first thread entering it to the last
+    // leaving it; busy is the per-thread sum
+    out << "  \"stages\": {";
+    const char* sep = "\n";
+    for (int s = 0; s < NUM_STAGES; s++) {
+        const StageTime& st = stages_[s];
+        if (st.busy == 0.0 && st.cpu == 0.0) continue;
+        out << sep << "    " << quoted(stage_name(static_cast<Stage>(s)))
+            << ": {\"wall_s\": " << st.last - st.first << ", \"busy_s\": " << st.busy
+            << ", \"cpu_s\": " << st.cpu;
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) {
+            if (!perf_event_available(static_cast<PerfEvent>(e))) continue;
+            out << ", " << quoted(perf_event_name(static_cast<PerfEvent>(e))) << ": " << st.events[e];
+        }
+        out << "}";
+        sep = ",\n";
+    }
+    out << "\n  },\n";
+
+    out << "  \"threads\": [";
+    sep = "\n";
+    for (const auto& t : threads_) {
+        const double wall = t.end - t.start;
+        out << sep << "    {\"role\": " << quoted(t.role) << ", \"wall_s\": " << wall
+            << ", \"cpu_s\": " << t.cpu << ", \"wait_s\": " << t.wait
+            << ", \"rows\": " << t.rows << ", \"bytes\": " << t.bytes
+            << ", \"rows_per_s\": " << per_second(t.rows, wall)
+            << ", \"bytes_per_s\": " << per_second(t.bytes, wall) << "}";
+        sep = ",\n";
+    }
+    out << "\n  ],\n";
+
+    // Histogram entries are [smallest depth in bucket, pops seen at it]
+    out << "  \"queues\": [";
+    sep = "\n";
+    for (const auto& queue : queues_) {
+        out << sep << "    {\"name\": " << quoted(queue.name) << ", \"capacity\": " << queue.capacity
+            << ", \"depth_histogram\": [";
+        const char* bucket_sep = "";
+        for (size_t b = 0; b < DepthHistogram::NUM_BUCKETS; b++) {
+            if (queue.depths.count(b) == 0) continue;
+            out << bucket_sep << "[" << DepthHistogram::bucket_floor(b) << ", " << queue.depths.count(b) << "]";
+            bucket_sep = ", ";
+        }
+        out << "]}";
+        sep = ",\n";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void RunMetrics::write_perf_report(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    long long lines = 0;
+    for (const auto& t : threads_) lines += t.lines;
+    const double per_row = lines > 0 ? 1.0 / lines : 0.0;
+
+    auto ratio = [](uint64_t a, uint64_t b) { return b > 0 ? static_cast<double>(a) / b : 0.0; };
+    auto have = [](PerfEvent e) { return perf_event_available(e); };
+
+    std::ofstream csv(path);
+    if (!csv.is_open()) {
+        throw std::runtime_error("Cannot write output file: " + path);
+    }
+    csv << "stage,cycles,instructions,ipc,cache_misses_per_row,branch_misses_per_row,"
+        << "llc_loads_per_row,cycles_per_row\n";
+    csv << std::fixed << std::setprecision(4);
+
+    const auto flags = std::cout.flags();
+    const auto precision = std::cout.precision();
+    std::cout << std::fixed;
+    std::cout << "\nHardware counters (" << lines << " input rows"
+              << (have(PERF_LLC_LOADS) ? "" : ", no LLC load event") << "):" << std::endl;
+    std::cout << "  " << std::left << std::setw(10) << "stage" << std::right
+              << std::setw(14) << "cycles" << std::setw(14) << "instr" << std::setw(7) << "IPC"
+              << std::setw(12) << "cyc/row" << std::setw(12) << "miss/row"
+              << std::setw(12) << "br-miss/row" << std::setw(12) << "LLC/row" << std::endl;
+    for (int s = 0; s < NUM_STAGES; s++) {
+        const StageTime& st = stages_[s];
+        if (st.busy == 0.0 && st.cpu == 0.0) continue;
+        const auto& ev = st.events;
+        const double ipc = ratio(ev[PERF_INSTRUCTIONS], ev[PERF_CYCLES]);
+        csv << stage_name(static_cast<Stage>(s)) << "," << ev[PERF_CYCLES] << "," << ev[PERF_INSTRUCTIONS]
+            << "," << ipc << "," << ev[PERF_CACHE_MISSES] * per_row << ","
+            << ev[PERF_BRANCH_MISSES] * per_row << "," << ev[PERF_LLC_LOADS] * per_row << ","
+            << ev[PERF_CYCLES] * per_row << "\n";
+        std::cout << "  " << std::left << std::setw(10) << stage_name(static_cast<Stage>(s)) << std::right
+                  << std::setw(14) << ev[PERF_CYCLES] << std::setw(14) << ev[PERF_INSTRUCTIONS]
+                  << std::setw(7) << std::setprecision(2) << ipc
+                  << std::setw(12) << std::setprecision(1) << ev[PERF_CYCLES] * per_row
+                  << std::setw(12) << std::setprecision(3) << ev[PERF_CACHE_MISSES] * per_row
+                  << std::setw(12) << ev[PERF_BRANCH_MISSES] * per_row
+                  << std::setw(12) << ev[PERF_LLC_LOADS] * per_row << std::endl;
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+RunMetrics& run_metrics() {
+    static RunMetrics metrics;
+    return metrics;
+}
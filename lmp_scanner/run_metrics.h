@@ -0,0 +1,166 @@
+#pragma once
+#include "perf_counters.h"
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Run instrumentation: per-stage wall and CPU time, per-thread throughput,
+// row counters, queue depths and peak RSS, written as metrics.json after a
+// scan. Every thread counts into its own thread_local ThreadMetrics, which
+// is folded into the run totals once when the thread finishes, so the hot
+// loops never touch shared state.
+
+enum Stage {
+    STAGE_READ,        // file or store I/O
+    STAGE_PARSE,       // text to columns, filters, derived columns
+    STAGE_AGGREGATE,   // accumulator updates
+    STAGE_MERGE,       // folding per-thread results together
+    STAGE_STATS,       // per-node results and zone summaries
+    STAGE_OUTPUT,      // result files
+    NUM_STAGES
+};
+
+const char* stage_name(Stage stage);
+
+// Seconds since the run started (steady clock), and CPU seconds of the
+// calling thread / the whole process
+double run_seconds();
+double thread_cpu_seconds();
+double process_cpu_seconds();
+
+struct StageTime {
+    double busy = 0.0;   // wall time summed over threads
+    double cpu = 0.0;
+    double first = std::numeric_limits<double>::infinity();   // span across threads
+    double last = 0.0;
+    PerfCounts events{};   // hardware counters, with --perf-counters
+
+    void add(double start, double end, double cpu_seconds) {
+        busy += end - start;
+        cpu += cpu_seconds;
+        if (start < first) first = start;
+        if (end > last) last = end;
+    }
+
+    void merge(const StageTime& other) {
+        busy += other.busy;
+        cpu += other.cpu;
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) events[e] += other.events[e];
+        if (other.first < first) first = other.first;
+        if (other.last > last) last = other.last;
+    }
+};
+
+// Attributes the time (and hardware events) between successive lap()
+// calls to stages
+class StageClock {
+public:
+    StageClock() : wall_(run_seconds()), cpu_(thread_cpu_seconds()), events_(read_perf_counters()) {}
+
+    void lap(StageTime& into) {
+        double wall = run_seconds();
+        double cpu = thread_cpu_seconds();
+        PerfCounts events = read_perf_counters();
+        into.add(wall_, wall, cpu - cpu_);
+        for (int e = 0; e < NUM_PERF_EVENTS; e++) into.events[e] += events[e] - events_[e];
+        wall_ = wall;
+        cpu_ = cpu;
+        events_ = events;
+    }
+
+private:
+    double wall_;
+    double cpu_;
+    PerfCounts events_;
+};
+
+struct ThreadMetrics {
+    std::string role;
+    long long lines = 0;      // input rows examined
+    long long rows = 0;       // rows that reached aggregation
+    long long bytes = 0;      // input bytes read (readers) or consumed
+    long long invalid = 0;    // malformed lines
+    long long filtered = 0;   // rejected by filters
+    long long skipped = 0;    // never examined (pruned blocks)
+    double wait = 0.0;        // blocked on a queue
+    std::array<StageTime, NUM_STAGES> stages{};
+    double start = 0.0;
+    double end = 0.0;
+    double cpu = 0.0;
+};
+
+// The calling thread's counters
+ThreadMetrics& thread_metrics();
+
+// Marks the calling thread as a worker with a role for its lifetime; on
+// destruction its counters go to the run totals and are reset
+class ThreadScope {
+public:
+    explicit ThreadScope(const char* role);
+    ~ThreadScope();
+
+    ThreadScope(const ThreadScope&) = delete;
+    ThreadScope& operator=(const ThreadScope&) = delete;
+
+private:
+    double cpu_start_;
+};
+
+// Occupancy samples: exact depths 0-7, then power-of-two ranges
+class DepthHistogram {
+public:
+    void record(size_t depth) { counts_[bucket(depth)]++; }
+    void merge(const DepthHistogram& other) {
+        for (size_t i = 0; i < counts_.size(); i++) counts_[i] += other.counts_[i];
+    }
+
+    long long count(size_t bucket) const { return counts_[bucket]; }
+    static constexpr size_t NUM_BUCKETS = 69;
+    // Smallest depth in a bucket
+    static uint64_t bucket_floor(size_t b) { return b < 8 ? b : 1ULL << (b - 5); }
+
+private:
+    static size_t bucket(size_t depth) { return depth < 8 ? depth : 4 + std::bit_width(depth); }
+    std::array<long long, NUM_BUCKETS> counts_{};
+};
+
+class RunMetrics {
+public:
+    void add_thread(const ThreadMetrics& thread);
+    void add_stage(Stage stage, const StageTime& time);
+    void add_queue(const std::string& name, size_t capacity, const DepthHistogram& depths);
+    void set_input(const std::string& input, const std::string& engine);
+    void set_nodes(size_t nodes) { nodes_ = nodes; }
+
+    // Rows pruned before any thread saw them
+    void add_skipped(long long rows);
+
+    // Writes the report; peak RSS is read at this point
+    void write_json(const std::string& path) const;
+
+    // Per-stage IPC and events per input row, printed and written as CSV
+    void write_perf_report(const std::string& path) const;
+
+private:
+    struct Queue {
+        std::string name;
+        size_t capacity;
+        DepthHistogram depths;
+    };
+
+    mutable std::mutex mutex_;
+    std::string input_;
+    std::string engine_;
+    size_t nodes_ = 0;
+    long long skipped_ = 0;
+    std::vector<ThreadMetrics> threads_;
+    std::array<StageTime, NUM_STAGES> stages_{};
+    std::vector<Queue> queues_;
+};
+
+// The process-wide run report
+RunMetrics& run_metrics();
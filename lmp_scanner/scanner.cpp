@@ -1,49 +1,147 @@
 #include "scanner.h"
 #include "fast_parser.h"
+#include "block_reader.h"
+#include "column_store.h"
+#include "data_quality.h"
+#include "gzip_index.h"
+#include "batch.h"
+#include "pipeline.h"
+#include "result_cache.h"
+#include "run_metrics.h"
+#include "synthetic.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <stdexcept>
 
-void NodeAccumulator::update(double spread, double cong_spread, double energy_spread,
-                             int hour, const std::string& zone_name, int node_id) {
-    n++;
+namespace {
+
+// Sharpe-style ratio of a Welford series, 0 when the series is flat
+template <typename Series>
+void series_stats(const NodeAccumulator& acc, double& mean, double& std_dev, double& sharpe) {
+    const auto& w = acc.get<Welford<Series>>();
+    mean = w.mean;
+    std_dev = std::sqrt(w.M2 / acc.n);
+    sharpe = std_dev > 0 ? mean / std_dev : 0.0;
+}
+
+} // namespace
+
+NodeResult summarize_node(const NodeAccumulator& acc, double transaction_cost, double count_scale) {
+    const auto& spread = acc.get<Welford<Spread>>();
+    const auto& shape = acc.get<Shape<Spread>>();
+    const auto& hourly = acc.get<Hourly<Spread>>();
+    
+    NodeResult result;
+    result.pnode_id = acc.pnode_id;
+    result.zone = acc.zone.empty() ? "N/A" : acc.zone;
+    result.sample_size = static_cast<int>(std::llround(acc.n * count_scale));
     
-    if (n == 1) {
-        zone = zone_name;
-        pnode_id = node_id;
+    result.mean_spread = spread.mean;
+    result.std_spread = std::sqrt(spread.M2 / acc.n);
+    result.hit_rate = static_cast<double>(shape.positive) / acc.n;
+    result.mean_abs_spread = shape.sum_abs / acc.n;
+    
+    if (result.std_spread > 0) {
+        // Sharpe ratio: mean/std (already per-hour)
+        // Don't annualize - just use raw hourly Sharpe
+        result.sharpe_ratio = result.mean_spread / result.std_spread;
+    } else {
+        result.sharpe_ratio = 0.0;
     }
     
-    // Welford's algorithm for variance
-    double delta = spread - mean_spread;
-    mean_spread += delta / n;
-    double delta2 = spread - mean_spread;
-    M2_spread += delta * delta2;
+    double tradeable_spread = std::max(0.0, std::abs(result.mean_spread) - transaction_cost);
+    result.net_profit_10mw = tradeable_spread * 10.0 * acc.n * count_scale;
     
-    double cong_delta = cong_spread - mean_cong_spread;
-    mean_cong_spread += cong_delta / n;
-    double cong_delta2 = cong_spread - mean_cong_spread;
-    M2_cong_spread += cong_delta * cong_delta2;
+    series_stats<Congestion>(acc, result.congestion_mean, result.congestion_std,
+                             result.congestion_sharpe);
+    series_stats<Energy>(acc, result.energy_mean, result.energy_std, result.energy_sharpe);
+    series_stats<Loss>(acc, result.loss_mean, result.loss_std, result.loss_sharpe);
+    
+    result.best_hour = 0;
+    result.best_hour_avg = 0.0;
+    for (int h = 0; h < 24; h++) {
+        if (hourly.count[h] > 0) {
+            double avg = hourly.mean[h];
+            if (std::abs(avg) > std::abs(result.best_hour_avg)) {
+                result.best_hour = h;
+                result.best_hour_avg = avg;
+            }
+        }
+    }
     
-    double energy_delta = energy_spread - mean_energy_spread;
-    mean_energy_spread += energy_delta / n;
-    double energy_delta2 = energy_spread - mean_energy_spread;
-    M2_energy_spread += energy_delta * energy_delta2;
+    return result;
+}
+
+void HourBucket::add(double spread, double cong_spread, double energy_spread,
+                     double loss_spread) {
+    count++;
+    sum_spread += spread;
+    sum_cong_spread += cong_spread;
+    sum_energy_spread += energy_spread;
+    sum_loss_spread += loss_spread;
     
-    sum_abs_spread += std::abs(spread);
-    if (spread > 0) positive_count++;
+    double delta = spread - mean;
+    mean += delta / count;
+    M2 += delta * (spread - mean);
     
     max_spread = std::max(max_spread, spread);
     min_spread = std::min(min_spread, spread);
-    
-    if (hour >= 0 && hour < 24) {
-        hourly_sum[hour] += spread;
-        hourly_count[hour]++;
+}
+
+void HourBucket::merge(const HourBucket& other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
     }
+    
+    int n_total = count + other.count;
+    double delta = other.mean - mean;
+    mean = (count * mean + other.count * other.mean) / n_total;
+    M2 += other.M2 + delta * delta * count * other.count / n_total;
+    
+    count = n_total;
+    sum_spread += other.sum_spread;
+    sum_cong_spread += other.sum_cong_spread;
+    sum_energy_spread += other.sum_energy_spread;
+    sum_loss_spread += other.sum_loss_spread;
+    max_spread = std::max(max_spread, other.max_spread);
+    min_spread = std::min(min_spread, other.min_spread);
 }
 
-LMPScanner::LMPScanner(const std::string& csv_path, double transaction_cost)
-    : csv_path_(csv_path), transaction_cost_(transaction_cost) {}
+void IntraHourStats::add(const HourBucket& bucket) {
+    double std_dev = std::sqrt(bucket.M2 / bucket.count);
+    double range = bucket.max_spread - bucket.min_spread;
+    
+    hours++;
+    intervals += bucket.count;
+    sum_std += std_dev;
+    max_std = std::max(max_std, std_dev);
+    sum_range += range;
+    max_range = std::max(max_range, range);
+}
+
+void IntraHourStats::merge(const IntraHourStats& other) {
+    hours += other.hours;
+    intervals += other.intervals;
+    sum_std += other.sum_std;
+    max_std = std::max(max_std, other.max_std);
+    sum_range += other.sum_range;
+    max_range = std::max(max_range, other.max_range);
+}
+
+LMPScanner::LMPScanner(std::vector<std::string> inputs, double transaction_cost,
+                       const ScanOptions& options)
+    : inputs_(std::move(inputs)), transaction_cost_(transaction_cost), options_(options),
+      quality_(std::make_unique<DataQuality>()) {
+    if (inputs_.empty()) throw std::runtime_error("No input files given");
+    for (const auto& input : inputs_) input_name_ += (input_name_.empty() ? "" : " ") + input;
+}
 
 int LMPScanner::extract_hour(const std::string& datetime_str) {
     auto space_pos = datetime_str.find(' ');
@@ -61,15 +159,20 @@ int LMPScanner::extract_hour(const std::string& datetime_str) {
 }
 
 CSVRow LMPScanner::parse_line(const std::string& line) {
+    return parse_line(line.c_str(), line.size());
+}
+
+CSVRow LMPScanner::parse_line(const char* line, size_t len) {
     CSVRow row;
     char zone_buf[32];
     
     bool success = CSVRowParser::parse(
-        line.c_str(), line.size(),
+        line, len,
         row.pnode_id, zone_buf, row.spread,
         row.congestion_da, row.congestion_rt,
         row.energy_da, row.energy_rt,
-        row.hour
+        row.loss_da, row.loss_rt,
+        row.hour, row.hour_stamp
     );
     
     if (success) {
@@ -82,178 +185,773 @@ CSVRow LMPScanner::parse_line(const std::string& line) {
     return row;
 }
 
-void LMPScanner::analyze() {
-    std::ifstream file(csv_path_);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open CSV file: " + csv_path_);
+namespace {
+
+const int INTERVALS_PER_HOUR = 12;
+
+// Open partial hours beyond this many trigger eviction of stale ones
+const size_t PARTIAL_HOURS_LIMIT = 1 << 18;
+const int STALE_HOURS = 3;
+
+inline uint64_t hour_key(int pnode_id, int hour_stamp) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(pnode_id)) << 32) |
+           static_cast<uint32_t>(hour_stamp);
+}
+
+inline int key_node(uint64_t key) { return static_cast<int>(key >> 32); }
+inline int key_hour(uint64_t key) { return static_cast<int>(key & 0xffffffffu); }
+
+// Price columns the accumulator's policies consume
+template <typename Acc>
+constexpr bool needs_components = Acc::template has<Welford<Congestion>> ||
+                                  Acc::template has<Welford<Energy>>;
+template <typename Acc>
+constexpr bool needs_loss = Acc::template has<Welford<Loss>>;
+template <typename Acc>
+constexpr bool needs_fixed = Acc::template has<Exact<Spread>>;
+
+// Parse only the price columns the accumulator's policies consume;
+// row.issue tells malformed rows from filtered ones. With `interval`, the
+// datetime must also name a 5-minute interval of the hour.
+template <typename Acc>
+inline bool parse_row(const char* line, size_t len, CSVRow& row, const RowFilter* filter,
+                      int* interval = nullptr) {
+    char zone_buf[32];
+    int64_t fixed[7];
+    row.valid = CSVRowParser::parse<needs_components<Acc>, needs_loss<Acc>, needs_fixed<Acc>>(
+        line, len,
+        row.pnode_id, zone_buf, row.spread,
+        row.congestion_da, row.congestion_rt,
+        row.energy_da, row.energy_rt,
+        row.loss_da, row.loss_rt,
+        row.hour, row.hour_stamp,
+        filter, fixed, &row.issue, interval
+    );
+    if (row.valid) {
+        row.zone = zone_buf;
+        if constexpr (needs_fixed<Acc>) row.spread_fixed = fixed[0];
+    }
+    return row.valid;
+}
+
+inline Sample row_sample(const CSVRow& row) {
+    return Sample{row.spread,
+                  row.congestion_da - row.congestion_rt,
+                  row.energy_da - row.energy_rt,
+                  row.loss_da - row.loss_rt,
+                  row.hour,
+                  row.spread_fixed};
+}
+
+template <typename Acc>
+struct WorkerState {
+    std::unordered_map<int, Acc> nodes;
+    std::unordered_map<uint64_t, HourBucket> open_hours;
+    std::unordered_map<int, IntraHourStats> intrahour;
+    long long lines = 0;
+    long long rows = 0;
+};
+
+// Node-hours whose intervals straddle blocks wait here for the rest
+struct PartialHours {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, HourBucket> buckets;
+    int newest_hour = 0;
+};
+
+template <typename Acc>
+void flush_hour(std::unordered_map<int, Acc>& nodes,
+                std::unordered_map<int, IntraHourStats>& intrahour,
+                uint64_t key, const HourBucket& bucket) {
+    int pnode_id = key_node(key);
+    auto& acc = nodes[pnode_id];
+    Sample sample{bucket.sum_spread / bucket.count,
+                  bucket.sum_cong_spread / bucket.count,
+                  bucket.sum_energy_spread / bucket.count,
+                  bucket.sum_loss_spread / bucket.count,
+                  key_hour(key) % 24};
+    acc.update(sample, acc.zone, pnode_id);
+    intrahour[pnode_id].add(bucket);
+}
+
+// Move a worker's unfinished hours into the shared pool, flushing any that
+// are now complete. Hours still missing intervals long after newer data has
+// arrived are flushed as-is so the pool stays bounded.
+template <typename Acc>
+void hand_over_open_hours(WorkerState<Acc>& state, PartialHours& partial) {
+    if (state.open_hours.empty()) return;
+    
+    std::vector<std::pair<uint64_t, HourBucket>> completed;
+    {
+        std::lock_guard<std::mutex> lock(partial.mutex);
+        for (const auto& [key, bucket] : state.open_hours) {
+            partial.newest_hour = std::max(partial.newest_hour, key_hour(key));
+            auto it = partial.buckets.find(key);
+            if (it == partial.buckets.end()) {
+                partial.buckets.emplace(key, bucket);
+                continue;
+            }
+            it->second.merge(bucket);
+            if (it->second.count >= INTERVALS_PER_HOUR) {
+                completed.emplace_back(key, it->second);
+                partial.buckets.erase(it);
+            }
+        }
+        
+        if (partial.buckets.size() > PARTIAL_HOURS_LIMIT) {
+            for (auto it = partial.buckets.begin(); it != partial.buckets.end();) {
+                if (key_hour(it->first) < partial.newest_hour - STALE_HOURS) {
+                    completed.emplace_back(it->first, it->second);
+                    it = partial.buckets.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+    state.open_hours.clear();
+    
+    for (const auto& [key, bucket] : completed) {
+        flush_hour(state.nodes, state.intrahour, key, bucket);
+    }
+}
+
+// Radix group-by: rows are scattered by hashed node id into one of
+// NUM_PARTITIONS buffers; partition p is owned by thread p % threads
+const int RADIX_BITS = 8;
+const int NUM_PARTITIONS = 1 << RADIX_BITS;
+const size_t PARTITION_BUFFER_ROWS = 256;   // ~12KB, stays in cache while filling
+
+inline uint32_t node_partition(int pnode_id) {
+    return (static_cast<uint32_t>(pnode_id) * 2654435761u) >> (32 - RADIX_BITS);
+}
+
+struct PartitionedRow {
+    int pnode_id;
+    uint16_t zone_id;
+    Sample sample;
+};
+
+struct PartitionBuffer {
+    uint32_t partition = 0;
+    std::vector<PartitionedRow> rows;
+};
+
+// Filled buffers waiting for their owning thread
+class PartitionInbox {
+public:
+    void push(PartitionBuffer&& buffer) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffers_.push_back(std::move(buffer));
+        }
+        ready_.notify_one();
+    }
+    
+    bool try_pop(PartitionBuffer& buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (buffers_.empty()) return false;
+        buffer = std::move(buffers_.front());
+        buffers_.pop_front();
+        return true;
+    }
+    
+    // Blocks until a buffer arrives; false once closed and drained
+    bool pop(PartitionBuffer& buffer) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [&] { return !buffers_.empty() || closed_; });
+        if (buffers_.empty()) return false;
+        buffer = std::move(buffers_.front());
+        buffers_.pop_front();
+        return true;
     }
     
-    std::cout << "Starting analysis of " << csv_path_ << "..." << std::endl;
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+    
+private:
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<PartitionBuffer> buffers_;
+    bool closed_ = false;
+};
+
+// Node accumulators plus, with --regimes or --lead-lag, every node's series
+template <typename Acc>
+struct ScanSink {
+    NodeSink<Acc> nodes;
+    SeriesSink series;
+    BlockSpreadSink blocks;
+    bool keep_series;
+    bool keep_blocks;
+    
+    ScanSink(ZoneDictionary& zones, bool keep_series, bool keep_blocks)
+        : nodes(zones), keep_series(keep_series), keep_blocks(keep_blocks) {}
+    
+    void consume(const RowBatch& b) {
+        nodes.consume(b);
+        if (keep_series) series.consume(b);
+        if (keep_blocks) blocks.consume(b);
+    }
+    
+    void merge(ScanSink& other) {
+        nodes.merge(other.nodes);
+        series.merge(other.series);
+        blocks.merge(other.blocks);
+    }
+};
+
+int scan_threads(const ScanOptions& options) {
+    return options.threads > 0 ? options.threads
+                               : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// Downstream reporting reads the full accumulator; metrics this run didn't
+// compute stay at their defaults
+template <typename Acc>
+void adopt_nodes(std::unordered_map<int, Acc>& merged,
+                 std::unordered_map<int, NodeAccumulator>& node_data) {
+    if constexpr (std::is_same_v<Acc, NodeAccumulator>) {
+        node_data = std::move(merged);
+    } else {
+        node_data.reserve(merged.size());
+        for (const auto& [node_id, acc] : merged) {
+            acc.widen_into(node_data[node_id]);
+        }
+    }
+}
+
+} // namespace
+
+MetricSet parse_metric_set(const std::string& name) {
+    if (name == "full") return MetricSet::Full;
+    if (name == "sharpe") return MetricSet::Sharpe;
+    if (name == "components") return MetricSet::Components;
+    throw std::runtime_error("Unknown metric set: " + name + " (full|sharpe|components)");
+}
+
+GroupBy parse_group_by(const std::string& name) {
+    if (name == "hash") return GroupBy::Hash;
+    if (name == "radix") return GroupBy::Radix;
+    throw std::runtime_error("Unknown group-by: " + name + " (hash|radix)");
+}
+
+void LMPScanner::analyze(bool start_writes) {
+    std::cout << "Starting analysis of " << input_name_ << "..." << std::endl;
     std::cout << "Transaction cost: $" << transaction_cost_ << "/MWh" << std::endl;
+    if (options_.filter.active()) {
+        const auto& f = options_.filter;
+        std::cout << "Filters:";
+        if (f.from_hour != INT_MIN || f.to_hour != INT_MAX) std::cout << " date window";
+        if (!f.zone.empty()) std::cout << " zone=" << f.zone;
+        if (!f.nodes.empty()) std::cout << " nodes=" << f.nodes.size();
+        if (f.hours != RowFilter::ALL_HOURS) std::cout << " hours-of-day";
+        std::cout << std::endl;
+    }
+    if (options_.rt_fivemin) {
+        std::cout << "RT input: 5-minute intervals (rolled up to hourly)" << std::endl;
+    }
+    if (options_.fixed_point) {
+        if (options_.rt_fivemin) {
+            throw std::runtime_error("--fixed-point needs hourly rows; 5-minute roll-ups are averages");
+        }
+        std::cout << "Prices: fixed-point, exact spread mean/variance" << std::endl;
+    }
     
-    // Skip header
-    std::string line;
-    std::getline(file, line);
+    // Each run validates (and looks for duplicates) from a clean slate
+    quality_ = std::make_unique<DataQuality>();
+    quality_->set_strict(options_.strict);
+    if (options_.strict) {
+        std::cout << "Validation: strict (stops at the first invalid line)" << std::endl;
+    }
     
-    node_data_.reserve(15000);
+    if (options_.keeps_series()) {
+        const std::string flag = options_.regimes ? "--regimes" : "--lead-lag";
+        if (options_.rt_fivemin) {
+            throw std::runtime_error(flag + " needs hourly rows; 5-minute input is rolled up out of order");
+        }
+        if (options_.sample > 0) {
+            throw std::runtime_error(flag + " needs every row of each node; it can't run on a --sample");
+        }
+    }
+    if (options_.regimes) {
+        std::cout << "Regimes: CUSUM change points on each node's spread and congestion" << std::endl;
+    }
+    if (options_.lead_lag) {
+        std::cout << "Lead-lag: congestion cross-correlation within "
+                  << (options_.filter.nodes.empty() ? "each zone" : "the --nodes-file set") << ", lags to +/-"
+                  << LeadLagParams{}.max_lag << "h" << std::endl;
+    }
     
-    const int NUM_THREADS = std::thread::hardware_concurrency();
-    std::cout << "Using " << NUM_THREADS << " threads..." << std::endl;
+    if (options_.sample > 0) {
+        if (options_.sample > 1) {
+            throw std::runtime_error("--sample takes a fraction of the input (0-1)");
+        }
+        if (options_.rt_fivemin) {
+            throw std::runtime_error("--sample needs hourly rows; 5-minute intervals are rolled up in order");
+        }
+        std::cout << "Preview: sampling " << 100.0 * options_.sample << "% of the input (seed "
+                  << options_.sample_seed << ")" << std::endl;
+    }
     
-    std::vector<std::thread> threads;
-    std::vector<std::vector<std::string>> line_chunks(NUM_THREADS);
-    std::mutex merge_mutex;
-    std::atomic<int> lines_processed{0};
+    // Saved aggregates stand in for the whole scan; cost and ranking are
+    // applied to them below as usual
+    std::string cache_key;
+    if (!options_.cache_dir.empty() && options_.sample > 0) {
+        std::cout << "Note: --cache does not apply to --sample previews" << std::endl;
+    } else if (!options_.cache_dir.empty() && options_.keeps_series()) {
+        std::cout << "Note: --cache holds aggregates only; per-node series need a rescan" << std::endl;
+    } else if (!options_.cache_dir.empty()) {
+        cache_key = ResultCache::key(inputs_, options_);
+        if (cache_key.empty()) {
+            std::cout << "Note: input can't be fingerprinted; --cache ignored" << std::endl;
+        }
+    }
+    const ResultCache cache(options_.cache_dir);
+    if (!cache_key.empty() && cache.load(cache_key, node_data_, intrahour_data_)) {
+        run_metrics().set_input(input_name_, "cache");
+        std::cout << "Loaded " << node_data_.size() << " node aggregates from cache ("
+                  << ResultCache::entry_name(cache_key) << ")" << std::endl;
+    } else {
+        // Each metric set runs its own precompiled accumulator type
+        switch (options_.metrics) {
+            case MetricSet::Sharpe:
+                std::cout << "Metrics: sharpe (spread mean/std, hit rate)" << std::endl;
+                run_metric_set<SharpeAccumulator>();
+                break;
+            case MetricSet::Components:
+                std::cout << "Metrics: components (spread + congestion/energy/loss)" << std::endl;
+                run_metric_set<ComponentAccumulator>();
+                break;
+            case MetricSet::Full:
+                run_metric_set<NodeAccumulator>();
+                break;
+        }
+        if (!cache_key.empty()) {
+            cache.store(cache_key, node_data_, intrahour_data_);
+            std::cout << "Aggregates cached as " << ResultCache::entry_name(cache_key) << std::endl;
+        }
+    }
     
-    int chunk_idx = 0;
-    const int CHUNK_SIZE = 100000;
+    // A strict run writes only the data-quality report
+    const DataQuality& quality = *quality_;
+    if (options_.strict && quality.issues() > 0) {
+        const std::string report = "../output/" + run_file("data_quality.json");
+        quality.write_json(report);
+        throw std::runtime_error("--strict: invalid input (" + quality.first_issue() + "); see " + report);
+    }
     
-    std::cout << "Reading file..." << std::endl;
-    while (std::getline(file, line)) {
-        line_chunks[chunk_idx % NUM_THREADS].push_back(std::move(line));
-        
-        if (++chunk_idx % (CHUNK_SIZE * NUM_THREADS) == 0) {
-            std::cout << "  Loaded " << chunk_idx / 1000000 << "M rows..." << std::endl;
+    // A preview writes preview_rankings.csv only (see write_results)
+    if (start_writes && sample_fraction_ == 1.0) {
+        if (options_.metrics == MetricSet::Full) start_write(&LMPScanner::write_hourly_patterns);
+        if (options_.rt_fivemin) start_write(&LMPScanner::write_intrahour_volatility);
+    }
+    
+    std::cout << "\nCalculating statistics..." << std::endl;
+    StageClock clock;
+    if (options_.lead_lag) calculate_lead_lag();
+    if (options_.regimes) calculate_regimes();
+    series_.clear();
+    calculate_results();
+    calculate_zone_summaries();
+    StageTime stats_time;
+    clock.lap(stats_time);
+    run_metrics().add_stage(STAGE_STATS, stats_time);
+    
+    std::cout << "Analysis complete!" << std::endl;
+}
+
+template <typename Acc>
+void LMPScanner::run_metric_set() {
+    if (options_.fixed_point) {
+        aggregate<ExactAccumulator<Acc>>();
+    } else {
+        aggregate<Acc>();
+    }
+}
+
+template <typename Acc>
+void LMPScanner::aggregate() {
+    const bool text_input = !is_multi_input(inputs_) && !text_input_path(inputs_.front()).empty();
+    
+    const bool radix = options_.group_by == GroupBy::Radix && text_input && options_.sample == 0 &&
+                       !options_.keeps_series();
+    const char* engine = options_.rt_fivemin ? "fivemin" : radix ? "radix" : "batch";
+    run_metrics().set_input(input_name_, engine);
+    
+    if (options_.rt_fivemin) {
+        if (is_multi_input(inputs_) || GzipIndex::is_gzip(inputs_.front())) {
+            throw std::runtime_error("--rt-fivemin reads a single uncompressed 5-minute CSV");
         }
+        if (!text_input) {
+            throw std::runtime_error("--rt-fivemin needs the 5-minute CSV; stores hold hourly rows");
+        }
+        if (options_.group_by == GroupBy::Radix) {
+            std::cout << "Note: --group-by radix does not apply to --rt-fivemin; using hash" << std::endl;
+        }
+        aggregate_fivemin<Acc>();
+        return;
+    }
+    if (radix) {
+        aggregate_radix<Acc>();
+        return;
+    }
+    if (options_.group_by == GroupBy::Radix && options_.sample > 0) {
+        std::cout << "Note: --group-by radix reads the whole file; sampling with hash" << std::endl;
+    } else if (options_.group_by == GroupBy::Radix && options_.keeps_series()) {
+        std::cout << "Note: per-node series are collected on the batch engine; using hash" << std::endl;
+    } else if (options_.group_by == GroupBy::Radix && (is_multi_input(inputs_) || GzipIndex::is_gzip(inputs_.front()))) {
+        std::cout << "Note: --group-by radix reads a single uncompressed file; using hash" << std::endl;
     }
-    file.close();
+    aggregate_batches<Acc>();
+}
+
+// Hourly input from any source runs through the batch pipeline:
+// scan | filter | project | per-node aggregate
+template <typename Acc>
+void LMPScanner::aggregate_batches() {
+    const int NUM_THREADS = scan_threads(options_);
+    // Regimes and lead-lag read the congestion spread whatever the metric set
+    const BatchColumns columns{needs_components<Acc> || options_.keeps_series(), needs_loss<Acc>,
+                               needs_fixed<Acc>};
+    auto source = open_batch_source(inputs_, options_.filter, columns, NUM_THREADS, *quality_,
+                                    options_.sample, options_.sample_seed, options_.io);
+    std::cout << "Using " << NUM_THREADS << " threads..." << std::endl;
+    
+    Pipeline pipeline(*source);
+    pipeline.filter(options_.filter).project(columns);
     
-    std::cout << "Processing " << chunk_idx << " rows in parallel..." << std::endl;
+    const bool sampled = source->sampled_fraction() < 1.0;
+    ScanSink<Acc> merged(source->zones(), options_.keeps_series(), sampled);
+    long long rows_processed = run_parallel(pipeline, NUM_THREADS, merged, [&]() {
+        return ScanSink<Acc>(source->zones(), options_.keeps_series(), sampled);
+    });
+    
+    adopt_nodes(merged.nodes.nodes, node_data_);
+    series_ = std::move(merged.series.nodes);
+    sample_fraction_ = source->sampled_fraction();
+    sample_blocks_ = std::move(merged.blocks.nodes);
+    
+    std::cout << "\nParsing complete:" << std::endl;
+    std::cout << "  Total rows processed: " << rows_processed << std::endl;
+    if (options_.filter.active()) {
+        std::cout << "  Rows rejected by filters: " << source->rows_scanned() - rows_processed << std::endl;
+    }
+    source->report();
+    std::cout << "  Unique nodes: " << node_data_.size() << std::endl;
+}
+
+// 5-minute RT input: intervals are rolled up into node-hours before they
+// reach the accumulators
+template <typename Acc>
+void LMPScanner::aggregate_fivemin() {
+    const std::string path = text_input_path(inputs_.front());
+    BlockReader reader(path);
+    
+    // Skip header
+    reader.read_header();
+    
+    std::unordered_map<int, Acc> merged;
+    merged.reserve(15000);
+    
+    const int NUM_THREADS = scan_threads(options_);
+    std::cout << "Using " << NUM_THREADS << " threads..." << std::endl;
+    
+    // Blocks in flight are bounded, so memory doesn't grow with file size
+    BoundedQueue<TextBlock> blocks(NUM_THREADS * 2);
+    PartialHours partial;
+    
+    std::vector<std::thread> threads;
+    std::mutex merge_mutex;
+    std::atomic<long long> lines_read{0};
+    std::atomic<long long> lines_processed{0};
+    
+    const RowFilter* filter = options_.filter.active() ? &options_.filter : nullptr;
     
     for (int t = 0; t < NUM_THREADS; t++) {
         threads.emplace_back([&, t]() {
-            std::unordered_map<int, NodeAccumulator> local_data;
-            local_data.reserve(15000);
+            ThreadScope scope("worker");
+            auto& metrics = thread_metrics();
+            StageClock clock;
+            WorkerState<Acc> state;
+            state.nodes.reserve(15000);
             
-            for (const auto& line : line_chunks[t]) {
-                CSVRow row = parse_line(line);
-                if (!row.valid) continue;
-                
-                double cong_spread = row.congestion_da - row.congestion_rt;
-                double energy_spread = row.energy_da - row.energy_rt;
+            TextBlock block;
+            CSVRow row;
+            int interval = 0;
+            long long invalid = 0;
+            DataQuality& quality = *quality_;
+            DataQuality::NodeCache node_intervals;
+            while (blocks.pop(block)) {
+                metrics.bytes += block.text.size();
+                if (quality.stopped()) continue;
+                for_each_line(block.text, [&](const char* line, size_t len) {
+                    state.lines++;
+                    if (!parse_row<Acc>(line, len, row, filter, &interval)) {
+                        if (row.issue == ROW_FILTERED) return;
+                        invalid++;
+                        quality.record(row.issue, path, block.offset + (line - block.text.data()), line, len);
+                        return;
+                    }
+                    // A repeated interval would fill the hour's bucket early
+                    // and split the hour in two
+                    if (quality.duplicate(node_intervals, row.pnode_id, row.hour_stamp, interval)) {
+                        invalid++;
+                        quality.record(ROW_DUPLICATE, path, block.offset + (line - block.text.data()), line, len);
+                        return;
+                    }
+                    state.rows++;
+                    
+                    Sample sample = row_sample(row);
+                    auto& acc = state.nodes[row.pnode_id];
+                    if (acc.zone.empty()) {
+                        acc.zone = row.zone;
+                        acc.pnode_id = row.pnode_id;
+                    }
+                    
+                    uint64_t key = hour_key(row.pnode_id, row.hour_stamp);
+                    auto& bucket = state.open_hours[key];
+                    bucket.add(sample.spread, sample.cong_spread,
+                               sample.energy_spread, sample.loss_spread);
+                    if (bucket.count >= INTERVALS_PER_HOUR) {
+                        flush_hour(state.nodes, state.intrahour, key, bucket);
+                        state.open_hours.erase(key);
+                    }
+                });
                 
-                local_data[row.pnode_id].update(
-                    row.spread, cong_spread, energy_spread,
-                    row.hour, row.zone, row.pnode_id
-                );
+                hand_over_open_hours(state, partial);
             }
+            // Parsing and the hourly roll-up are fused, so the loop counts as parse
+            clock.lap(metrics.stages[STAGE_PARSE]);
+            metrics.stages[STAGE_PARSE].busy -= metrics.wait;
+            metrics.lines += state.lines;
+            metrics.rows += state.rows;
+            metrics.invalid += invalid;
+            metrics.filtered += state.lines - state.rows - invalid;
+            quality.add_checked(state.lines);
             
             // Merge into global
             std::lock_guard<std::mutex> lock(merge_mutex);
-            for (auto& [node_id, local_acc] : local_data) {
-                auto& global_acc = node_data_[node_id];
-                
-                if (global_acc.n == 0) {
-                    global_acc = local_acc;
-                } else {
-                    int n_total = global_acc.n + local_acc.n;
-                    double delta = local_acc.mean_spread - global_acc.mean_spread;
-                    
-                    global_acc.mean_spread = (global_acc.n * global_acc.mean_spread + 
-                                             local_acc.n * local_acc.mean_spread) / n_total;
-                    global_acc.M2_spread += local_acc.M2_spread + 
-                                           delta * delta * global_acc.n * local_acc.n / n_total;
-                    
-                    double cong_delta = local_acc.mean_cong_spread - global_acc.mean_cong_spread;
-                    global_acc.mean_cong_spread = (global_acc.n * global_acc.mean_cong_spread + 
-                                                   local_acc.n * local_acc.mean_cong_spread) / n_total;
-                    global_acc.M2_cong_spread += local_acc.M2_cong_spread + 
-                                                 cong_delta * cong_delta * global_acc.n * local_acc.n / n_total;
-                    
-                    double energy_delta = local_acc.mean_energy_spread - global_acc.mean_energy_spread;
-                    global_acc.mean_energy_spread = (global_acc.n * global_acc.mean_energy_spread + 
-                                                     local_acc.n * local_acc.mean_energy_spread) / n_total;
-                    global_acc.M2_energy_spread += local_acc.M2_energy_spread + 
-                                                   energy_delta * energy_delta * global_acc.n * local_acc.n / n_total;
-                    
-                    global_acc.n = n_total;
-                    global_acc.sum_abs_spread += local_acc.sum_abs_spread;
-                    global_acc.positive_count += local_acc.positive_count;
-                    global_acc.max_spread = std::max(global_acc.max_spread, local_acc.max_spread);
-                    global_acc.min_spread = std::min(global_acc.min_spread, local_acc.min_spread);
-                    
-                    for (int h = 0; h < 24; h++) {
-                        global_acc.hourly_sum[h] += local_acc.hourly_sum[h];
-                        global_acc.hourly_count[h] += local_acc.hourly_count[h];
-                    }
-                }
+            for (auto& [node_id, local_acc] : state.nodes) {
+                merged[node_id].merge(local_acc);
+            }
+            for (auto& [node_id, local_stats] : state.intrahour) {
+                intrahour_data_[node_id].merge(local_stats);
             }
             
-            lines_processed += line_chunks[t].size();
+            clock.lap(metrics.stages[STAGE_MERGE]);
+            lines_read += state.lines;
+            lines_processed += state.rows;
             std::cout << "  Thread " << t << " complete (" 
-                      << line_chunks[t].size() << " rows)" << std::endl;
+                      << state.rows << " rows)" << std::endl;
         });
     }
     
+    std::cout << "Reading file..." << std::endl;
+    {
+        ThreadScope scope("reader");
+        std::string block;
+        size_t next_report = 1ULL << 30;
+        while (reader.next(block)) {
+            blocks.push({std::move(block), reader.offset()});
+            block = std::string();
+            
+            if (reader.bytes_read() >= next_report) {
+                std::cout << "  Read " << (reader.bytes_read() >> 20) << " MB..." << std::endl;
+                next_report += 1ULL << 30;
+            }
+        }
+        blocks.close();
+    }
+    
     for (auto& thread : threads) {
         thread.join();
     }
+    blocks.report_depths("blocks");
+    
+    // Hours that never received all their intervals
+    size_t incomplete_hours = partial.buckets.size();
+    for (const auto& [key, bucket] : partial.buckets) {
+        flush_hour(merged, intrahour_data_, key, bucket);
+    }
+    
+    adopt_nodes(merged, node_data_);
     
     std::cout << "\nParsing complete:" << std::endl;
     std::cout << "  Total rows processed: " << lines_processed << std::endl;
+    if (filter) {
+        std::cout << "  Rows rejected by filters: " << lines_read - lines_processed << std::endl;
+    }
     std::cout << "  Unique nodes: " << node_data_.size() << std::endl;
+    std::cout << "  Incomplete hours (missing intervals): " << incomplete_hours << std::endl;
+}
+
+// Radix-partitioned group-by. Workers parse blocks and scatter rows into
+// per-partition buffers; full buffers go to the partition's owning thread,
+// which aggregates them between its own blocks. Each node lives in exactly
+// one partition map, so there is no final merge and accumulator memory
+// doesn't multiply by thread count.
+template <typename Acc>
+void LMPScanner::aggregate_radix() {
+    const std::string path = text_input_path(inputs_.front());
+    BlockReader reader(path);
+    reader.read_header();
     
-    std::cout << "\nCalculating statistics..." << std::endl;
-    calculate_results();
-    calculate_zone_summaries();
+    const int NUM_THREADS = scan_threads(options_);
+    std::cout << "Using " << NUM_THREADS << " threads, " << NUM_PARTITIONS
+              << " node partitions..." << std::endl;
     
-    std::cout << "Analysis complete!" << std::endl;
+    BoundedQueue<TextBlock> blocks(NUM_THREADS * 2);
+    std::vector<PartitionInbox> inboxes(NUM_THREADS);
+    std::vector<std::unordered_map<int, Acc>> partitions(NUM_PARTITIONS);
+    ZoneDictionary zones;
+    
+    std::atomic<int> producers{NUM_THREADS};
+    std::atomic<long long> lines_read{0};
+    std::atomic<long long> lines_processed{0};
+    const RowFilter* filter = options_.filter.active() ? &options_.filter : nullptr;
+    
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            ThreadScope scope("worker");
+            auto& metrics = thread_metrics();
+            StageClock clock;
+            std::vector<std::vector<PartitionedRow>> outgoing(NUM_PARTITIONS);
+            std::unordered_map<std::string, uint16_t> zone_ids;
+            long long lines = 0;
+            long long rows = 0;
+            long long invalid = 0;
+            
+            auto send = [&](uint32_t p) {
+                inboxes[p % NUM_THREADS].push(PartitionBuffer{p, std::move(outgoing[p])});
+                outgoing[p] = std::vector<PartitionedRow>();
+                outgoing[p].reserve(PARTITION_BUFFER_ROWS);
+            };
+            
+            auto consume = [&](const PartitionBuffer& buffer) {
+                clock.lap(metrics.stages[STAGE_PARSE]);
+                auto& nodes = partitions[buffer.partition];
+                for (const auto& r : buffer.rows) {
+                    auto& acc = nodes[r.pnode_id];
+                    if (acc.n == 0 && acc.zone.empty()) {
+                        acc.zone = zones.name(r.zone_id);
+                    }
+                    acc.update(r.sample, acc.zone, r.pnode_id);
+                }
+                clock.lap(metrics.stages[STAGE_AGGREGATE]);
+            };
+            
+            TextBlock block;
+            CSVRow row;
+            PartitionBuffer incoming;
+            DataQuality& quality = *quality_;
+            DataQuality::NodeCache node_hours;
+            while (blocks.pop(block)) {
+                metrics.bytes += block.text.size();
+                if (quality.stopped()) continue;
+                for_each_line(block.text, [&](const char* line, size_t len) {
+                    lines++;
+                    auto reject = [&](RowIssue issue) {
+                        invalid++;
+                        quality.record(issue, path, block.offset + (line - block.text.data()), line, len);
+                    };
+                    if (!parse_row<Acc>(line, len, row, filter)) {
+                        if (row.issue != ROW_FILTERED) reject(row.issue);
+                        return;
+                    }
+                    if (quality.duplicate(node_hours, row.pnode_id, row.hour_stamp)) {
+                        reject(ROW_DUPLICATE);
+                        return;
+                    }
+                    rows++;
+                    
+                    auto zone = zone_ids.find(row.zone);
+                    if (zone == zone_ids.end()) {
+                        zone = zone_ids.emplace(row.zone, zones.intern(row.zone)).first;
+                    }
+                    
+                    uint32_t p = node_partition(row.pnode_id);
+                    outgoing[p].push_back({row.pnode_id, zone->second, row_sample(row)});
+                    if (outgoing[p].size() >= PARTITION_BUFFER_ROWS) send(p);
+                });
+                
+                // Aggregate whatever other threads have routed here so far
+                while (inboxes[t].try_pop(incoming)) consume(incoming);
+            }
+            
+            for (uint32_t p = 0; p < NUM_PARTITIONS; p++) {
+                if (!outgoing[p].empty()) send(p);
+            }
+            if (--producers == 0) {
+                for (auto& inbox : inboxes) inbox.close();
+            }
+            while (inboxes[t].pop(incoming)) consume(incoming);
+            clock.lap(metrics.stages[STAGE_PARSE]);
+            metrics.stages[STAGE_PARSE].busy -= metrics.wait;
+            metrics.lines += lines;
+            metrics.rows += rows;
+            metrics.invalid += invalid;
+            metrics.filtered += lines - rows - invalid;
+            quality.add_checked(lines);
+            
+            lines_read += lines;
+            lines_processed += rows;
+        });
+    }
+    
+    std::cout << "Reading file..." << std::endl;
+    {
+        ThreadScope scope("reader");
+        std::string block;
+        while (reader.next(block)) {
+            blocks.push({std::move(block), reader.offset()});
+            block = std::string();
+        }
+        blocks.close();
+    }
+    
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    blocks.report_depths("blocks");
+    
+    // Partitions hold disjoint node sets
+    StageClock clock;
+    std::unordered_map<int, Acc> merged;
+    size_t largest = 0;
+    for (auto& nodes : partitions) {
+        largest = std::max(largest, nodes.size());
+        merged.merge(nodes);
+    }
+    StageTime merge_time;
+    clock.lap(merge_time);
+    run_metrics().add_stage(STAGE_MERGE, merge_time);
+    adopt_nodes(merged, node_data_);
+    
+    std::cout << "\nParsing complete:" << std::endl;
+    std::cout << "  Total rows processed: " << lines_processed << std::endl;
+    if (filter) {
+        std::cout << "  Rows rejected by filters: " << lines_read - lines_processed << std::endl;
+    }
+    std::cout << "  Unique nodes: " << node_data_.size()
+              << " (largest partition " << largest << ")" << std::endl;
 }
 
 void LMPScanner::calculate_results() {
     const int MIN_SAMPLE_SIZE = 500;
     
+    // Sampled counts are scaled up to estimates for the whole input
+    const double count_scale = 1.0 / sample_fraction_;
     for (const auto& [node_id, acc] : node_data_) {
-        if (acc.n < MIN_SAMPLE_SIZE) continue;
-        
-        NodeResult result;
-        result.pnode_id = acc.pnode_id;
-        result.zone = acc.zone.empty() ? "N/A" : acc.zone;
-        result.sample_size = acc.n;
-        
-        result.mean_spread = acc.mean_spread;
-        result.std_spread = std::sqrt(acc.M2_spread / acc.n);
-        result.hit_rate = static_cast<double>(acc.positive_count) / acc.n;
-        result.mean_abs_spread = acc.sum_abs_spread / acc.n;
+        if (acc.n * count_scale < MIN_SAMPLE_SIZE) continue;
         
-        if (result.std_spread > 0) {
-            // Sharpe ratio: mean/std (already per-hour)
-            // Don't annualize - just use raw hourly Sharpe
-            result.sharpe_ratio = result.mean_spread / result.std_spread;
-        } else {
-            result.sharpe_ratio = 0.0;
-        }
-        
-        double tradeable_spread = std::max(0.0, std::abs(result.mean_spread) - transaction_cost_);
-        result.net_profit_10mw = tradeable_spread * 10.0 * acc.n;
-        
-        result.congestion_mean = acc.mean_cong_spread;
-        result.congestion_std = std::sqrt(acc.M2_cong_spread / acc.n);
-        if (result.congestion_std > 0) {
-            result.congestion_sharpe = result.congestion_mean / result.congestion_std;
-        } else {
-            result.congestion_sharpe = 0.0;
-        }
-        
-        result.energy_mean = acc.mean_energy_spread;
-        result.energy_std = std::sqrt(acc.M2_energy_spread / acc.n);
-        if (result.energy_std > 0) {
-            result.energy_sharpe = result.energy_mean / result.energy_std;
-        } else {
-            result.energy_sharpe = 0.0;
-        }
-        
-        result.best_hour = 0;
-        result.best_hour_avg = 0.0;
-        for (int h = 0; h < 24; h++) {
-            if (acc.hourly_count[h] > 0) {
-                double avg = acc.hourly_sum[h] / acc.hourly_count[h];
-                if (std::abs(avg) > std::abs(result.best_hour_avg)) {
-                    result.best_hour = h;
-                    result.best_hour_avg = avg;
-                }
-            }
-        }
+        NodeResult result = summarize_node(acc, transaction_cost_, count_scale);
         
         if (std::abs(result.mean_spread) > transaction_cost_) {
             results_.push_back(result);
@@ -267,6 +965,89 @@ void LMPScanner::calculate_results() {
     
     std::cout << "  Profitable nodes (after transaction costs): " 
               << results_.size() << std::endl;
+    
+    // Only the full metric set keeps the hour-of-day grid
+    if (options_.metrics == MetricSet::Full) calculate_hour_strategies();
+}
+
+void LMPScanner::calculate_hour_strategies() {
+    const int MIN_HOUR_SAMPLES = 30;
+    
+    const double count_scale = 1.0 / sample_fraction_;
+    for (const auto& [node_id, acc] : node_data_) {
+        const auto& hourly = acc.get<Hourly<Spread>>();
+        for (int h = 0; h < 24; h++) {
+            const int n = hourly.count[h];
+            if (n * count_scale < MIN_HOUR_SAMPLES) continue;
+            
+            // Trade the hour in the direction of its mean spread
+            const double net_mean = std::abs(hourly.mean[h]) - transaction_cost_;
+            const double std_dev = std::sqrt(hourly.M2[h] / n);
+            if (net_mean <= 0 || std_dev <= 0) continue;
+            
+            HourStrategy s;
+            s.pnode_id = acc.pnode_id;
+            s.zone = acc.zone.empty() ? "N/A" : acc.zone;
+            s.hour = h;
+            s.sample_size = static_cast<int>(std::llround(n * count_scale));
+            s.mean_spread = hourly.mean[h];
+            s.std_spread = std_dev;
+            const double up = static_cast<double>(hourly.positive[h]) / n;
+            s.hit_rate = hourly.mean[h] > 0 ? up : 1.0 - up;
+            s.net_mean = net_mean;
+            s.net_sharpe = net_mean / std_dev;
+            s.net_profit_10mw = net_mean * 10.0 * n * count_scale;
+            hour_results_.push_back(std::move(s));
+        }
+    }
+    
+    std::sort(hour_results_.begin(), hour_results_.end(),
+              [](const HourStrategy& a, const HourStrategy& b) {
+                  return a.net_sharpe > b.net_sharpe;
+              });
+    
+    std::cout << "  Profitable node-hours (after transaction costs): "
+              << hour_results_.size() << std::endl;
+}
+
+void LMPScanner::calculate_regimes() {
+    regimes_ = detect_node_regimes(series_, scan_threads(options_));
+    series_.clear();
+    
+    size_t breaks = 0, recent = 0;
+    for (const auto& [node_id, node] : regimes_) {
+        breaks += node.spread.size() - 1 + node.congestion.size() - 1;
+        recent += node.recent_break;
+    }
+    std::cout << "  Regime changes: " << breaks << " across " << regimes_.size() << " nodes ("
+              << recent << " nodes with one in the last " << RegimeParams{}.recent_hours / 24 << " days)"
+              << std::endl;
+}
+
+void LMPScanner::calculate_lead_lag() {
+    // A --nodes-file selection is one set; otherwise pairs stay within a zone
+    std::vector<std::vector<int>> groups;
+    if (!options_.filter.nodes.empty()) {
+        groups.emplace_back();
+        for (const auto& [node_id, points] : series_) groups.back().push_back(node_id);
+    } else {
+        std::unordered_map<std::string, size_t> zone_group;
+        for (const auto& [node_id, points] : series_) {
+            auto acc = node_data_.find(node_id);
+            const std::string zone = acc == node_data_.end() ? "" : acc->second.zone;
+            auto [it, added] = zone_group.emplace(zone, groups.size());
+            if (added) groups.emplace_back();
+            groups[it->second].push_back(node_id);
+        }
+    }
+    for (auto& group : groups) std::sort(group.begin(), group.end());
+    
+    auto start = std::chrono::steady_clock::now();
+    lead_lag_ = find_lead_lag(series_, groups, scan_threads(options_));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  Lead-lag: " << lead_lag_.pairs << " node pairs cross-correlated in " << std::fixed
+              << std::setprecision(2) << elapsed.count() << "s (FFT length " << lead_lag_.fft_size << ")"
+              << std::defaultfloat << std::endl;
 }
 
 void LMPScanner::calculate_zone_summaries() {
@@ -299,12 +1080,72 @@ void LMPScanner::calculate_zone_summaries() {
               });
 }
 
+void LMPScanner::start_write(std::string (LMPScanner::*writer)()) {
+    pending_writes_.push_back(std::async(std::launch::async, [this, writer]() {
+        ThreadScope scope("writer");
+        StageClock clock;
+        std::string written = (this->*writer)();
+        clock.lap(thread_metrics().stages[STAGE_OUTPUT]);
+        return written;
+    }));
+}
+
+std::string LMPScanner::run_file(const std::string& name) const {
+    return (sample_fraction_ < 1.0 ? "preview_" : "") + name;
+}
+
 void LMPScanner::write_results() {
     std::cout << "\nWriting output files..." << std::endl;
-    write_node_rankings();
-    write_zone_summary();
-    write_component_analysis();
-    write_hourly_patterns();
-    write_summary_report();
+    
+    // A preview's numbers are sampled and scaled, so it leaves the full
+    // run's files alone
+    if (sample_fraction_ < 1.0) {
+        start_write(&LMPScanner::write_preview_rankings);
+    } else {
+        // Every file is independent, so each gets its own writer thread
+        const bool started = !pending_writes_.empty();
+        start_write(&LMPScanner::write_node_rankings);
+        start_write(&LMPScanner::write_zone_summary);
+        if (options_.metrics != MetricSet::Sharpe) {
+            start_write(&LMPScanner::write_component_analysis);
+        }
+        if (!started) {
+            if (options_.metrics == MetricSet::Full) {
+                start_write(&LMPScanner::write_hourly_patterns);
+            }
+            if (options_.rt_fivemin) {
+                start_write(&LMPScanner::write_intrahour_volatility);
+            }
+        }
+        if (options_.metrics == MetricSet::Full) {
+            start_write(&LMPScanner::write_hour_strategies);
+        }
+        if (options_.regimes) {
+            start_write(&LMPScanner::write_regimes);
+        }
+        if (options_.lead_lag) {
+            start_write(&LMPScanner::write_lead_lag);
+        }
+        start_write(&LMPScanner::write_summary_report);
+    }
+    
+    for (auto& write : pending_writes_) {
+        std::cout << "  ✓ " << write.get() << std::endl;
+    }
+    pending_writes_.clear();
+    
+    run_metrics().set_nodes(node_data_.size());
+    run_metrics().write_json("../output/" + run_file("metrics.json"));
+    std::cout << "  ✓ " << run_file("metrics.json") << std::endl;
+    quality_->write_json("../output/" + run_file("data_quality.json"));
+    std::cout << "  ✓ " << run_file("data_quality.json");
+    if (quality_->issues() > 0) {
+        std::cout << " (" << quality_->issues() << " lines skipped as invalid or duplicate)";
+    }
+    std::cout << std::endl;
+    if (perf_counters_enabled()) {
+        run_metrics().write_perf_report("../output/" + run_file("perf_counters.csv"));
+        std::cout << "  ✓ " << run_file("perf_counters.csv") << std::endl;
+    }
     std::cout << "All output files written successfully!" << std::endl;
 }
\ No newline at end of file
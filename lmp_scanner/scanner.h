@@ -1,5 +1,10 @@
 #pragma once
 
+#include "data_quality.h"
+#include "lead_lag.h"
+#include "pipeline.h"
+#include "regimes.h"
+#include "uring.h"
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -9,31 +14,57 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <future>
+#include <memory>
+#include "accumulator.h"
+#include "fast_parser.h"
 
-struct NodeAccumulator {
-    int n = 0;
-    double mean_spread = 0.0;
-    double M2_spread = 0.0;
-    
-    double sum_abs_spread = 0.0;
-    int positive_count = 0;
+const char* const SCANNER_VERSION = "1.0";
+
+// Every metric the reports use
+using NodeAccumulator = Accumulator<
+    Welford<Spread>, Shape<Spread>, Hourly<Spread>,
+    Welford<Congestion>, Welford<Energy>, Welford<Loss>>;
+
+// Spread ranking only (Sharpe, hit rate, abs mean, range)
+using SharpeAccumulator = Accumulator<Welford<Spread>, Shape<Spread>>;
+
+// Spread ranking plus the congestion/energy/loss decomposition
+using ComponentAccumulator = Accumulator<
+    Welford<Spread>, Shape<Spread>,
+    Welford<Congestion>, Welford<Energy>, Welford<Loss>>;
+
+// One node-hour being rolled up from 5-minute RT intervals. DA prices are
+// constant within the hour, so averaging the per-interval spreads gives the
+// spread against the hourly RT average.
+struct HourBucket {
+    int count = 0;
+    double sum_spread = 0.0;
+    double sum_cong_spread = 0.0;
+    double sum_energy_spread = 0.0;
+    double sum_loss_spread = 0.0;
     
+    // Intra-hour spread dispersion (Welford over the intervals)
+    double mean = 0.0;
+    double M2 = 0.0;
     double max_spread = -1e9;
     double min_spread = 1e9;
     
-    double mean_cong_spread = 0.0;
-    double M2_cong_spread = 0.0;
-    double mean_energy_spread = 0.0;
-    double M2_energy_spread = 0.0;
-    
-    std::array<double, 24> hourly_sum{};
-    std::array<int, 24> hourly_count{};
-    
-    std::string zone;
-    int pnode_id = 0;
+    void add(double spread, double cong_spread, double energy_spread, double loss_spread);
+    void merge(const HourBucket& other);
+};
+
+// Per-node summary of intra-hour RT volatility across rolled-up hours
+struct IntraHourStats {
+    int hours = 0;
+    long long intervals = 0;
+    double sum_std = 0.0;
+    double max_std = 0.0;
+    double sum_range = 0.0;
+    double max_range = 0.0;
     
-    void update(double spread, double cong_spread, double energy_spread, 
-                int hour, const std::string& zone_name, int node_id);
+    void add(const HourBucket& bucket);
+    void merge(const IntraHourStats& other);
 };
 
 struct NodeResult {
@@ -53,12 +84,35 @@ struct NodeResult {
     double energy_mean;
     double energy_std;
     double energy_sharpe;
+    double loss_mean;
+    double loss_std;
+    double loss_sharpe;
     int best_hour;
     double best_hour_avg;
     
     double net_profit_10mw;
 };
 
+// One node traded in a single hour of the day, in the direction of that
+// hour's mean spread
+struct HourStrategy {
+    int pnode_id;
+    std::string zone;
+    int hour;
+    int sample_size;
+    
+    double mean_spread;
+    double std_spread;
+    double hit_rate;          // share of rows on the side of the mean
+    double net_mean;          // |mean| - transaction cost
+    double net_sharpe;        // net_mean / std
+    double net_profit_10mw;
+};
+
+// Derive per-node statistics from an accumulator at the given cost.
+// count_scale turns sampled row counts into estimates for the whole input.
+NodeResult summarize_node(const NodeAccumulator& acc, double transaction_cost, double count_scale = 1.0);
+
 struct ZoneSummary {
     std::string zone;
     double avg_sharpe;
@@ -67,41 +121,153 @@ struct ZoneSummary {
 };
 
 struct CSVRow {
-    int pnode_id;
+    int pnode_id = 0;
     std::string zone;
-    double spread;
-    double congestion_da;
-    double congestion_rt;
-    double energy_da;
-    double energy_rt;
-    int hour;
+    double spread = 0.0;
+    double congestion_da = 0.0;
+    double congestion_rt = 0.0;
+    double energy_da = 0.0;
+    double energy_rt = 0.0;
+    double loss_da = 0.0;
+    double loss_rt = 0.0;
+    int64_t spread_fixed = 0;   // set when parsing fixed-point
+    int hour = 0;
+    int hour_stamp = -1;   // hours since epoch, -1 if the datetime didn't parse
     
     bool valid = false;
+    RowIssue issue = ROW_OK;   // why the line was rejected
+};
+
+// Which accumulator specialization a run aggregates with
+enum class MetricSet {
+    Full,        // NodeAccumulator
+    Sharpe,      // SharpeAccumulator
+    Components   // ComponentAccumulator
+};
+
+MetricSet parse_metric_set(const std::string& name);
+
+// How parsed rows reach their node's accumulator
+enum class GroupBy {
+    Hash,   // every thread keeps its own map of all nodes, merged at the end
+    Radix   // rows are partitioned by node so each node has one owning thread
+};
+
+GroupBy parse_group_by(const std::string& name);
+
+struct ScanOptions {
+    // Input rows are 5-minute RT intervals; roll them up to hourly spreads
+    bool rt_fivemin = false;
+    
+    // Worker threads (0 = hardware concurrency)
+    int threads = 0;
+    
+    MetricSet metrics = MetricSet::Full;
+    GroupBy group_by = GroupBy::Hash;
+    
+    // Parse spreads as fixed-point integers and compute their mean and
+    // variance exactly (Exact<Spread> in place of Welford<Spread>)
+    bool fixed_point = false;
+    
+    // Date/zone/node predicates evaluated inside the parser
+    RowFilter filter;
+    
+    // Directory of saved aggregates to reuse across runs ("" = no cache)
+    std::string cache_dir;
+    
+    // Preview from this share of the input's blocks (0 = read everything)
+    double sample = 0.0;
+    uint64_t sample_seed = 1;
+    
+    // How a single uncompressed CSV file is read
+    IoMode io = IoMode::Uring;
+    
+    // Abort on the first line that fails validation instead of skipping it
+    bool strict = false;
+    
+    // Keep every node's series and detect spread/congestion regime changes
+    bool regimes = false;
+    
+    // Keep every node's series and cross-correlate congestion between pairs
+    bool lead_lag = false;
+    
+    bool keeps_series() const { return regimes || lead_lag; }
 };
 
 class LMPScanner {
 public:
-    LMPScanner(const std::string& csv_path, double transaction_cost = 0.75);
+    // Several inputs are scanned as one dataset (see is_multi_input)
+    LMPScanner(std::vector<std::string> inputs, double transaction_cost = 0.75,
+               const ScanOptions& options = {});
     
-    void analyze();
+    // With start_writes, files that only need the node aggregates are
+    // written while the results are still being ranked; write_results()
+    // then completes them
+    void analyze(bool start_writes = false);
     void write_results();
     
+    const std::unordered_map<int, NodeAccumulator>& node_data() const { return node_data_; }
+    
+    // Line validation of the last analyze() (empty for cached or store runs)
+    const DataQuality& data_quality() const { return *quality_; }
+    
 private:
-    std::string csv_path_;
+    // lmp_bench times the stages below one at a time
+    friend class ScannerBench;
+    
+    std::vector<std::string> inputs_;
+    std::string input_name_;   // inputs_ joined by spaces, for messages and metrics.json
     double transaction_cost_;
+    ScanOptions options_;
     
+    std::unique_ptr<DataQuality> quality_;
     std::unordered_map<int, NodeAccumulator> node_data_;
+    std::unordered_map<int, IntraHourStats> intrahour_data_;
     std::vector<NodeResult> results_;
+    std::vector<HourStrategy> hour_results_;   // ranked by net_sharpe
+    std::unordered_map<int, std::vector<SeriesPoint>> series_;   // --regimes/--lead-lag, until analyzed
+    std::unordered_map<int, NodeRegimes> regimes_;
+    LeadLagResult lead_lag_;
     std::vector<ZoneSummary> zone_summaries_;
+    double sample_fraction_ = 1.0;   // share of rows read (--sample)
+    std::unordered_map<int, BlockSpread> sample_blocks_;   // --sample
+    
+    template <typename Acc>
+    void run_metric_set();
+    template <typename Acc>
+    void aggregate();
+    template <typename Acc>
+    void aggregate_batches();
+    template <typename Acc>
+    void aggregate_fivemin();
+    template <typename Acc>
+    void aggregate_radix();
     
     CSVRow parse_line(const std::string& line);
+    CSVRow parse_line(const char* line, size_t len);
     int extract_hour(const std::string& datetime_str);
     void calculate_results();
+    void calculate_hour_strategies();
+    void calculate_regimes();
+    void calculate_lead_lag();
     void calculate_zone_summaries();
     
-    void write_node_rankings();
-    void write_zone_summary();
-    void write_component_analysis();
-    void write_hourly_patterns();
-    void write_summary_report();
+    // Writers run on their own threads and return their log line
+    std::vector<std::future<std::string>> pending_writes_;
+    void start_write(std::string (LMPScanner::*writer)());
+    
+    std::string write_node_rankings();
+    std::string write_zone_summary();
+    std::string write_component_analysis();
+    std::string write_hourly_patterns();
+    std::string write_hour_strategies();
+    std::string write_regimes();
+    std::string write_lead_lag();
+    std::string write_intrahour_volatility();
+    std::string write_summary_report();
+    std::string write_preview_rankings();
+    
+    // A run file's name; preview_<name> for a --sample run, so the full
+    // run's copy is left alone
+    std::string run_file(const std::string& name) const;
 };
\ No newline at end of file
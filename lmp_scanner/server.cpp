@@ -0,0 +1,522 @@
+#include "server.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+const int MIN_SAMPLE_SIZE = 500;
+
+const char* metric_name(RankMetric metric) {
+    switch (metric) {
+        case RankMetric::Sharpe:     return "sharpe";
+        case RankMetric::Mean:       return "mean";
+        case RankMetric::AbsMean:    return "abs";
+        case RankMetric::Congestion: return "congestion";
+        case RankMetric::Energy:     return "energy";
+        case RankMetric::HitRate:    return "hit";
+        case RankMetric::Profit:     return "profit";
+        default:                     return "?";
+    }
+}
+
+bool parse_metric(const std::string& name, RankMetric& metric) {
+    for (size_t m = 0; m < static_cast<size_t>(RankMetric::Count); m++) {
+        if (name == metric_name(static_cast<RankMetric>(m))) {
+            metric = static_cast<RankMetric>(m);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sort key for a metric; profit uses the zero-cost value (|mean| * n)
+double metric_value(const NodeResult& r, RankMetric metric) {
+    switch (metric) {
+        case RankMetric::Sharpe:     return r.sharpe_ratio;
+        case RankMetric::Mean:       return r.mean_spread;
+        case RankMetric::AbsMean:    return std::abs(r.mean_spread);
+        case RankMetric::Congestion: return r.congestion_sharpe;
+        case RankMetric::Energy:     return r.energy_sharpe;
+        case RankMetric::HitRate:    return r.hit_rate;
+        case RankMetric::Profit:     return r.net_profit_10mw;
+        default:                     return 0.0;
+    }
+}
+
+void write_result_header(std::ostringstream& out) {
+    out << "pnode_id,zone,mean_spread,std_spread,sharpe_ratio,hit_rate,"
+        << "sample_size,mean_abs_spread,net_profit_10mw,congestion_sharpe,"
+        << "energy_sharpe,best_hour,best_hour_avg\n";
+}
+
+void write_result_row(std::ostringstream& out, const NodeResult& r) {
+    out << r.pnode_id << ","
+        << r.zone << ","
+        << r.mean_spread << ","
+        << r.std_spread << ","
+        << r.sharpe_ratio << ","
+        << r.hit_rate << ","
+        << r.sample_size << ","
+        << r.mean_abs_spread << ","
+        << r.net_profit_10mw << ","
+        << r.congestion_sharpe << ","
+        << r.energy_sharpe << ","
+        << r.best_hour << ","
+        << r.best_hour_avg << "\n";
+}
+
+bool write_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::write(fd, data.data() + sent, data.size() - sent);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+} // namespace
+
+QueryServer::QueryServer(const std::string& socket_path, double transaction_cost)
+    : socket_path_(socket_path), transaction_cost_(transaction_cost) {
+    snapshot_.store(build_snapshot({}, 0, 0, {}));
+}
+
+QueryServer::~QueryServer() {
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        ::unlink(socket_path_.c_str());
+    }
+}
+
+std::shared_ptr<const Snapshot> QueryServer::build_snapshot(
+        std::unordered_map<int, NodeAccumulator> nodes,
+        uint64_t version, long long total_rows,
+        std::vector<std::string> sources) {
+    auto snap = std::make_shared<Snapshot>();
+    snap->nodes = std::move(nodes);
+    snap->version = version;
+    snap->total_rows = total_rows;
+    snap->sources = std::move(sources);
+
+    snap->results.reserve(snap->nodes.size());
+    for (const auto& [node_id, acc] : snap->nodes) {
+        if (acc.n < MIN_SAMPLE_SIZE) continue;
+        snap->results.push_back(summarize_node(acc, 0.0));
+    }
+
+    for (size_t m = 0; m < snap->order.size(); m++) {
+        auto metric = static_cast<RankMetric>(m);
+        auto& order = snap->order[m];
+        order.resize(snap->results.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return metric_value(snap->results[a], metric) >
+                   metric_value(snap->results[b], metric);
+        });
+    }
+
+    return snap;
+}
+
+void QueryServer::allow_reloads_from(const std::string& dir) {
+    reload_dir_ = dir.empty() ? "" : std::filesystem::weakly_canonical(dir).string();
+}
+
+std::string QueryServer::load(const std::string& csv_path) {
+    const std::string source = std::filesystem::weakly_canonical(csv_path).string();
+    auto already_loaded = [&](const Snapshot& snap) {
+        return std::find(snap.sources.begin(), snap.sources.end(), source) != snap.sources.end();
+    };
+    if (already_loaded(*snapshot_.load())) {
+        throw std::runtime_error("already loaded: " + source);
+    }
+
+    // Aggregate outside the lock; only the overlap check and merge-and-swap
+    // are serialized
+    LMPScanner incremental({csv_path}, transaction_cost_);
+    incremental.analyze();
+    const DataQuality& quality = incremental.data_quality();
+
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    auto current = snapshot_.load();
+    if (already_loaded(*current)) {
+        throw std::runtime_error("already loaded: " + source);
+    }
+    const long long overlap = loaded_hours_.overlap(quality);
+    if (overlap > 0) {
+        throw std::runtime_error(source + " repeats " + std::to_string(overlap) +
+                                 " node-hours already loaded; nothing merged");
+    }
+    loaded_hours_.absorb(quality);
+
+    auto nodes = current->nodes;
+    long long added = 0;
+    for (const auto& [node_id, acc] : incremental.node_data()) {
+        nodes[node_id].merge(acc);
+        added += acc.n;
+    }
+
+    auto sources = current->sources;
+    sources.push_back(source);
+
+    snapshot_.store(build_snapshot(std::move(nodes), current->version + 1,
+                                   current->total_rows + added, std::move(sources)));
+
+    std::cout << "Snapshot v" << current->version + 1 << " published ("
+              << added << " new rows, " << quality.issues() << " lines skipped)" << std::endl;
+
+    std::ostringstream report;
+    report << "rows_added," << added << "\n"
+           << "lines_skipped," << quality.issues() << "\n"
+           << "duplicate_lines," << quality.count(ROW_DUPLICATE) << "\n";
+    return report.str();
+}
+
+std::string QueryServer::query_top(const Snapshot& snap, int k, RankMetric metric,
+                                   double cost) const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4);
+    write_result_header(out);
+
+    if (metric == RankMetric::Profit && cost > 0) {
+        // Net profit ordering depends on cost; rank only the survivors
+        std::vector<NodeResult> ranked;
+        for (const auto& r : snap.results) {
+            if (std::abs(r.mean_spread) > cost) {
+                ranked.push_back(summarize_node(snap.nodes.at(r.pnode_id), cost));
+            }
+        }
+        size_t limit = std::min<size_t>(k, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + limit, ranked.end(),
+                          [](const NodeResult& a, const NodeResult& b) {
+                              return a.net_profit_10mw > b.net_profit_10mw;
+                          });
+        for (size_t i = 0; i < limit; i++) write_result_row(out, ranked[i]);
+        return out.str();
+    }
+
+    int emitted = 0;
+    for (uint32_t idx : snap.order[static_cast<size_t>(metric)]) {
+        if (emitted >= k) break;
+        const auto& r = snap.results[idx];
+        if (std::abs(r.mean_spread) <= cost) continue;
+        write_result_row(out, summarize_node(snap.nodes.at(r.pnode_id), cost));
+        emitted++;
+    }
+    return out.str();
+}
+
+std::string QueryServer::query_node(const Snapshot& snap, int pnode_id, double cost) const {
+    auto it = snap.nodes.find(pnode_id);
+    if (it == snap.nodes.end()) {
+        return "ERR unknown node " + std::to_string(pnode_id) + "\n";
+    }
+    const auto& acc = it->second;
+    NodeResult r = summarize_node(acc, cost);
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4);
+    out << "pnode_id," << r.pnode_id << "\n"
+        << "zone," << r.zone << "\n"
+        << "sample_size," << r.sample_size << "\n"
+        << "mean_spread," << r.mean_spread << "\n"
+        << "std_spread," << r.std_spread << "\n"
+        << "sharpe_ratio," << r.sharpe_ratio << "\n"
+        << "hit_rate," << r.hit_rate << "\n"
+        << "mean_abs_spread," << r.mean_abs_spread << "\n"
+        << "min_spread," << acc.get<Shape<Spread>>().min << "\n"
+        << "max_spread," << acc.get<Shape<Spread>>().max << "\n"
+        << "congestion_mean," << r.congestion_mean << "\n"
+        << "congestion_std," << r.congestion_std << "\n"
+        << "congestion_sharpe," << r.congestion_sharpe << "\n"
+        << "energy_mean," << r.energy_mean << "\n"
+        << "energy_std," << r.energy_std << "\n"
+        << "energy_sharpe," << r.energy_sharpe << "\n"
+        << "loss_mean," << r.loss_mean << "\n"
+        << "loss_std," << r.loss_std << "\n"
+        << "loss_sharpe," << r.loss_sharpe << "\n"
+        << "best_hour," << r.best_hour << "\n"
+        << "best_hour_avg," << r.best_hour_avg << "\n"
+        << "net_profit_10mw," << r.net_profit_10mw << "\n"
+        << "profitable," << (std::abs(r.mean_spread) > cost ? 1 : 0) << "\n";
+    return out.str();
+}
+
+std::string QueryServer::query_zones(const Snapshot& snap, double cost) const {
+    struct Rollup {
+        double sharpe_sum = 0.0;
+        int nodes = 0;
+        long long samples = 0;
+        double profit = 0.0;
+    };
+    std::unordered_map<std::string, Rollup> zones;
+
+    for (const auto& r : snap.results) {
+        if (std::abs(r.mean_spread) <= cost) continue;
+        auto& z = zones[r.zone];
+        z.sharpe_sum += r.sharpe_ratio;
+        z.nodes++;
+        z.samples += r.sample_size;
+        z.profit += (std::abs(r.mean_spread) - cost) * 10.0 * r.sample_size;
+    }
+
+    std::vector<std::pair<std::string, Rollup>> sorted(zones.begin(), zones.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second.sharpe_sum / a.second.nodes > b.second.sharpe_sum / b.second.nodes;
+    });
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4);
+    out << "zone,avg_sharpe,num_profitable_nodes,total_samples,net_profit_10mw\n";
+    for (const auto& [zone, z] : sorted) {
+        out << zone << ","
+            << z.sharpe_sum / z.nodes << ","
+            << z.nodes << ","
+            << z.samples << ","
+            << z.profit << "\n";
+    }
+    return out.str();
+}
+
+std::string QueryServer::query_filter(const Snapshot& snap, double cost) const {
+    int profitable = 0;
+    double total_profit = 0.0;
+    double sharpe_sum = 0.0;
+
+    for (const auto& r : snap.results) {
+        if (std::abs(r.mean_spread) <= cost) continue;
+        profitable++;
+        sharpe_sum += r.sharpe_ratio;
+        total_profit += (std::abs(r.mean_spread) - cost) * 10.0 * r.sample_size;
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4);
+    out << "transaction_cost," << cost << "\n"
+        << "eligible_nodes," << snap.results.size() << "\n"
+        << "profitable_nodes," << profitable << "\n"
+        << "avg_sharpe," << (profitable > 0 ? sharpe_sum / profitable : 0.0) << "\n"
+        << "net_profit_10mw," << total_profit << "\n";
+    return out.str();
+}
+
+std::string QueryServer::query_hourly(const Snapshot& snap, int pnode_id) const {
+    std::array<double, 24> sums{};
+    std::array<long long, 24> counts{};
+
+    if (pnode_id >= 0) {
+        auto it = snap.nodes.find(pnode_id);
+        if (it == snap.nodes.end()) {
+            return "ERR unknown node " + std::to_string(pnode_id) + "\n";
+        }
+        const auto& hourly = it->second.get<Hourly<Spread>>();
+        for (int h = 0; h < 24; h++) {
+            sums[h] = hourly.sum(h);
+            counts[h] = hourly.count[h];
+        }
+    } else {
+        for (const auto& [_, acc] : snap.nodes) {
+            const auto& hourly = acc.get<Hourly<Spread>>();
+            for (int h = 0; h < 24; h++) {
+                sums[h] += hourly.sum(h);
+                counts[h] += hourly.count[h];
+            }
+        }
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4);
+    out << "hour,avg_spread,num_observations\n";
+    for (int h = 0; h < 24; h++) {
+        double avg = counts[h] > 0 ? sums[h] / counts[h] : 0.0;
+        out << h << "," << avg << "," << counts[h] << "\n";
+    }
+    return out.str();
+}
+
+std::string QueryServer::query_status(const Snapshot& snap) const {
+    std::ostringstream out;
+    out << "version," << snap.version << "\n"
+        << "nodes," << snap.nodes.size() << "\n"
+        << "ranked_nodes," << snap.results.size() << "\n"
+        << "total_rows," << snap.total_rows << "\n"
+        << "queries_served," << queries_served_.load() << "\n";
+    for (const auto& source : snap.sources) {
+        out << "source," << source << "\n";
+    }
+    return out.str();
+}
+
+std::string QueryServer::handle(const std::string& request) {
+    std::istringstream in(request);
+    std::string command;
+    in >> command;
+    std::transform(command.begin(), command.end(), command.begin(), ::toupper);
+
+    queries_served_++;
+
+    try {
+        if (command == "RELOAD") {
+            std::string path;
+            if (!(in >> path)) return "ERR usage: RELOAD <csv_path>\n";
+            // Clients may only point the server at files it was set up to read
+            const std::string resolved = std::filesystem::weakly_canonical(path).string();
+            if (reload_dir_.empty() || resolved.rfind(reload_dir_ + "/", 0) != 0) {
+                return "ERR RELOAD only reads files under " +
+                       (reload_dir_.empty() ? std::string("(disabled)") : reload_dir_) + "\n";
+            }
+            const std::string loaded = load(resolved);
+            return loaded + query_status(*snapshot_.load());
+        }
+
+        // Pin the current snapshot for the whole query
+        std::shared_ptr<const Snapshot> snap = snapshot_.load();
+
+        if (command == "TOP") {
+            // Each argument is optional: [k] [metric] [cost]
+            int k = 20;
+            std::string metric_str = "sharpe";
+            double cost = transaction_cost_;
+            std::vector<std::string> args;
+            for (std::string token; in >> token;) args.push_back(token);
+            auto number = [](const std::string& token, double& value) {
+                char* end = nullptr;
+                value = std::strtod(token.c_str(), &end);
+                return !token.empty() && *end == '\0';
+            };
+            const std::string usage = "ERR usage: TOP [k] [metric] [cost]\n";
+            size_t a = 0;
+            double value;
+            if (a < args.size() && number(args[a], value)) {
+                // k must be a whole number an int holds before it is cast
+                if (!is_finite(value) || value < 0 || value > INT_MAX || value != std::floor(value)) {
+                    return usage;
+                }
+                k = static_cast<int>(value);
+                a++;
+            }
+            if (a < args.size() && !number(args[a], value)) metric_str = args[a++];
+            if (a < args.size() && number(args[a], value)) {
+                if (!is_finite(value)) return usage;
+                cost = value;
+                a++;
+            }
+            if (a < args.size()) return usage;
+            RankMetric metric;
+            if (!parse_metric(metric_str, metric)) {
+                return "ERR unknown metric " + metric_str + "\n";
+            }
+            return query_top(*snap, k, metric, cost);
+        }
+        if (command == "NODE") {
+            int pnode_id;
+            double cost = transaction_cost_;
+            if (!(in >> pnode_id)) return "ERR usage: NODE <pnode_id> [cost]\n";
+            in >> cost;
+            return query_node(*snap, pnode_id, cost);
+        }
+        if (command == "ZONES") {
+            double cost = transaction_cost_;
+            in >> cost;
+            return query_zones(*snap, cost);
+        }
+        if (command == "FILTER") {
+            double cost;
+            if (!(in >> cost)) return "ERR usage: FILTER <cost>\n";
+            return query_filter(*snap, cost);
+        }
+        if (command == "HOURLY") {
+            int pnode_id = -1;
+            in >> pnode_id;
+            return query_hourly(*snap, pnode_id);
+        }
+        if (command == "STATUS") {
+            return query_status(*snap);
+        }
+        return "ERR unknown command " + command + "\n";
+    } catch (const std::exception& e) {
+        return std::string("ERR ") + e.what() + "\n";
+    }
+}
+
+void QueryServer::serve_client(int fd) {
+    std::string pending;
+    char buf[4096];
+
+    while (true) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        pending.append(buf, n);
+
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line == "QUIT" || line == "quit") {
+                ::close(fd);
+                return;
+            }
+            if (!write_all(fd, handle(line) + "END\n")) {
+                ::close(fd);
+                return;
+            }
+        }
+    }
+    ::close(fd);
+}
+
+void QueryServer::run() {
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Cannot create socket: " + std::string(strerror(errno)));
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socket_path_.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + socket_path_);
+    }
+    std::strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+    ::unlink(socket_path_.c_str());
+
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd_, 64) < 0) {
+        throw std::runtime_error("Cannot listen on " + socket_path_ + ": " + strerror(errno));
+    }
+
+    std::cout << "Serving queries on " << socket_path_ << std::endl;
+    std::cout << "  Commands: TOP [k] [metric] [cost], NODE <id> [cost], ZONES [cost],"
+              << " FILTER <cost>, HOURLY [id], RELOAD <csv>, STATUS, QUIT" << std::endl;
+    if (!reload_dir_.empty()) {
+        std::cout << "  RELOAD reads files under " << reload_dir_ << " only" << std::endl;
+    }
+
+    while (true) {
+        int client = ::accept(listen_fd_, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("accept failed: " + std::string(strerror(errno)));
+        }
+        std::thread(&QueryServer::serve_client, this, client).detach();
+    }
+}
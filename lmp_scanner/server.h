@@ -0,0 +1,86 @@
+#pragma once
+
+#include "scanner.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Metrics that TOP queries can rank by
+enum class RankMetric {
+    Sharpe,
+    Mean,
+    AbsMean,
+    Congestion,
+    Energy,
+    HitRate,
+    Profit,
+    Count
+};
+
+// Immutable view of the accumulator state. Readers hold a shared_ptr for the
+// duration of one query; reloads build a fresh snapshot and swap it in, so a
+// reader never waits on a writer (RCU-style).
+struct Snapshot {
+    std::unordered_map<int, NodeAccumulator> nodes;
+
+    // Every node above the minimum sample size, summarized at zero cost so
+    // that any cost filter can be applied at query time
+    std::vector<NodeResult> results;
+
+    // Pre-sorted permutations of results, one per RankMetric
+    std::array<std::vector<uint32_t>, static_cast<size_t>(RankMetric::Count)> order;
+
+    uint64_t version = 0;
+    long long total_rows = 0;
+    std::vector<std::string> sources;   // canonical paths
+};
+
+class QueryServer {
+public:
+    QueryServer(const std::string& socket_path, double transaction_cost = 0.75);
+    ~QueryServer();
+
+    // Aggregate a CSV file and merge it into the served state. A file
+    // already merged, or one repeating any (node, hour) already loaded, is
+    // rejected whole, since those rows would count twice. Returns what was
+    // merged as "key,value" lines.
+    std::string load(const std::string& csv_path);
+
+    // RELOAD only reads files under this directory ("" = RELOAD disabled)
+    void allow_reloads_from(const std::string& dir);
+
+    // Accept loop - serves line-oriented queries until the process exits
+    void run();
+
+    // Answer a single request line (exposed so queries can be issued in-process)
+    std::string handle(const std::string& request);
+
+private:
+    std::string socket_path_;
+    double transaction_cost_;
+    int listen_fd_ = -1;
+    std::string reload_dir_;
+
+    std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+    std::mutex reload_mutex_;
+    DataQuality loaded_hours_;   // every (node, hour) merged so far; under reload_mutex_
+    std::atomic<uint64_t> queries_served_{0};
+
+    static std::shared_ptr<const Snapshot> build_snapshot(
+        std::unordered_map<int, NodeAccumulator> nodes,
+        uint64_t version, long long total_rows,
+        std::vector<std::string> sources);
+
+    void serve_client(int fd);
+
+    std::string query_top(const Snapshot& snap, int k, RankMetric metric, double cost) const;
+    std::string query_node(const Snapshot& snap, int pnode_id, double cost) const;
+    std::string query_zones(const Snapshot& snap, double cost) const;
+    std::string query_filter(const Snapshot& snap, double cost) const;
+    std::string query_hourly(const Snapshot& snap, int pnode_id) const;
+    std::string query_status(const Snapshot& snap) const;
+};
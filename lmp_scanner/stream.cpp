@@ -0,0 +1,344 @@
+#include "stream.h"
+#include "csv_header.h"
+#include "fast_parser.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+const int MAX_FIELDS = 64;
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Column positions of the fields a price feed must provide
+struct PriceColumns {
+    int datetime;
+    int pnode_id;
+    int total;
+    int congestion;
+
+    PriceColumns(const CSVHeader& header, const char* market) {
+        std::string total_name = std::string("total_lmp_") + market;
+        std::string cong_name = std::string("congestion_price_") + market;
+        datetime = header.find({"datetime_beginning_ept", "datetime"});
+        pnode_id = header.find({"pnode_id"});
+        total = header.find({total_name.c_str(), "total_lmp"});
+        congestion = header.find({cong_name.c_str(), "congestion_price"});
+        if (datetime < 0 || pnode_id < 0 || total < 0 || congestion < 0) {
+            throw std::runtime_error(std::string("Missing ") + market +
+                                     " price columns in header");
+        }
+    }
+
+    int max_index() const {
+        return std::max(std::max(datetime, pnode_id), std::max(total, congestion));
+    }
+};
+
+} // namespace
+
+void RollingStats::update(double spread, double cong_spread, double alpha) {
+    n++;
+    last_spread = spread;
+    if (n == 1) {
+        mean = spread;
+        cong_mean = cong_spread;
+        var = 0.0;
+        return;
+    }
+    // Exponentially weighted mean/variance (West 1979)
+    double delta = spread - mean;
+    mean += alpha * delta;
+    var = (1.0 - alpha) * (var + alpha * delta * delta);
+    cong_mean += alpha * (cong_spread - cong_mean);
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    int bucket = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+    if (bucket >= BUCKETS) bucket = BUCKETS - 1;
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    if (ns > max_ns.load(std::memory_order_relaxed)) {
+        max_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+uint64_t LatencyHistogram::total() const {
+    uint64_t sum = 0;
+    for (const auto& c : counts) sum += c.load(std::memory_order_relaxed);
+    return sum;
+}
+
+// Upper bound of the bucket holding the p-th percentile
+uint64_t LatencyHistogram::percentile(double p) const {
+    uint64_t n = total();
+    if (n == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(std::ceil(p * n));
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        seen += counts[b].load(std::memory_order_relaxed);
+        if (seen >= target) return 1ULL << (b + 1);
+    }
+    return max_ns.load();
+}
+
+std::string LatencyHistogram::summary() const {
+    std::ostringstream out;
+    out << "records=" << total()
+        << " p50<" << percentile(0.50) << "ns"
+        << " p99<" << percentile(0.99) << "ns"
+        << " p99.9<" << percentile(0.999) << "ns"
+        << " max=" << max_ns.load() << "ns";
+    return out.str();
+}
+
+SpreadStream::SpreadStream(const StreamOptions& options)
+    : options_(options), queue_(std::make_unique<SPSCQueue<RTRecord, 65536>>()) {}
+
+void SpreadStream::load_day_ahead() {
+    std::ifstream file(options_.da_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open DA file: " + options_.da_path);
+    }
+
+    std::string line;
+    std::getline(file, line);
+    CSVHeader header(line);
+    PriceColumns cols(header, "da");
+
+    const char* starts[MAX_FIELDS];
+    size_t lengths[MAX_FIELDS];
+    int rows = 0;
+    int malformed = 0;
+    int line_no = 1;
+
+    while (std::getline(file, line)) {
+        line_no++;
+        int fields = split_fields(line.data(), line.size(), starts, lengths, MAX_FIELDS);
+        if (fields <= cols.max_index()) continue;
+
+        int hour_stamp = parse_hour_stamp(starts[cols.datetime], lengths[cols.datetime]);
+        if (hour_stamp < 0) {
+            malformed++;
+            continue;
+        }
+        // Prices are kept by hour of day, so the file must hold one operating day
+        if (da_day_ < 0) da_day_ = hour_stamp / 24;
+        if (hour_stamp / 24 != da_day_) {
+            throw std::runtime_error("DA file covers more than one operating day: " + options_.da_path +
+                                     " (line " + std::to_string(line_no) + ")");
+        }
+        int pnode_id = std::atoi(starts[cols.pnode_id]);
+        int hour = hour_stamp % 24;
+
+        auto& da = da_[pnode_id];
+        da.total[hour] = std::strtod(starts[cols.total], nullptr);
+        da.congestion[hour] = std::strtod(starts[cols.congestion], nullptr);
+        da.hours_present |= 1u << hour;
+        rows++;
+    }
+
+    // Analytics thread is the only writer from here on; pre-size so it never rehashes
+    stats_.reserve(da_.size() * 2);
+    for (const auto& [pnode_id, _] : da_) stats_[pnode_id];
+
+    std::cerr << "Loaded " << rows << " DA prices for " << da_.size() << " nodes" << std::endl;
+    if (malformed > 0) {
+        std::cerr << "Skipped " << malformed << " DA rows with a malformed datetime" << std::endl;
+    }
+}
+
+void SpreadStream::ingest(std::istream& in) {
+    std::string line, partial;
+    std::unique_ptr<PriceColumns> cols;
+    const char* starts[MAX_FIELDS];
+    size_t lengths[MAX_FIELDS];
+
+    while (true) {
+        if (!std::getline(in, line)) {
+            if (!options_.follow) break;
+            in.clear();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (in.eof() && options_.follow) {
+            // Writer hasn't finished this line yet
+            partial += line;
+            in.clear();
+            continue;
+        }
+        if (!partial.empty()) {
+            line = partial + line;
+            partial.clear();
+        }
+        if (line.empty()) continue;
+
+        uint64_t t0 = now_ns();
+
+        if (!cols) {
+            cols = std::make_unique<PriceColumns>(CSVHeader(line), "rt");
+            continue;
+        }
+
+        int fields = split_fields(line.data(), line.size(), starts, lengths, MAX_FIELDS);
+        if (fields <= cols->max_index()) continue;
+
+        RTRecord rec;
+        rec.hour_stamp = parse_hour_stamp(starts[cols->datetime], lengths[cols->datetime]);
+        if (rec.hour_stamp < 0) {
+            malformed_++;
+            continue;
+        }
+        rec.pnode_id = std::atoi(starts[cols->pnode_id]);
+        rec.total = std::strtod(starts[cols->total], nullptr);
+        rec.congestion = std::strtod(starts[cols->congestion], nullptr);
+        rec.ingest_ns = t0;
+
+        while (!queue_->try_push(rec)) std::this_thread::yield();
+    }
+
+    ingest_done_.store(true, std::memory_order_release);
+}
+
+void SpreadStream::process(const RTRecord& rec, double alpha) {
+    // Only RT hours of the DA operating day have a price to compare against
+    const int hour = rec.hour_stamp % 24;
+    auto da_it = da_.find(rec.pnode_id);
+    if (rec.hour_stamp / 24 != da_day_ || da_it == da_.end() ||
+        !(da_it->second.hours_present & (1u << hour))) {
+        unmatched_++;
+        return;
+    }
+    const auto& da = da_it->second;
+
+    double spread = da.total[hour] - rec.total;
+    double cong_spread = da.congestion[hour] - rec.congestion;
+
+    auto& stats = stats_[rec.pnode_id];
+
+    // Score against the stats *before* this observation
+    double std_dev = std::sqrt(stats.var);
+    double z = std_dev > 0 ? (spread - stats.mean) / std_dev : 0.0;
+    bool z_alert = stats.n >= options_.warmup && std::abs(z) >= options_.z_threshold;
+    bool level_alert = std::abs(spread) >= options_.spread_threshold;
+    double prev_mean = stats.mean;
+
+    stats.update(spread, cong_spread, alpha);
+    records_++;
+
+    latency_.record(now_ns() - rec.ingest_ns);
+
+    if (z_alert || level_alert) {
+        stats.alerts++;
+        alerts_++;
+        std::cout << "ALERT," << (z_alert ? "ZSCORE" : "THRESHOLD") << ","
+                  << rec.pnode_id << "," << hour << ","
+                  << std::fixed << std::setprecision(4)
+                  << spread << "," << z << "," << prev_mean << "," << std_dev
+                  << std::endl;
+    }
+}
+
+void SpreadStream::analytics() {
+    // Per-record EWMA weight from the half-life
+    const double alpha = 1.0 - std::pow(0.5, 1.0 / options_.halflife);
+    RTRecord rec;
+    int idle = 0;
+
+    while (true) {
+        if (queue_->try_pop(rec)) {
+            process(rec, alpha);
+            idle = 0;
+            continue;
+        }
+        if (ingest_done_.load(std::memory_order_acquire) && queue_->size() == 0) break;
+        // Spin briefly before yielding to keep wake-up latency in the microseconds
+        if (++idle > 1000) std::this_thread::yield();
+    }
+}
+
+void SpreadStream::write_outputs() const {
+    std::ofstream lat("../output/stream_latency.csv");
+    lat << "bucket_lower_ns,bucket_upper_ns,count\n";
+    for (int b = 0; b < LatencyHistogram::BUCKETS; b++) {
+        uint64_t c = latency_.counts[b].load();
+        if (c == 0) continue;
+        lat << (b == 0 ? 0 : (1ULL << b)) << "," << (1ULL << (b + 1)) << "," << c << "\n";
+    }
+    lat.close();
+    std::cerr << "  ✓ stream_latency.csv" << std::endl;
+
+    std::ofstream out("../output/stream_nodes.csv");
+    out << "pnode_id,records,ewma_mean,ewma_std,ewma_cong_mean,last_spread,alerts\n";
+    out << std::fixed << std::setprecision(4);
+    for (const auto& [pnode_id, s] : stats_) {
+        if (s.n == 0) continue;
+        out << pnode_id << ","
+            << s.n << ","
+            << s.mean << ","
+            << std::sqrt(s.var) << ","
+            << s.cong_mean << ","
+            << s.last_spread << ","
+            << s.alerts << "\n";
+    }
+    out.close();
+    std::cerr << "  ✓ stream_nodes.csv" << std::endl;
+}
+
+void SpreadStream::run() {
+    load_day_ahead();
+
+    std::ifstream file;
+    std::istream* in = &std::cin;
+    if (options_.rt_source != "-") {
+        file.open(options_.rt_source);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open RT source: " + options_.rt_source);
+        }
+        in = &file;
+    } else {
+        std::ios::sync_with_stdio(false);
+    }
+
+    std::cout << "ALERT,type,pnode_id,hour,spread,zscore,ewma_mean,ewma_std" << std::endl;
+
+    std::atomic<bool> finished{false};
+    std::thread reporter;
+    if (options_.stats_interval > 0) {
+        reporter = std::thread([&]() {
+            auto next = std::chrono::steady_clock::now();
+            while (!finished.load()) {
+                next += std::chrono::seconds(options_.stats_interval);
+                while (!finished.load() && std::chrono::steady_clock::now() < next) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+                std::cerr << "  [latency] " << latency_.summary()
+                          << " queue=" << queue_->size() << std::endl;
+            }
+        });
+    }
+
+    std::thread consumer(&SpreadStream::analytics, this);
+    ingest(*in);
+    consumer.join();
+
+    finished.store(true);
+    if (reporter.joinable()) reporter.join();
+
+    std::cerr << "\nStream complete:" << std::endl;
+    std::cerr << "  Records scored: " << records_ << std::endl;
+    std::cerr << "  Records without DA price: " << unmatched_ << std::endl;
+    std::cerr << "  Records with a malformed datetime: " << malformed_ << std::endl;
+    std::cerr << "  Alerts fired: " << alerts_ << std::endl;
+    std::cerr << "  Update latency: " << latency_.summary() << std::endl;
+    write_outputs();
+}
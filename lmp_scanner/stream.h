@@ -0,0 +1,91 @@
+#pragma once
+
+#include "spsc_queue.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct StreamOptions {
+    std::string da_path;
+    std::string rt_source = "-";     // "-" for stdin, otherwise a file or named pipe
+    bool follow = false;             // keep reading a growing file (tail -f)
+    double spread_threshold = 50.0;  // |spread| alert level, $/MWh
+    double z_threshold = 4.0;        // z-score alert level against the rolling stats
+    double halflife = 24.0;          // EWMA half-life, in records per node
+    int warmup = 12;                 // records per node before z-score alerts fire
+    int stats_interval = 0;          // seconds between latency reports (0 = only at end)
+};
+
+// One RT LMP observation handed from the ingest to the analytics thread
+struct RTRecord {
+    int pnode_id;
+    int hour_stamp;     // hours since the epoch
+    double total;
+    double congestion;
+    uint64_t ingest_ns;
+};
+
+// Day-ahead prices for the operating day, by hour
+struct DAPrices {
+    std::array<double, 24> total{};
+    std::array<double, 24> congestion{};
+    uint32_t hours_present = 0;  // bit h set when hour h was loaded
+};
+
+// Exponentially weighted spread statistics for one node
+struct RollingStats {
+    long long n = 0;
+    double mean = 0.0;
+    double var = 0.0;
+    double cong_mean = 0.0;
+    double last_spread = 0.0;
+    int alerts = 0;
+
+    void update(double spread, double cong_spread, double alpha);
+};
+
+// Log2-bucketed latency histogram (bucket b holds [2^b, 2^(b+1)) ns)
+struct LatencyHistogram {
+    static constexpr int BUCKETS = 40;
+    std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+    std::atomic<uint64_t> max_ns{0};
+
+    void record(uint64_t ns);
+    uint64_t total() const;
+    uint64_t percentile(double p) const;
+    std::string summary() const;
+};
+
+class SpreadStream {
+public:
+    explicit SpreadStream(const StreamOptions& options);
+
+    void run();
+
+private:
+    StreamOptions options_;
+
+    std::unordered_map<int, DAPrices> da_;
+    int da_day_ = -1;   // operating day of da_, days since the epoch
+    std::unordered_map<int, RollingStats> stats_;
+
+    std::unique_ptr<SPSCQueue<RTRecord, 65536>> queue_;
+    std::atomic<bool> ingest_done_{false};
+    LatencyHistogram latency_;
+
+    long long records_ = 0;
+    long long unmatched_ = 0;
+    long long malformed_ = 0;   // RT lines without a parseable datetime
+    long long alerts_ = 0;
+
+    void load_day_ahead();
+    void ingest(std::istream& in);
+    void analytics();
+    void process(const RTRecord& rec, double alpha);
+    void write_outputs() const;
+};
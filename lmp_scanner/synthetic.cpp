@@ -0,0 +1,326 @@
+#include "synthetic.h"
+#include "fast_parser.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const char* const ZONES[] = {
+    "AECO", "AEP", "APS", "ATSI", "BGE", "COMED", "DAY", "DEOK", "DOM", "DPL",
+    "DUQ", "EKPC", "JCPL", "METED", "PECO", "PENELEC", "PEPCO", "PPL", "PSEG", "RECO"
+};
+const int NUM_ZONES = sizeof(ZONES) / sizeof(ZONES[0]);
+
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Uniform in [0, 1) from a hash of the inputs
+inline double uniform(uint64_t seed, uint64_t a, uint64_t b, uint64_t stream) {
+    uint64_t h = splitmix64(seed ^ splitmix64(a ^ splitmix64(b ^ splitmix64(stream))));
+    return (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Approximately standard normal (Irwin-Hall with four draws)
+inline double normal(uint64_t seed, uint64_t a, uint64_t b, uint64_t stream) {
+    double sum = 0;
+    for (uint64_t k = 0; k < 4; k++) sum += uniform(seed, a, b, stream * 4 + k);
+    return (sum - 2.0) * std::sqrt(3.0);
+}
+
+// Published prices carry five decimals
+inline double round5(double x) { return std::round(x * 1e5) / 1e5; }
+
+enum Stream : uint64_t {
+    NODE_BIAS, NODE_LOSS, NODE_VOL,
+    HOUR_ENERGY, HOUR_RT_ENERGY,
+    ROW_CONG_DA, ROW_CONG_RT, ROW_LOSS, ROW_SPIKE, ROW_SPIKE_SIZE,
+    // normal() spreads each stream over four, so later streams start clear
+    NODE_ZONE = 100, HOUR_ZONE_CONG, ROW_TAIL = 110, ROW_MALFORMED, ROW_MALFORMED_KIND
+};
+
+const double PI = 3.14159265358979323846;
+
+SyntheticNode draw_node(const SyntheticSpec& spec, uint64_t node) {
+    const uint64_t seed = spec.seed;
+    SyntheticNode n;
+    n.pnode_id = 1000 + static_cast<int>(node) * 7;
+    n.zone_index = static_cast<int>(node % NUM_ZONES);
+    if (!spec.zone_weights.empty()) {
+        double total = 0;
+        for (double w : spec.zone_weights) total += w;
+        double pick = uniform(seed, node, 0, NODE_ZONE) * total;
+        for (size_t z = 0; z < spec.zone_weights.size(); z++) {
+            n.zone_index = static_cast<int>(z);
+            pick -= spec.zone_weights[z];
+            if (pick < 0 && spec.zone_weights[z] > 0) break;
+        }
+    }
+    // Nodes carry a persistent congestion bias that DA prices in more than RT
+    n.bias = 4.0 * normal(seed, node, 0, NODE_BIAS);
+    n.vol = 2.0 + 6.0 * uniform(seed, node, 0, NODE_VOL);
+    n.loss_factor = 0.02 * normal(seed, node, 0, NODE_LOSS);
+    return n;
+}
+
+// System energy follows a daily shape shared by every node; RT deviates
+// from DA by an hourly system-wide error
+void draw_hour(const SyntheticSpec& spec, uint64_t hour_index, SyntheticHour& hour) {
+    const uint64_t seed = spec.seed;
+    hour.hour_stamp = spec.start_hour + static_cast<int>(hour_index);
+    int hour_of_day = hour.hour_stamp % 24;
+    double shape = std::sin(2 * PI * (hour_of_day - 9) / 24.0);
+    hour.energy_da = round5(32.0 + 9.0 * shape + 3.0 * normal(seed, hour_index, 0, HOUR_ENERGY));
+    hour.energy_rt = round5(hour.energy_da + 6.0 * normal(seed, hour_index, 0, HOUR_RT_ENERGY));
+    hour.zone_factor.clear();
+    if (spec.zone_correlation > 0) {
+        for (int z = 0; z < NUM_ZONES; z++) {
+            hour.zone_factor.push_back(normal(seed, hour_index, z, HOUR_ZONE_CONG));
+        }
+    }
+}
+
+SyntheticRow make_row(const SyntheticSpec& spec, const SyntheticNode& n, const SyntheticHour& hour,
+                      uint64_t node, uint64_t hour_index) {
+    const uint64_t seed = spec.seed;
+    SyntheticRow row;
+    row.pnode_id = n.pnode_id;
+    row.zone_index = n.zone_index;
+    row.zone = ZONES[n.zone_index];
+    row.hour_stamp = hour.hour_stamp;
+    row.energy_da = hour.energy_da;
+    row.energy_rt = hour.energy_rt;
+
+    row.cong_da = round5(n.bias + 1.5 * normal(seed, node, hour_index, ROW_CONG_DA));
+    double noise = normal(seed, node, hour_index, ROW_CONG_RT);
+    if (spec.zone_correlation > 0) {
+        const double rho = std::min(spec.zone_correlation, 1.0);
+        noise = std::sqrt(rho) * hour.zone_factor[n.zone_index] + std::sqrt(1.0 - rho) * noise;
+    }
+    if (spec.tail_index > 0) {
+        // A Pareto scale on the normal draw: P(|x| > t) falls off as t^-index
+        noise *= std::pow(1.0 - uniform(seed, node, hour_index, ROW_TAIL), -1.0 / spec.tail_index);
+    }
+    double cong_rt = 0.4 * n.bias + n.vol * noise;
+    if (uniform(seed, node, hour_index, ROW_SPIKE) < 0.002) {
+        cong_rt += (uniform(seed, node, hour_index, ROW_SPIKE_SIZE) - 0.3) * 400.0;
+    }
+    row.cong_rt = round5(cong_rt);
+
+    row.loss_da = round5(n.loss_factor * row.energy_da);
+    row.loss_rt = round5(n.loss_factor * row.energy_rt + 0.05 * normal(seed, node, hour_index, ROW_LOSS));
+
+    double total_da = row.energy_da + row.cong_da + row.loss_da;
+    double total_rt = row.energy_rt + row.cong_rt + row.loss_rt;
+    row.spread = round5(total_da - total_rt);
+    return row;
+}
+
+// "YYYY-MM-DD HH:00:00" for hours since the epoch (inverse of
+// days_from_civil, also Hinnant's)
+char* put_datetime(char* out, int hour_stamp) {
+    int z = hour_stamp / 24 + 719468;
+    const int era = (z >= 0 ? z : z - 146096) / 146097;
+    const int doe = z - era * 146097;
+    const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int mp = (5 * doy + 2) / 153;
+    const int d = doy - (153 * mp + 2) / 5 + 1;
+    const int m = mp < 10 ? mp + 3 : mp - 9;
+    const int y = yoe + era * 400 + (m <= 2);
+    const int h = hour_stamp % 24;
+    auto two = [&](int v) { *out++ = static_cast<char>('0' + v / 10); *out++ = static_cast<char>('0' + v % 10); };
+    two(y / 100);
+    two(y % 100);
+    *out++ = '-';
+    two(m);
+    *out++ = '-';
+    two(d);
+    *out++ = ' ';
+    two(h);
+    std::memcpy(out, ":00:00", 6);
+    return out + 6;
+}
+
+// Prices are already rounded to five decimals, so print them as scaled
+// integers rather than through floating-point formatting
+char* put_price(char* out, double value) {
+    const double scaled = value * 1e5;
+    int64_t units = static_cast<int64_t>(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+    if (units < 0) {
+        *out++ = '-';
+        units = -units;
+    }
+    out = std::to_chars(out, out + 20, units / 100000).ptr;
+    *out++ = '.';
+    int64_t frac = units % 100000;
+    for (int d = 4; d >= 0; d--) {
+        out[d] = static_cast<char>('0' + frac % 10);
+        frac /= 10;
+    }
+    return out + 5;
+}
+
+// Rows arrive hour by hour, so each thread formats an hour's datetimes once
+struct DatetimeCache {
+    int hour_stamp = -1;
+    char local[19];
+    char utc[19];
+
+    void set(int stamp) {
+        if (stamp == hour_stamp) return;
+        put_datetime(local, stamp);
+        put_datetime(utc, stamp + 5);
+        hour_stamp = stamp;
+    }
+};
+
+char* put_bytes(char* out, const char* bytes, size_t len) {
+    std::memcpy(out, bytes, len);
+    return out + len;
+}
+
+} // namespace
+
+const char* const SYNTHETIC_CSV_HEADER =
+    "datetime_beginning_utc_da,datetime_da,pnode_id_da,pnode_name_da,voltage_da,equipment_da,"
+    "total_lmp_da,congestion_price_da,marginal_loss_price_da,system_energy_price_da,"
+    "datetime_beginning_utc_rt,datetime_rt,pnode_id_rt,pnode_name_rt,voltage_rt,equipment_rt,"
+    "total_lmp_rt,congestion_price_rt,marginal_loss_price_rt,system_energy_price_rt,"
+    "datetime,pnode_id,zone,spread";
+
+int synthetic_zone_count() { return NUM_ZONES; }
+const char* synthetic_zone(int index) { return ZONES[index]; }
+
+bool is_synthetic_spec(const std::string& path) {
+    return path.rfind("synthetic:", 0) == 0;
+}
+
+SyntheticSpec parse_synthetic_spec(const std::string& path) {
+    SyntheticSpec spec;
+    unsigned long long seed = 1;
+    int fields = std::sscanf(path.c_str(), "synthetic:%dx%d:%llu", &spec.nodes, &spec.hours, &seed);
+    if (fields < 2 || spec.nodes <= 0 || spec.hours <= 0) {
+        throw std::runtime_error("Invalid synthetic spec: " + path + " (synthetic:NODESxHOURS[:SEED])");
+    }
+    spec.seed = seed;
+    spec.start_hour = days_from_civil(2025, 1, 1) * 24;
+    return spec;
+}
+
+SyntheticRow synthesize_row(const SyntheticSpec& spec, uint64_t index) {
+    SyntheticHour hour;
+    draw_hour(spec, index / spec.nodes, hour);
+    return make_row(spec, draw_node(spec, index % spec.nodes), hour, index % spec.nodes, index / spec.nodes);
+}
+
+SyntheticCursor::SyntheticCursor(const SyntheticSpec& spec)
+    : spec_(spec), nodes_(spec.nodes), drawn_(spec.nodes, false) {}
+
+void SyntheticCursor::seek(uint64_t index) { index_ = index; }
+
+SyntheticRow SyntheticCursor::next() {
+    const uint64_t hour_index = index_ / spec_.nodes;
+    const uint64_t node = index_ % spec_.nodes;
+    index_++;
+    if (hour_index != hour_index_) {
+        draw_hour(spec_, hour_index, hour_);
+        hour_index_ = hour_index;
+    }
+    if (!drawn_[node]) {
+        nodes_[node] = draw_node(spec_, node);
+        drawn_[node] = true;
+    }
+    return make_row(spec_, nodes_[node], hour_, node, hour_index);
+}
+
+size_t format_synthetic_row(const SyntheticRow& row, char* out) {
+    thread_local DatetimeCache datetimes;
+    datetimes.set(row.hour_stamp);
+
+    char* p = out;
+    char pnode[16];
+    const size_t pnode_len = std::to_chars(pnode, pnode + 16, row.pnode_id).ptr - pnode;
+    const size_t zone_len = std::strlen(row.zone);
+
+    // DA then RT half: UTC begin (EST, +5h), local time, node identity, prices
+    auto half = [&](double cong, double loss, double energy) {
+        p = put_bytes(p, datetimes.utc, 19);
+        *p++ = ',';
+        p = put_bytes(p, datetimes.local, 19);
+        *p++ = ',';
+        p = put_bytes(p, pnode, pnode_len);
+        *p++ = ',';
+        p = put_bytes(p, row.zone, zone_len);
+        *p++ = '_';
+        p = put_bytes(p, pnode, pnode_len);
+        p = put_bytes(p, ",138KV,LOAD,", 12);
+        p = put_price(p, energy + cong + loss);
+        *p++ = ',';
+        p = put_price(p, cong);
+        *p++ = ',';
+        p = put_price(p, loss);
+        *p++ = ',';
+        p = put_price(p, energy);
+        *p++ = ',';
+    };
+    half(row.cong_da, row.loss_da, row.energy_da);
+    half(row.cong_rt, row.loss_rt, row.energy_rt);
+
+    p = put_bytes(p, datetimes.local, 19);
+    *p++ = ',';
+    p = put_bytes(p, pnode, pnode_len);
+    *p++ = ',';
+    p = put_bytes(p, row.zone, zone_len);
+    *p++ = ',';
+    p = put_price(p, row.spread);
+    *p++ = '\n';
+    return p - out;
+}
+
+bool corrupt_synthetic_line(const SyntheticSpec& spec, uint64_t index, char* line, size_t& len) {
+    if (spec.malformed_rate <= 0 || uniform(spec.seed, index, 0, ROW_MALFORMED) >= spec.malformed_rate) {
+        return false;
+    }
+    // Offset of field `col`
+    auto field = [&](int col) {
+        size_t pos = 0;
+        for (int c = 0; c < col; c++) {
+            pos = static_cast<const char*>(std::memchr(line + pos, ',', len - pos)) - line + 1;
+        }
+        return pos;
+    };
+    switch (static_cast<int>(uniform(spec.seed, index, 0, ROW_MALFORMED_KIND) * 4)) {
+        case 0: {   // cut off mid-row
+            size_t end = field(12);
+            line[end - 1] = '\n';
+            len = end;
+            break;
+        }
+        case 1: {   // month and hour out of range
+            std::memcpy(line + field(COL_DATETIME), "2025-13-01 25", 13);
+            break;
+        }
+        case 2: {   // spread (the last field) not a number
+            size_t pos = field(COL_SPREAD);
+            std::memcpy(line + pos, "N/A\n", 4);
+            len = pos + 4;
+            break;
+        }
+        default: {  // empty pnode_id
+            size_t pos = field(COL_PNODE_ID);
+            size_t next = field(COL_PNODE_ID + 1) - 1;
+            std::memmove(line + pos, line + next, len - next);
+            len -= next - pos;
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Deterministic synthetic LMP data. Every row is a pure function of
+// (seed, node index, hour index), so any slice can be generated
+// independently and in parallel with identical results.
+struct SyntheticSpec {
+    int nodes = 1200;
+    int hours = 720;
+    uint64_t seed = 1;
+    int start_hour = 0;   // hours since epoch of the first row
+
+    // Shape knobs (lmp_gen); the defaults give the plain model
+    std::vector<double> zone_weights;   // relative node share per synthetic_zone(); empty = round robin
+    double tail_index = 0.0;            // > 0: RT congestion noise gets power-law tails of this index
+    double zone_correlation = 0.0;      // share of RT congestion noise common to a zone within an hour
+    double malformed_rate = 0.0;        // fraction of lines corrupt_synthetic_line() damages
+
+    uint64_t rows() const { return static_cast<uint64_t>(nodes) * hours; }
+};
+
+// "synthetic:NODESxHOURS[:SEED]", e.g. "synthetic:1200x720:7"; starts 2025-01-01
+bool is_synthetic_spec(const std::string& path);
+SyntheticSpec parse_synthetic_spec(const std::string& path);
+
+struct SyntheticRow {
+    int pnode_id;
+    int zone_index;       // into synthetic_zone()
+    const char* zone;
+    int hour_stamp;
+    double cong_da, loss_da, energy_da;
+    double cong_rt, loss_rt, energy_rt;
+    double spread;        // total DA - total RT
+};
+
+int synthetic_zone_count();
+const char* synthetic_zone(int index);
+
+// Row `index` in time-major order: index / nodes is the hour, index % nodes the node
+SyntheticRow synthesize_row(const SyntheticSpec& spec, uint64_t index);
+
+// Per-node and per-hour draws shared by many rows
+struct SyntheticNode {
+    int pnode_id;
+    int zone_index;
+    double bias;          // persistent congestion bias
+    double vol;           // RT congestion volatility
+    double loss_factor;
+};
+
+struct SyntheticHour {
+    int hour_stamp = 0;
+    double energy_da = 0.0;
+    double energy_rt = 0.0;
+    std::vector<double> zone_factor;   // common RT congestion noise by zone
+};
+
+// Walks rows in order producing what synthesize_row() would, but draws each
+// node's and each hour's parameters once rather than for every row
+class SyntheticCursor {
+public:
+    explicit SyntheticCursor(const SyntheticSpec& spec);
+
+    void seek(uint64_t index);
+    SyntheticRow next();
+
+private:
+    const SyntheticSpec& spec_;
+    uint64_t index_ = 0;
+    std::vector<SyntheticNode> nodes_;
+    std::vector<bool> drawn_;
+    SyntheticHour hour_;
+    uint64_t hour_index_ = UINT64_MAX;
+};
+
+// The merged CSV layout fetch.py writes (24 columns, see CSVColumn)
+extern const char* const SYNTHETIC_CSV_HEADER;
+
+// Longest line format_synthetic_row() can produce
+constexpr size_t SYNTHETIC_MAX_LINE = 512;
+
+// One merged CSV line for a row, newline included, prices at five decimals;
+// returns the bytes written to `out` (at least SYNTHETIC_MAX_LINE long)
+size_t format_synthetic_row(const SyntheticRow& row, char* out);
+
+// Damages line `index` in place if it is one of the spec's malformed rows
+// (truncated, unparseable datetime, non-numeric spread or missing pnode_id),
+// updating `len`; the line stays newline-terminated. Returns whether it did.
+bool corrupt_synthetic_line(const SyntheticSpec& spec, uint64_t index, char* line, size_t& len);
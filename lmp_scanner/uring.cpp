@@ -0,0 +1,146 @@
+#include "uring.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+int sys_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int sys_register(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+template <typename T>
+T* at(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+} // namespace
+
+IoMode parse_io_mode(const std::string& name) {
+    if (name == "uring") return IoMode::Uring;
+    if (name == "direct") return IoMode::Direct;
+    if (name == "pread") return IoMode::Pread;
+    if (name == "stream") return IoMode::Stream;
+    throw std::runtime_error("Unknown io mode: " + name + " (uring|direct|pread|stream)");
+}
+
+std::unique_ptr<IoUring> IoUring::create(unsigned entries, std::string& why) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const int fd = sys_setup(entries, &params);
+    if (fd < 0) {
+        why = std::string("io_uring_setup: ") + std::strerror(errno);
+        return nullptr;
+    }
+
+    std::unique_ptr<IoUring> ring(new IoUring());
+    ring->ring_fd_ = fd;
+    ring->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        ring->sq_ring_size_ = ring->cq_ring_size_ = std::max(ring->sq_ring_size_, ring->cq_ring_size_);
+    }
+
+    void* sq = ::mmap(nullptr, ring->sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        why = "cannot map the submission ring";
+        return nullptr;
+    }
+    ring->sq_ring_ = sq;
+    void* cq = sq;
+    if (!single_mmap) {
+        cq = ::mmap(nullptr, ring->cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                    IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            why = "cannot map the completion ring";
+            return nullptr;
+        }
+        ring->cq_ring_ = cq;
+    }
+    ring->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, ring->sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        why = "cannot map the submission entries";
+        return nullptr;
+    }
+    ring->sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    ring->sq_tail_ = at<unsigned>(sq, params.sq_off.tail);
+    ring->sq_mask_ = at<unsigned>(sq, params.sq_off.ring_mask);
+    ring->sq_array_ = at<unsigned>(sq, params.sq_off.array);
+    ring->cq_head_ = at<unsigned>(cq, params.cq_off.head);
+    ring->cq_tail_ = at<unsigned>(cq, params.cq_off.tail);
+    ring->cq_mask_ = at<unsigned>(cq, params.cq_off.ring_mask);
+    ring->cqes_ = at<io_uring_cqe>(cq, params.cq_off.cqes);
+    return ring;
+}
+
+IoUring::~IoUring() {
+    if (sqes_) ::munmap(sqes_, sqes_size_);
+    if (cq_ring_) ::munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_) ::munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0) ::close(ring_fd_);
+}
+
+bool IoUring::register_buffers(const std::vector<std::pair<void*, size_t>>& buffers) {
+    std::vector<iovec> iov;
+    for (const auto& [base, len] : buffers) iov.push_back({base, len});
+    registered_ = sys_register(ring_fd_, IORING_REGISTER_BUFFERS, iov.data(), iov.size()) == 0;
+    return registered_;
+}
+
+void IoUring::read(int fd, unsigned index, void* dst, unsigned len, uint64_t offset, uint64_t tag) {
+    // Only this thread produces, so the tail needs no atomic read-modify-write
+    const unsigned tail = *sq_tail_;
+    const unsigned slot = tail & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[slot];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = registered_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(dst);
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->buf_index = registered_ ? index : 0;
+    sqe->user_data = tag;
+    sq_array_[slot] = slot;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    while (sys_enter(ring_fd_, 1, 0, 0) < 0) {
+        if (errno != EINTR && errno != EAGAIN) {
+            throw std::runtime_error(std::string("io_uring_enter: ") + std::strerror(errno));
+        }
+    }
+}
+
+void IoUring::wait(uint64_t& tag, int& result) {
+    for (;;) {
+        const unsigned head = *cq_head_;
+        if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+            tag = cqe.user_data;
+            result = cqe.res;
+            __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+            return;
+        }
+        if (sys_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("io_uring_enter: ") + std::strerror(errno));
+        }
+    }
+}
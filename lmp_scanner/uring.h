@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// How the batch engine reads an uncompressed CSV file
+enum class IoMode {
+    Uring,    // io_uring reads kept in flight into registered buffers (pread if unavailable)
+    Direct,   // the same with O_DIRECT, bypassing the page cache
+    Pread,    // pread on the reader thread, one read at a time
+    Stream    // std::ifstream blocks (BlockReader)
+};
+
+IoMode parse_io_mode(const std::string& name);
+
+// A minimal io_uring over the raw syscalls (no liburing): one submission
+// and one completion ring, used only for reads. Buffers registered up front
+// are read with READ_FIXED, so the kernel doesn't map them per request.
+class IoUring {
+public:
+    // Null if the kernel or sandbox doesn't allow io_uring; `why` says why
+    static std::unique_ptr<IoUring> create(unsigned entries, std::string& why);
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // False if registration isn't allowed (reads then use plain READ)
+    bool register_buffers(const std::vector<std::pair<void*, size_t>>& buffers);
+    bool buffers_registered() const { return registered_; }
+
+    // Queues and submits a read of `len` bytes at `offset` into buffer
+    // `index` (at `dst`, inside that buffer); `tag` comes back on completion
+    void read(int fd, unsigned index, void* dst, unsigned len, uint64_t offset, uint64_t tag);
+
+    // Blocks for the next completion: its tag and result (bytes or -errno)
+    void wait(uint64_t& tag, int& result);
+
+private:
+    IoUring() = default;
+
+    int ring_fd_ = -1;
+    bool registered_ = false;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    struct io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    struct io_uring_cqe* cqes_ = nullptr;
+};